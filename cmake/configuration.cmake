@@ -36,4 +36,11 @@ if (MSVC)
 			"$<$<CONFIG:Debug>:${LINK_OPTIONS_DEBUG}>"
 			"$<$<CONFIG:Release>:${LINK_OPTIONS_RELEASE}>"
 	)
+elseif (CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
+	target_compile_options(
+		${PROJECT_NAME}
+		PRIVATE
+			-Wall
+			-Wextra
+	)
 endif()
@@ -0,0 +1,34 @@
+#include "sfse/ActorValueBatch.h"
+#include "sfse/GameTypes.h"
+#include "sfse/GameReferences.h"
+
+// ActorValueOwner virtuals called through a plain pointer, this goes in rcx either way
+typedef float (* _GetValue)(ActorValueOwner * owner, const ActorValueInfo * info);
+
+void ActorValueBatch_Read(Actor * const * actors, u32 numActors, const ActorValueInfo * const * infos, u32 numInfos, u32 flags, float * out)
+{
+	// vtable order: GetActorValue, GetPermanentActorValue, GetBaseActorValue
+	u32 kind = flags & 0xFF;
+	if(kind > kActorValueBatch_Base)
+		kind = kActorValueBatch_Current;
+
+	for(u32 i = 0; i < numActors; i++)
+	{
+		Actor * actor = actors[i];
+
+		if(!actor)
+		{
+			for(u32 j = 0; j < numInfos; j++)
+				out[j * numActors + i] = 0;
+
+			continue;
+		}
+
+		// the owner interface is the subobject at 70, see TESObjectREFR
+		auto * owner = reinterpret_cast<ActorValueOwner *>(&actor->ActorValueOwner);
+		_GetValue getValue = (*(_GetValue **)owner)[kind];
+
+		for(u32 j = 0; j < numInfos; j++)
+			out[j * numActors + i] = getValue(owner, infos[j]);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+class Actor;
+class ActorValueInfo;
+
+// reads many actor values for many actors in one call
+//
+// results are stored by value, then by actor: out[info * numActors + actor], so each value is one contiguous
+// column for callers that process it across every actor. each actor's ActorValueOwner function is looked up once
+// and reused for every value instead of dispatching virtually per value. null actors read as 0.
+
+enum
+{
+	kActorValueBatch_Current = 0,
+	kActorValueBatch_Permanent,
+	kActorValueBatch_Base,
+};
+
+// reads on the calling thread. the game doesn't lock actor values for readers, and nothing here can tell whether
+// an actor is being processed, so there's no parallel mode
+void ActorValueBatch_Read(Actor * const * actors, u32 numActors, const ActorValueInfo * const * infos, u32 numInfos, u32 flags, float * out);
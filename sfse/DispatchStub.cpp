@@ -0,0 +1,111 @@
+#include "DispatchStub.h"
+#include "xbyak/xbyak.h"
+#include <cstring>
+#include <vector>
+
+enum
+{
+	kFixedSize = 64,		// prolog, epilog and return value
+	kHandlerSize = 48,		// message refill, call and handler address
+
+	// prolog offsets, must match the code below for the unwind info
+	kProlog_PushRBX = 1,
+	kProlog_PushRSI = 2,
+	kProlog_PushRDI = 3,
+	kProlog_Size = 7,		// sub rsp, imm8
+
+	// frame layout after the prolog: shadow space, then the message
+	kMsg_Sender = 0x20,
+	kMsg_Type = 0x28,
+	kMsg_DataLen = 0x2C,
+	kMsg_Data = 0x30,
+	kFrameSize = 0x40,
+};
+
+size_t GetDispatchStubSize(u32 numHandlers)
+{
+	return kFixedSize + size_t(numHandlers) * kHandlerSize;
+}
+
+void BuildDispatchStubUnwindInfo(void * dst)
+{
+	enum
+	{
+		UWOP_PUSH_NONVOL = 0,
+		UWOP_ALLOC_SMALL = 2,
+
+		kReg_RBX = 3,
+		kReg_RSI = 6,
+		kReg_RDI = 7,
+	};
+
+	// UNWIND_INFO version 1, no handler, no frame register. codes are in reverse prolog order
+	const u8 info[kDispatchStubUnwindInfoSize] =
+	{
+		1, kProlog_Size, 4, 0,
+		kProlog_Size, UWOP_ALLOC_SMALL | (((kFrameSize - 8) / 8) << 4),
+		kProlog_PushRDI, UWOP_PUSH_NONVOL | (kReg_RDI << 4),
+		kProlog_PushRSI, UWOP_PUSH_NONVOL | (kReg_RSI << 4),
+		kProlog_PushRBX, UWOP_PUSH_NONVOL | (kReg_RBX << 4),
+	};
+
+	memcpy(dst, info, sizeof(info));
+}
+
+size_t BuildDispatchStub(const char * sender, const uintptr_t * handlers, u32 numHandlers, void * dst, size_t dstLen)
+{
+	if(dstLen < GetDispatchStubSize(numHandlers))
+		return 0;
+
+	struct DispatchStub_Code : Xbyak::CodeGenerator
+	{
+		DispatchStub_Code(void * buf, size_t len, const char * sender, const uintptr_t * handlers, u32 numHandlers) : Xbyak::CodeGenerator(len, buf)
+		{
+			// rsp is 8 mod 16 on entry, three pushes and the frame realign it
+			push(rbx);
+			push(rsi);
+			push(rdi);
+			sub(rsp, kFrameSize);
+
+			// arguments go in callee-saved registers so they survive the handlers
+			mov(ebx, ecx);
+			mov(rsi, rdx);
+			mov(edi, r8d);
+
+			std::vector <Xbyak::Label> handlerLabels(numHandlers);
+
+			for(u32 i = 0; i < numHandlers; i++)
+			{
+				mov(rax, uintptr_t(sender));
+				mov(ptr[rsp + kMsg_Sender], rax);
+				mov(dword[rsp + kMsg_Type], ebx);
+				mov(dword[rsp + kMsg_DataLen], edi);
+				mov(ptr[rsp + kMsg_Data], rsi);
+
+				lea(rcx, ptr[rsp + kMsg_Sender]);
+				call(ptr[rip + handlerLabels[i]]);
+			}
+
+			mov(eax, numHandlers ? 1 : 0);
+
+			add(rsp, kFrameSize);
+			pop(rdi);
+			pop(rsi);
+			pop(rbx);
+			ret();
+
+			align(8);
+
+			for(u32 i = 0; i < numHandlers; i++)
+			{
+				L(handlerLabels[i]);
+				dq(handlers[i]);
+			}
+		}
+	};
+
+	DispatchStub_Code code(dst, dstLen, sender, handlers, numHandlers);
+	code.ready();
+
+	return code.getSize();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <vector>
+
+// straight-line code that sends a message to a fixed list of listeners
+//
+// the generated function is bool (u32 type, void * data, u32 dataLen) using the win64 convention. the sender
+// name and handler addresses are baked in as immediates, the message lives in the stub's frame and is refilled
+// from registers before each call so a handler that scribbles on it can't affect the next one. returns true if
+// there was at least one handler. the code is position independent, build it anywhere and copy it to
+// executable memory.
+//
+// every stub has the same prolog, so one UNWIND_INFO describes all of them. register it with a RUNTIME_FUNCTION
+// per stub (RtlAddFunctionTable) so exceptions and stack walks can get through a handler's frame.
+//
+// nothing here needs Windows, sfse_bench builds it to check the generated code and time it.
+
+typedef bool (* DispatchStubFn)(u32 type, void * data, u32 dataLen);
+
+size_t	GetDispatchStubSize(u32 numHandlers);	// upper bound
+size_t	BuildDispatchStub(const char * sender, const uintptr_t * handlers, u32 numHandlers, void * dst, size_t dstLen);
+
+enum
+{
+	kDispatchStubUnwindInfoSize = 12,
+};
+
+void	BuildDispatchStubUnwindInfo(void * dst);	// kDispatchStubUnwindInfoSize bytes, 4 byte aligned
@@ -0,0 +1,187 @@
+#include "sfse/FormIndex.h"
+#include "sfse_common/EditorIDMap.h"
+#include "sfse_common/PluginFileIndex.h"
+#include "sfse_common/ThreadPolicy.h"
+#include "sfse_common/Utilities.h"
+#include "sfse_common/Log.h"
+#include "sfse_common/sfse_version.h"
+#include <Windows.h>
+#include <ShlObj.h>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the runtime drops editor IDs for most form types once they're loaded, so the map is filled from the plugin
+// files themselves, and from anything plugins register as they see it. strings returned by
+// FormIndex_GetEditorID live as long as the process.
+
+static EditorIDMap s_editorIDs;
+static std::mutex s_editorIDLock;
+
+// the game's own masters load first whether or not they're listed, then the active entries of Plugins.txt
+static const char * kImplicitMasters[] =
+{
+	"Starfield.esm",
+	"Constellation.esm",
+	"OldMars.esm",
+	"BlueprintShips-Starfield.esm",
+};
+
+static void ReadLoadOrder(std::vector <std::string> * out)
+{
+	std::string dataPath = getRuntimeDirectory() + "Data\\";
+
+	auto addFile = [&](const std::string & name)
+	{
+		for(auto & existing : *out)
+			if(!_stricmp(existing.c_str(), name.c_str()))
+				return;
+
+		if(GetFileAttributesA((dataPath + name).c_str()) != INVALID_FILE_ATTRIBUTES)
+			out->push_back(name);
+	};
+
+	for(auto * name : kImplicitMasters)
+		addFile(name);
+
+	char appData[MAX_PATH];
+	if(FAILED(SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA, NULL, SHGFP_TYPE_CURRENT, appData)))
+		return;
+
+	std::ifstream pluginList(std::string(appData) + "\\" SAVE_FOLDER_NAME "\\Plugins.txt");
+	std::string line;
+
+	while(std::getline(pluginList, line))
+	{
+		while(!line.empty() && ((line.back() == '\r') || (line.back() == ' ')))
+			line.pop_back();
+
+		// active plugins are marked with a leading *
+		if((line.size() > 1) && (line[0] == '*'))
+			addFile(line.substr(1));
+	}
+}
+
+struct LoadedFile
+{
+	std::string	name;
+	u32			prefix;		// load order bits of its form IDs
+	bool		light;
+};
+
+static u32 MakeLoadOrderID(const LoadedFile & file, u32 formID)
+{
+	return file.light ? (file.prefix | (formID & 0xFFF)) : (file.prefix | (formID & 0xFFFFFF));
+}
+
+static void IndexLoadOrder()
+{
+	ThreadPolicy_ApplyToCurrentThread();
+
+	std::vector <std::string> loadOrder;
+	ReadLoadOrder(&loadOrder);
+
+	std::string dataPath = getRuntimeDirectory() + "Data\\";
+	std::vector <LoadedFile> loaded;
+	u32 numFull = 0;
+	u32 numLight = 0;
+	u32 numEditorIDs = 0;
+
+	loaded.reserve(loadOrder.size());	// masters are referenced by pointer
+
+	for(auto & name : loadOrder)
+	{
+		PluginFileIndex file;
+		if(!file.open((dataPath + name).c_str()))
+		{
+			_WARNING("couldn't index editor IDs in %s: %s at %016llX", name.c_str(), PluginFileIndex::getErrorName(file.error()), file.errorOffset());
+			continue;
+		}
+
+		LoadedFile self;
+		self.name = name;
+		self.light = (file.fileFlags() & PluginFileIndex::kFileFlag_Light) != 0;
+
+		if(self.light)
+		{
+			if(numLight >= 0x1000) continue;
+			self.prefix = 0xFE000000 | (numLight++ << 12);
+		}
+		else
+		{
+			if(numFull >= 0xFE) continue;
+			self.prefix = numFull++ << 24;
+		}
+
+		// the high byte of a form ID in the file indexes its master list, then the file itself
+		std::vector <const LoadedFile *> owners;
+
+		for(u32 i = 0; i < file.numMasters(); i++)
+		{
+			const LoadedFile * master = nullptr;
+
+			for(auto & candidate : loaded)
+				if(!_stricmp(candidate.name.c_str(), file.getMaster(i)))
+					master = &candidate;
+
+			owners.push_back(master);
+		}
+
+		loaded.push_back(self);
+		owners.push_back(&loaded.back());
+
+		std::lock_guard<std::mutex> lock(s_editorIDLock);
+
+		for(u32 i = 0; i < file.numRecords(); i++)
+		{
+			const PluginFileIndex::Record * record = file.getRecordByIndex(i);
+
+			const char * editorID = file.getEditorID(record->formID);
+			if(!editorID) continue;
+
+			// records of a master that isn't loaded don't exist in game either
+			u32 ownerIdx = record->formID >> 24;
+			const LoadedFile * owner = (ownerIdx < owners.size()) ? owners[ownerIdx] : owners.back();
+			if(!owner) continue;
+
+			s_editorIDs.add(MakeLoadOrderID(*owner, record->formID), editorID);
+			numEditorIDs++;
+		}
+	}
+
+	_MESSAGE("indexed %d editor IDs from %d plugin files", numEditorIDs, u32(loaded.size()));
+}
+
+void FormIndex_Init()
+{
+	u32 enable = 0;
+	if(!getConfigOption_u32("Forms", "bIndexEditorIDs", &enable) || !enable)
+		return;
+
+	// the files are only read, this can run alongside the game's own data load
+	std::thread(IndexLoadOrder).detach();
+}
+
+void FormIndex_AddEditorID(u32 formID, const char * editorID)
+{
+	std::lock_guard<std::mutex> lock(s_editorIDLock);
+
+	s_editorIDs.add(formID, editorID);
+}
+
+u32 FormIndex_LookupEditorID(const char * editorID)
+{
+	std::lock_guard<std::mutex> lock(s_editorIDLock);
+
+	return s_editorIDs.lookup(editorID);
+}
+
+const char * FormIndex_GetEditorID(u32 formID)
+{
+	std::lock_guard<std::mutex> lock(s_editorIDLock);
+
+	return s_editorIDs.getEditorID(formID);
+}
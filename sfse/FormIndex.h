@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+// SFSE-side indexes over game forms, shared with plugins through SFSEFormsInterface
+
+// editor IDs
+//
+// [Forms]
+// bIndexEditorIDs=1	read every editor ID in the load order's plugin files at startup, on a background thread
+void FormIndex_Init();
+void FormIndex_AddEditorID(u32 formID, const char * editorID);
+u32 FormIndex_LookupEditorID(const char * editorID);
+const char * FormIndex_GetEditorID(u32 formID);
@@ -1,18 +1,132 @@
 #include "sfse/GameConsole.h"
+#include "sfse_common/Metrics.h"
 #include <stdarg.h>
+#include <chrono>
+#include <mutex>
 
 RelocPtr <ConsoleLog*> g_console(0x058F7A90);
 
-void Console_Print(const char* fmt, ...)
+// Console_Print hands the line to VPrint right away, on the calling thread. batching needs a per-frame hook on
+// the main thread to drain a queue from, and there isn't one yet; a writer thread of our own would only add
+// another thread calling in to the console.
+//
+// what it does add is a rate limit, so a plugin dumping thousands of lines can't stall the console. after
+// kMaxLinesPerFrame lines in one kFrameMS window the rest of the window is dropped, and the count is printed
+// by the first Console_Print call after the window ends ("... 3,412 lines suppressed"). there's no timer, so the
+// summary can be late, and it never shows if nothing prints again; sfse.console.lines_dropped counts the lines
+// either way. lines are passed through unformatted, so their length is up to VPrint.
+//
+// [Console]
+// bNoRateLimit=1
+
+enum
 {
-	ConsoleLog* mgr = *g_console;
-	if (mgr)
+	kMaxLinesPerFrame = 128,
+	kFrameMS = 16,
+};
+
+static std::mutex							s_limitLock;
+static std::chrono::steady_clock::time_point	s_windowStart;
+static u32									s_windowLines = 0;
+static u32									s_suppressed = 0;
+
+// false if the line should be dropped. suppressed is set when a summary is due, whether or not the line is
+static bool AdmitLine(u32 * suppressed)
+{
+	static const bool unlimited = []()
+	{
+		u32 noRateLimit = 0;
+		return getConfigOption_u32("Console", "bNoRateLimit", &noRateLimit) && noRateLimit;
+	}();
+
+	static const u32 linesDropped = Metrics_Register("sfse.console.lines_dropped", kMetricType_Counter);
+
+	*suppressed = 0;
+
+	if(unlimited)
+		return true;
+
+	auto now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(s_limitLock);
+
+	if(now - s_windowStart >= std::chrono::milliseconds(kFrameMS))
 	{
-		va_list args;
-		va_start(args, fmt);
+		s_windowStart = now;
+		s_windowLines = 0;
+
+		// the summary is the new window's first line
+		if(s_suppressed)
+		{
+			*suppressed = s_suppressed;
+			s_suppressed = 0;
+			s_windowLines++;
+		}
+	}
 
-		CALL_MEMBER_FN(mgr, VPrint)(fmt, args);
+	if(s_windowLines >= kMaxLinesPerFrame)
+	{
+		s_suppressed++;
+		Metrics_Add(linesDropped);
 
-		va_end(args);
+		return false;
 	}
+
+	s_windowLines++;
+
+	return true;
+}
+
+static void ConsolePrint_Direct(ConsoleLog * mgr, const char * fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+
+	CALL_MEMBER_FN(mgr, VPrint)(fmt, args);
+
+	va_end(args);
+}
+
+static void PrintSuppressed(ConsoleLog * mgr, u32 suppressed)
+{
+	// group the count by thousands
+	char count[32];
+	char grouped[48];
+	int len = snprintf(count, sizeof(count), "%u", suppressed);
+	int out = 0;
+
+	for(int i = 0; i < len; i++)
+	{
+		if(i && !((len - i) % 3))
+			grouped[out++] = ',';
+
+		grouped[out++] = count[i];
+	}
+
+	grouped[out] = 0;
+
+	ConsolePrint_Direct(mgr, "... %s lines suppressed", grouped);
+}
+
+void Console_Print(const char* fmt, ...)
+{
+	ConsoleLog* mgr = *g_console;
+	if (!mgr)
+		return;
+
+	u32 suppressed;
+	bool admitted = AdmitLine(&suppressed);
+
+	if (suppressed)
+		PrintSuppressed(mgr, suppressed);
+
+	if (!admitted)
+		return;
+
+	va_list args;
+	va_start(args, fmt);
+
+	CALL_MEMBER_FN(mgr, VPrint)(fmt, args);
+
+	va_end(args);
 }
@@ -12,4 +12,4 @@ public:
 
 extern RelocPtr <ConsoleLog*> g_console;
 
-void Console_Print(const char* fmt, ...);
+void Console_Print(const char* fmt, ...);	// rate limited, see GameConsole.cpp
@@ -1,4 +1,9 @@
 #include "sfse/GameSettings.h"
+#include "sfse/HookCatalog.h"
+#include "sfse_common/SafeWrite.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 decltype(SettingT<INISettingCollection>::pCollection) SettingT<INISettingCollection>::pCollection(0x05913B98);
 decltype(SettingT<INIPrefSettingCollection>::pCollection) SettingT<INIPrefSettingCollection>::pCollection(0x05913BB8);
@@ -27,7 +32,17 @@ u32 Setting::GetType(void) const
 
 bool Setting::GetDouble(double* out) const
 {
-	switch (GetType())
+	return GetDouble(GetType(), out);
+}
+
+bool Setting::SetDouble(double value)
+{
+	return SetDouble(GetType(), value);
+}
+
+bool Setting::GetDouble(u32 type, double* out) const
+{
+	switch (type)
 	{
 	case kType_Integer:	*out = data.s32; break;
 	case kType_Float:	*out = data.f32; break;
@@ -42,9 +57,9 @@ bool Setting::GetDouble(double* out) const
 	return true;
 }
 
-bool Setting::SetDouble(double value)
+bool Setting::SetDouble(u32 type, double value)
 {
-	switch (GetType())
+	switch (type)
 	{
 	case kType_Integer:	data.s32 = static_cast<s32>(value); break;
 	case kType_Float:	data.f32 = static_cast<float>(value); break;
@@ -58,3 +73,298 @@ bool Setting::SetDouble(double value)
 
 	return true;
 }
+
+SettingsIndex g_settingsIndex;
+
+// in priority order
+static SettingCollection<Setting>* GetSettingCollection(u32 idx)
+{
+	switch (idx)
+	{
+	case 0:	return *SettingT<INIPrefSettingCollection>::pCollection;
+	case 1:	return *SettingT<INISettingCollection>::pCollection;
+	case 2:	return *SettingT<RegSettingCollection>::pCollection;
+	}
+
+	return nullptr;
+}
+
+enum
+{
+	kNumSettingCollections = 3
+};
+
+static const char kSettingCollection_HookName[] = "SettingCollection.AddRemove";
+
+typedef void (* _SettingCollection_Modify)(SettingCollection<Setting>* collection, Setting* setting);
+
+// INIPref derives from INI, so there are up to three distinct vtables
+struct SettingCollectionHook
+{
+	uintptr_t					* vtbl;
+	_SettingCollection_Modify	add;		// originals
+	_SettingCollection_Modify	remove;
+};
+
+static SettingCollectionHook s_collectionHooks[kNumSettingCollections];
+static u32 s_numCollectionHooks = 0;
+
+static const SettingCollectionHook* FindCollectionHook(SettingCollection<Setting>* collection)
+{
+	uintptr_t* vtbl = *(uintptr_t**)collection;
+
+	for (u32 i = 0; i < s_numCollectionHooks; i++)
+		if (s_collectionHooks[i].vtbl == vtbl)
+			return &s_collectionHooks[i];
+
+	return nullptr;
+}
+
+static void SettingCollection_Add_Hook(SettingCollection<Setting>* collection, Setting* setting)
+{
+	FindCollectionHook(collection)->add(collection, setting);
+
+	g_settingsIndex.onAdd(setting);
+}
+
+static void SettingCollection_Remove_Hook(SettingCollection<Setting>* collection, Setting* setting)
+{
+	FindCollectionHook(collection)->remove(collection, setting);
+
+	g_settingsIndex.onRemove(setting);
+}
+
+static bool SettingCollection_Install()
+{
+	// the collections are created during the game's startup, nothing to hook before that
+	for (u32 i = 0; i < kNumSettingCollections; i++)
+		if (!GetSettingCollection(i))
+			return false;
+
+	for (u32 i = 0; i < kNumSettingCollections; i++)
+	{
+		SettingCollection<Setting>* collection = GetSettingCollection(i);
+		if (FindCollectionHook(collection)) continue;
+
+		uintptr_t* vtbl = *(uintptr_t**)collection;
+
+		SettingCollectionHook& hook = s_collectionHooks[s_numCollectionHooks++];
+
+		hook.vtbl = vtbl;
+		hook.add = (_SettingCollection_Modify)vtbl[1];
+		hook.remove = (_SettingCollection_Modify)vtbl[2];
+
+		HookCatalog_AddSite(uintptr_t(&vtbl[1]), sizeof(uintptr_t) * 2);
+
+		safeWrite64(uintptr_t(&vtbl[1]), uintptr_t(SettingCollection_Add_Hook));
+		safeWrite64(uintptr_t(&vtbl[2]), uintptr_t(SettingCollection_Remove_Hook));
+	}
+
+	return true;
+}
+
+void SettingsIndex_Register()
+{
+	HookCatalog_Register(kSettingCollection_HookName, SettingCollection_Install);
+}
+
+size_t SettingsIndex::NameHash::operator()(const char* name) const
+{
+	// FNV-1a over the lowercased name
+	size_t hash = 14695981039346656037ULL;
+
+	for (; *name; ++name)
+	{
+		hash ^= (u8)tolower((u8)*name);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+bool SettingsIndex::NameEqual::operator()(const char* lhs, const char* rhs) const
+{
+	return _stricmp(lhs, rhs) == 0;
+}
+
+void SettingsIndex::addMissing(const char* name)
+{
+	if (m_missing.size() >= kMaxMissing)
+		clearMissing();
+
+	m_missing.insert(_strdup(name));
+}
+
+void SettingsIndex::clearMissing()
+{
+	for (const char* name : m_missing)
+		free((void*)name);
+
+	m_missing.clear();
+}
+
+void SettingsIndex::build()
+{
+	// without the hooks a removed setting would leave its name dangling in the index, retried until the
+	// collections exist
+	if (!m_hooked)
+		m_hooked = HookCatalog_Acquire(0, kSettingCollection_HookName);
+
+	m_entries.clear();
+	clearMissing();
+
+	for (u32 i = 0; i < kNumSettingCollections; i++)
+	{
+		SettingCollection<Setting>* collection = GetSettingCollection(i);
+		if (!collection) continue;
+
+		for (auto* node = &collection->SettingsA.node; node; node = node->m_pkNext)
+		{
+			Setting* setting = node->m_item;
+			if (!setting || !setting->name) continue;
+
+			// emplace keeps the first insert, which is the higher priority collection
+			Entry entry = { setting, setting->GetType() };
+			m_entries.emplace(setting->name, entry);
+		}
+	}
+
+	m_built = true;
+}
+
+SettingsIndex::Entry* SettingsIndex::find(const char* name)
+{
+	if (!name) return nullptr;
+
+	if (!m_built)
+		build();
+
+	auto iter = m_entries.find(name);
+	if (iter != m_entries.end())
+		return &iter->second;
+
+	if (m_missing.count(name))
+		return nullptr;
+
+	// registered after the index was built
+	for (u32 i = 0; i < kNumSettingCollections; i++)
+	{
+		SettingCollection<Setting>* collection = GetSettingCollection(i);
+		if (!collection) continue;
+
+		for (auto* node = &collection->SettingsA.node; node; node = node->m_pkNext)
+		{
+			Setting* setting = node->m_item;
+			if (setting && setting->name && !_stricmp(setting->name, name))
+			{
+				Entry entry = { setting, setting->GetType() };
+				return &m_entries.emplace(setting->name, entry).first->second;
+			}
+		}
+	}
+
+	// only an Add can make this name appear, and that clears it
+	if (m_hooked)
+		addMissing(name);
+
+	return nullptr;
+}
+
+Setting* SettingsIndex::lookup(const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	Entry* entry = find(name);
+	return entry ? entry->setting : nullptr;
+}
+
+bool SettingsIndex::getDouble(const char* name, double* out)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	Entry* entry = find(name);
+	return entry && entry->setting->GetDouble(entry->type, out);
+}
+
+bool SettingsIndex::setDouble(const char* name, double value)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	Entry* entry = find(name);
+	return entry && entry->setting->SetDouble(entry->type, value);
+}
+
+u32 SettingsIndex::getDoubles(Value* values, u32 count)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	u32 found = 0;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		Entry* entry = find(values[i].name);
+		if (entry && entry->setting->GetDouble(entry->type, &values[i].value))
+			found++;
+	}
+
+	return found;
+}
+
+u32 SettingsIndex::setDoubles(const Value* values, u32 count)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	u32 found = 0;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		Entry* entry = find(values[i].name);
+		if (entry && entry->setting->SetDouble(entry->type, values[i].value))
+			found++;
+	}
+
+	return found;
+}
+
+void SettingsIndex::rebuild()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	build();
+}
+
+void SettingsIndex::onAdd(Setting* setting)
+{
+	if (!setting || !setting->name) return;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_built) return;
+
+	// the new setting may shadow the indexed one, the next lookup walks the lists again
+	m_entries.erase(setting->name);
+
+	auto iter = m_missing.find(setting->name);
+	if (iter != m_missing.end())
+	{
+		const char* name = *iter;
+
+		m_missing.erase(iter);
+		free((void*)name);
+	}
+}
+
+void SettingsIndex::onRemove(Setting* setting)
+{
+	if (!setting || !setting->name) return;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if (!m_built) return;
+
+	// the key is the setting's own name, it mustn't outlive it. a lower priority setting with the same name
+	// is found again by the next lookup
+	auto iter = m_entries.find(setting->name);
+	if ((iter != m_entries.end()) && (iter->second.setting == setting))
+		m_entries.erase(iter);
+}
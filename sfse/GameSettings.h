@@ -3,6 +3,9 @@
 #include "sfse_common/Types.h"
 #include "sfse_common/Relocation.h"
 #include "sfse/GameTypes.h"
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 class Setting
 {
@@ -36,6 +39,8 @@ public:
 	u32	GetType(void) const;
 	bool GetDouble(double* out) const;
 	bool SetDouble(double value);
+	bool GetDouble(u32 type, double* out) const;	// type from a previous GetType
+	bool SetDouble(u32 type, double value);
 	bool SetString(const char* value);
 };
 
@@ -96,3 +101,77 @@ class SettingT
 public:
 	static RelocPtr<T*> pCollection;
 };
+
+// name -> setting index over the INIPref, INI and Reg collections
+//
+// the collections are plain linked lists, so the index is built from a single walk the first time it's used.
+// names are matched case-insensitively. settings registered after that are picked up by a fallback walk on
+// a miss. when a name exists in several collections, INIPref wins over INI, and INI over Reg.
+//
+// building the index also hooks the collections' Add and Remove, so a removed setting is dropped before its
+// name can dangle and an added one replaces whatever it shadows. names the walk didn't find are remembered
+// until the next Add or rebuild, so repeated lookups of a missing setting don't walk the lists every time.
+class SettingsIndex
+{
+public:
+	struct Value
+	{
+		const char	* name;
+		double		value;
+	};
+
+	Setting *	lookup(const char* name);
+	bool		getDouble(const char* name, double* out);
+	bool		setDouble(const char* name, double value);
+
+	// one lock for the whole batch, returns the number of values read or written. strings and unknown
+	// names are skipped
+	u32			getDoubles(Value* values, u32 count);
+	u32			setDoubles(const Value* values, u32 count);
+
+	void		rebuild();
+
+	// from the collection hooks
+	void		onAdd(Setting* setting);
+	void		onRemove(Setting* setting);
+
+private:
+	struct Entry
+	{
+		Setting	* setting;
+		u32		type;
+	};
+
+	struct NameHash
+	{
+		size_t operator()(const char* name) const;
+	};
+
+	struct NameEqual
+	{
+		bool operator()(const char* lhs, const char* rhs) const;
+	};
+
+	typedef std::unordered_map<const char*, Entry, NameHash, NameEqual> EntryMap;
+	typedef std::unordered_set<const char*, NameHash, NameEqual> NameSet;	// owns its strings
+
+	enum
+	{
+		kMaxMissing = 1024,	// forgotten all at once past this, a miss only costs one walk
+	};
+
+	void	build();
+	Entry *	find(const char* name);
+	void	addMissing(const char* name);
+	void	clearMissing();
+
+	std::mutex	m_lock;
+	EntryMap	m_entries;
+	NameSet		m_missing;
+	bool		m_built = false;
+	bool		m_hooked = false;
+};
+
+extern SettingsIndex g_settingsIndex;
+
+void SettingsIndex_Register();
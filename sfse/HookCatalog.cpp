@@ -0,0 +1,239 @@
+#include "sfse/HookCatalog.h"
+#include "sfse_common/SafeWrite.h"
+#include "sfse_common/Metrics.h"
+#include "sfse_common/Log.h"
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct HookSite
+{
+	uintptr_t			address;
+	std::vector <u8>	original;
+	std::vector <u8>	hooked;		// captured after install
+};
+
+struct HookEntry
+{
+	const char				* name;
+	HookCatalog_InstallFn	install;
+	bool					built;		// install has run, switching is byte swaps from here on
+	bool					active;
+	u32						refCount;
+	std::vector <HookSite>	sites;
+	std::unordered_map <PluginHandle, u32>	subscribers;
+};
+
+static std::mutex					s_lock;
+static std::vector <HookEntry *>	s_hooks;	// never freed, few and registered once
+static thread_local HookEntry		* s_installing = nullptr;
+
+static HookEntry * FindHook(const char * name)
+{
+	for(auto * hook : s_hooks)
+		if(!strcmp(hook->name, name))
+			return hook;
+
+	return nullptr;
+}
+
+static void UpdateActiveGauge()
+{
+	static const u32 activeHooks = Metrics_Register("sfse.hooks.active", kMetricType_Gauge);
+
+	s64 active = 0;
+	for(auto * hook : s_hooks)
+		active += hook->active ? 1 : 0;
+
+	Metrics_SetGauge(activeHooks, active);
+}
+
+static bool Activate(HookEntry & hook)
+{
+	if(!hook.built)
+	{
+		s_installing = &hook;
+		bool result = hook.install();
+		s_installing = nullptr;
+
+		if(!result)
+		{
+			// put back anything it got to before failing
+			for(auto & site : hook.sites)
+				safeWriteBuf(site.address, site.original.data(), site.original.size());
+
+			hook.sites.clear();
+
+			_ERROR("couldn't install hook %s", hook.name);
+			return false;
+		}
+
+		for(auto & site : hook.sites)
+			site.hooked.assign((const u8 *)site.address, (const u8 *)site.address + site.original.size());
+
+		hook.built = true;
+	}
+	else
+	{
+		for(auto & site : hook.sites)
+			safeWriteBuf(site.address, site.hooked.data(), site.hooked.size());
+	}
+
+	hook.active = true;
+
+	_MESSAGE("hook %s installed", hook.name);
+
+	return true;
+}
+
+static void Deactivate(HookEntry & hook)
+{
+	if(hook.sites.empty())
+		return;		// nothing recorded to put back, stays in
+
+	for(auto & site : hook.sites)
+		safeWriteBuf(site.address, site.original.data(), site.original.size());
+
+	hook.active = false;
+
+	_MESSAGE("hook %s removed", hook.name);
+}
+
+bool HookCatalog_Register(const char * name, HookCatalog_InstallFn install)
+{
+	if(!name || !install)
+		return false;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	if(FindHook(name))
+	{
+		_WARNING("hook %s registered twice", name);
+		return false;
+	}
+
+	HookEntry * hook = new HookEntry;
+
+	hook->name = name;
+	hook->install = install;
+	hook->built = false;
+	hook->active = false;
+	hook->refCount = 0;
+
+	s_hooks.push_back(hook);
+
+	return true;
+}
+
+void HookCatalog_AddSite(uintptr_t address, u32 length)
+{
+	HookEntry * hook = s_installing;
+	if(!hook)
+	{
+		_ERROR("HookCatalog_AddSite called outside of a hook's install function");
+		return;
+	}
+
+	// the same bytes patched twice keep the first original
+	for(auto & site : hook->sites)
+		if((site.address == address) && (site.original.size() == length))
+			return;
+
+	HookSite site;
+
+	site.address = address;
+	site.original.assign((const u8 *)address, (const u8 *)address + length);
+
+	hook->sites.push_back(std::move(site));
+}
+
+bool HookCatalog_Acquire(PluginHandle subscriber, const char * name)
+{
+	if(!name)
+		return false;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	HookEntry * hook = FindHook(name);
+	if(!hook)
+		return false;
+
+	if(!hook->active && !Activate(*hook))
+		return false;
+
+	hook->subscribers[subscriber]++;
+	hook->refCount++;
+
+	UpdateActiveGauge();
+
+	return true;
+}
+
+bool HookCatalog_Release(PluginHandle subscriber, const char * name)
+{
+	if(!name)
+		return false;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	HookEntry * hook = FindHook(name);
+	if(!hook)
+		return false;
+
+	auto iter = hook->subscribers.find(subscriber);
+	if(iter == hook->subscribers.end())
+		return false;
+
+	if(!--iter->second)
+		hook->subscribers.erase(iter);
+
+	if(!--hook->refCount)
+		Deactivate(*hook);
+
+	UpdateActiveGauge();
+
+	return true;
+}
+
+void HookCatalog_ReleaseAll(PluginHandle subscriber)
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	for(auto * hook : s_hooks)
+	{
+		auto iter = hook->subscribers.find(subscriber);
+		if(iter == hook->subscribers.end())
+			continue;
+
+		hook->refCount -= iter->second;
+		hook->subscribers.erase(iter);
+
+		if(!hook->refCount)
+			Deactivate(*hook);
+	}
+
+	UpdateActiveGauge();
+}
+
+bool HookCatalog_IsActive(const char * name)
+{
+	if(!name)
+		return false;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	HookEntry * hook = FindHook(name);
+
+	return hook && hook->active;
+}
+
+void HookCatalog_Report(HookCatalog_PrintFn print)
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	print("hook catalogue: %d hooks", u32(s_hooks.size()));
+
+	for(auto * hook : s_hooks)
+		print("%-32s %-9s %3d subscribers %3d sites", hook->name, hook->active ? "active" : "dormant", hook->refCount, u32(hook->sites.size()));
+}
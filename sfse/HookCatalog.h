@@ -0,0 +1,34 @@
+#pragma once
+
+#include "sfse/PluginAPI.h"
+#include "sfse_common/Types.h"
+
+// hooks that are registered up front but only installed while something needs them
+//
+// each hook is registered by name with an install function and stays dormant until its first subscriber
+// acquires it. SFSE acquires the hooks behind its own features with handle 0, plugins through
+// SFSEHooksInterface, and future event/interface code when the first sink registers. the hook is removed again
+// when the last subscriber releases it, so unused features cost nothing at runtime.
+//
+// install runs once, and calls HookCatalog_AddSite for every address before patching it. the catalogue saves the
+// original bytes there and the hooked bytes after install returns, so removing and reinstalling later is just
+// swapping bytes: no trampoline space is allocated again. a hook that registers no sites can't be removed and
+// stays installed once acquired.
+//
+// patching isn't atomic with respect to threads running the patched code, same as installing any hook after
+// startup. acquire and release from init, load messages or the game's main thread.
+
+typedef bool (* HookCatalog_InstallFn)();
+
+// name must stay valid for the life of the process
+bool HookCatalog_Register(const char * name, HookCatalog_InstallFn install);
+void HookCatalog_AddSite(uintptr_t address, u32 length);	// only from an install function
+
+// subscriber 0 is SFSE itself. acquires are counted, each needs a matching release
+bool HookCatalog_Acquire(PluginHandle subscriber, const char * name);
+bool HookCatalog_Release(PluginHandle subscriber, const char * name);
+void HookCatalog_ReleaseAll(PluginHandle subscriber);
+bool HookCatalog_IsActive(const char * name);
+
+typedef void (* HookCatalog_PrintFn)(const char * fmt, ...);
+void HookCatalog_Report(HookCatalog_PrintFn print);
@@ -0,0 +1,331 @@
+#include "Hooks_Memory.h"
+#include "sfse_common/SlabHeap.h"
+#include "sfse_common/BranchTrampoline.h"
+#include "sfse_common/Utilities.h"
+#include "sfse_common/Log.h"
+#include <Windows.h>
+#include <cerrno>
+#include <cstring>
+#include <malloc.h>
+#include <new.h>
+
+// opt-in replacement for the CRT heap
+//
+// small blocks are served by a thread-caching slab heap bound to its own reserved arena. large blocks, and
+// anything allocated before the hooks went in, stay on the CRT's Win32 heap. the arena range check in
+// contains() is what decides where a pointer gets freed.
+//
+// the heap entry points are patched inside ucrtbase itself rather than in one module's IAT, so the game, its
+// DLLs, plugins, msvcp140 and ucrtbase's own internal callers all agree on where a pointer came from. that
+// covers every module sharing the dynamic CRT. modules with a static CRT have their own heap and can't
+// legitimately free these pointers anyway. the _aligned_* functions are left alone, they wrap malloc and free
+// inside ucrtbase and only take back blocks they allocated themselves.
+//
+// the patched functions don't call back in to ucrtbase for the non-arena path (that would need relocated
+// copies of each prologue), they go straight to the CRT's Win32 heap the same way ucrtbase does.
+//
+// [Memory]
+// bReplaceGameHeap=1
+// uArenaSizeMB=16384	address space reserved for slabs, committed on demand
+// uLargePageMB=0		if non-zero, back this many MB with large pages (needs SeLockMemoryPrivilege)
+
+static SlabHeap s_gameHeap(false);	// owner tracking would put a shared atomic on every game allocation
+static bool s_gameHeapActive = false;
+
+static HANDLE s_crtHeap = nullptr;
+static BranchTrampoline s_crtTrampoline;	// near ucrtbase so the patches are 5 byte jumps
+
+// the CRT's own behavior for the non-arena path: the new handler is retried when _set_new_mode(1) asks for it
+static void * CRTHeap_Allocate(size_t size, DWORD flags)
+{
+	if(size > _HEAP_MAXREQ)
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	if(!size)
+		size = 1;
+
+	for(;;)
+	{
+		void * result = HeapAlloc(s_crtHeap, flags, size);
+		if(result)
+			return result;
+
+		if(!_query_new_mode() || !_callnewh(size))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+	}
+}
+
+static void * CRTHeap_Reallocate(void * ptr, size_t size)
+{
+	if(size > _HEAP_MAXREQ)
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	for(;;)
+	{
+		void * result = HeapReAlloc(s_crtHeap, 0, ptr, size);
+		if(result)
+			return result;
+
+		if(!_query_new_mode() || !_callnewh(size))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+	}
+}
+
+static void * malloc_Hook(size_t size)
+{
+	if(size <= SlabHeap::kSmallMax)
+	{
+		void * result = s_gameHeap.allocate(size);
+		if(result)
+			return result;
+	}
+
+	return CRTHeap_Allocate(size, 0);
+}
+
+static void * calloc_Hook(size_t num, size_t size)
+{
+	size_t total = num * size;
+	if(size && (total / size != num))
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	if(total <= SlabHeap::kSmallMax)
+	{
+		void * result = s_gameHeap.allocate(total);
+		if(result)
+		{
+			memset(result, 0, total);
+			return result;
+		}
+	}
+
+	return CRTHeap_Allocate(total, HEAP_ZERO_MEMORY);
+}
+
+static void free_Hook(void * ptr)
+{
+	if(!ptr)
+		return;
+
+	if(s_gameHeap.contains(ptr))
+		s_gameHeap.free(ptr);
+	else
+		HeapFree(s_crtHeap, 0, ptr);
+}
+
+static size_t msize_Hook(void * ptr)
+{
+	if(!ptr)
+	{
+		errno = EINVAL;
+		return size_t(-1);
+	}
+
+	if(s_gameHeap.contains(ptr))
+		return s_gameHeap.usableSize(ptr);
+
+	return HeapSize(s_crtHeap, 0, ptr);
+}
+
+static void * realloc_Hook(void * ptr, size_t size)
+{
+	if(!ptr)
+		return malloc_Hook(size);
+
+	if(!size)
+	{
+		free_Hook(ptr);
+		return nullptr;
+	}
+
+	if(!s_gameHeap.contains(ptr))
+		return CRTHeap_Reallocate(ptr, size);
+
+	size_t oldSize = s_gameHeap.usableSize(ptr);
+
+	// still fits and isn't wasting more than half the block
+	if((size <= oldSize) && (size > (oldSize >> 1)))
+		return ptr;
+
+	void * result = malloc_Hook(size);
+	if(result)
+	{
+		memcpy(result, ptr, (size < oldSize) ? size : oldSize);
+		s_gameHeap.free(ptr);
+	}
+
+	return result;
+}
+
+// realloc, then zero whatever the block grew by
+static void * recalloc_Hook(void * ptr, size_t num, size_t size)
+{
+	size_t total = num * size;
+	if(size && (total / size != num))
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	size_t oldSize = ptr ? msize_Hook(ptr) : 0;
+
+	void * result = realloc_Hook(ptr, total);
+	if(result)
+	{
+		size_t newSize = msize_Hook(result);
+		if(newSize > oldSize)
+			memset(((u8 *)result) + oldSize, 0, newSize - oldSize);
+	}
+
+	return result;
+}
+
+static void * expand_Hook(void * ptr, size_t size)
+{
+	if(!ptr)
+	{
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	if(size > _HEAP_MAXREQ)
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	if(s_gameHeap.contains(ptr))
+	{
+		// slab objects can't grow past their size class
+		if(size <= s_gameHeap.usableSize(ptr))
+			return ptr;
+
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	void * result = HeapReAlloc(s_crtHeap, HEAP_REALLOC_IN_PLACE_ONLY, ptr, size ? size : 1);
+	if(!result)
+		errno = ENOMEM;
+
+	return result;
+}
+
+struct CRTHeapPatch
+{
+	const char	* name;
+	uintptr_t	hook;
+};
+
+// everything that can free, resize or size a block goes in before anything can hand out an arena pointer
+static const CRTHeapPatch kCRTHeapPatches[] =
+{
+	{ "free",			uintptr_t(free_Hook) },
+	{ "_free_base",		uintptr_t(free_Hook) },
+	{ "_msize",			uintptr_t(msize_Hook) },
+	{ "realloc",		uintptr_t(realloc_Hook) },
+	{ "_realloc_base",	uintptr_t(realloc_Hook) },
+	{ "_recalloc",		uintptr_t(recalloc_Hook) },
+	{ "_expand",		uintptr_t(expand_Hook) },
+
+	{ "malloc",			uintptr_t(malloc_Hook) },
+	{ "_malloc_base",	uintptr_t(malloc_Hook) },
+	{ "calloc",			uintptr_t(calloc_Hook) },
+	{ "_calloc_base",	uintptr_t(calloc_Hook) },
+};
+
+void Hooks_Memory_Apply()
+{
+	u32 enable = 0;
+	if(!getConfigOption_u32("Memory", "bReplaceGameHeap", &enable) || !enable)
+		return;
+
+	u32 arenaMB = 16 * 1024;
+	u32 largePageMB = 0;
+
+	getConfigOption_u32("Memory", "uArenaSizeMB", &arenaMB);
+	getConfigOption_u32("Memory", "uLargePageMB", &largePageMB);
+
+	HMODULE ucrt = GetModuleHandleA("ucrtbase.dll");
+	if(!ucrt)
+	{
+		_ERROR("ucrtbase.dll isn't loaded, leaving the CRT heap in place");
+		return;
+	}
+
+	// find every entry point before touching any of them, a partial set would mix up the heaps
+	uintptr_t targets[_countof(kCRTHeapPatches)];
+
+	for(u32 i = 0; i < _countof(kCRTHeapPatches); i++)
+	{
+		targets[i] = uintptr_t(GetProcAddress(ucrt, kCRTHeapPatches[i].name));
+		if(!targets[i])
+		{
+			_ERROR("couldn't find ucrtbase!%s, leaving the CRT heap in place", kCRTHeapPatches[i].name);
+			return;
+		}
+	}
+
+	// the same heap ucrtbase allocates from, so blocks from before the patches free correctly
+	s_crtHeap = (HANDLE)_get_heap_handle();
+
+	if(!s_crtTrampoline.create(1024 * 64, ucrt))
+	{
+		_ERROR("couldn't create trampoline near ucrtbase, leaving the CRT heap in place");
+		return;
+	}
+
+	if(!s_gameHeap.initArena(u64(arenaMB) << 20, u64(largePageMB) << 20))
+	{
+		_ERROR("couldn't create game heap arena, leaving the CRT heap in place");
+		return;
+	}
+
+	u32 numPatched = 0;
+
+	for(; numPatched < _countof(kCRTHeapPatches); numPatched++)
+	{
+		// stop at the first failure so nothing hands out arena pointers without every free path in place
+		if(!s_crtTrampoline.write5Branch(targets[numPatched], kCRTHeapPatches[numPatched].hook))
+			break;
+	}
+
+	if(numPatched < _countof(kCRTHeapPatches))
+	{
+		// the patches can't be taken back safely, blocks may already have gone through them
+		_ERROR("couldn't patch ucrtbase!%s, game heap not replaced", kCRTHeapPatches[numPatched].name);
+
+		for(u32 i = 0; i < numPatched; i++)
+			_ERROR("ucrtbase!%s stays patched", kCRTHeapPatches[i].name);
+
+		return;
+	}
+
+	s_gameHeapActive = true;
+
+	_MESSAGE("game heap replaced (%d MB arena, %d MB large pages)", arenaMB, largePageMB);
+}
+
+void Hooks_Memory_Report(Hooks_Memory_PrintFn print)
+{
+	if(!s_gameHeapActive)
+		return;
+
+	print("game heap:");
+	s_gameHeap.report(print);
+}
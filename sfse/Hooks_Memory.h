@@ -0,0 +1,6 @@
+#pragma once
+
+void Hooks_Memory_Apply();
+
+typedef void (* Hooks_Memory_PrintFn)(const char * fmt, ...);
+void Hooks_Memory_Report(Hooks_Memory_PrintFn print);	// per size class, nothing if the heap isn't replaced
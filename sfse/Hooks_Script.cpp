@@ -1,11 +1,16 @@
 #include "Hooks_Script.h"
+#include "sfse/HookCatalog.h"
 #include "sfse/GameConsole.h"
 #include "sfse/GameScript.h"
 #include "sfse/GameReferences.h"
+#include "sfse/PluginMemoryStats.h"
+#include "sfse/Hooks_Memory.h"
+#include "sfse/PapyrusProfiler.h"
 #include "sfse_common/SafeWrite.h"
 #include "sfse_common/sfse_version.h"
 #include "sfse_common/BranchTrampoline.h"
 #include "sfse_common/Relocation.h"
+#include "sfse_common/Utilities.h"
 #include "sfse_common/Log.h"
 #include "xbyak/xbyak.h"
 
@@ -20,6 +25,65 @@ bool GetSFSEVersion_Execute(const SCRIPT_PARAMETER* paramInfo, const char*, TESO
 	return true;
 }
 
+static void PrintToConsoleAndLog(const char * fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	DebugLog::log(DebugLog::kLevel_Message, fmt, args);
+	va_end(args);
+
+	va_start(args, fmt);
+	char buf[1024];
+	vsprintf_s(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+	Console_Print("%s", buf);
+}
+
+bool SFSEReport_Execute(const SCRIPT_PARAMETER* paramInfo, const char*, TESObjectREFR* thisObj, TESObjectREFR* containingObj, Script* script, ScriptLocals* locals, float* result, u32* opcodeOffsetPtr)
+{
+	PluginMemoryStats_Report(PrintToConsoleAndLog);
+	Hooks_Memory_Report(PrintToConsoleAndLog);
+
+	if (HookCatalog_IsActive(kPapyrusProfiler_HookName))
+		PapyrusProfiler_Report(0, PrintToConsoleAndLog);
+
+	return true;
+}
+
+bool SFSEProfileReset_Execute(const SCRIPT_PARAMETER* paramInfo, const char*, TESObjectREFR* thisObj, TESObjectREFR* containingObj, Script* script, ScriptLocals* locals, float* result, u32* opcodeOffsetPtr)
+{
+	PapyrusProfiler_Reset();
+
+	PrintToConsoleAndLog("papyrus native call profile reset");
+
+	return true;
+}
+
+struct ConsoleCommandReplacement
+{
+	const char		* replacedName;	// unused developer command to take over
+	const char		* configKey;	// if set, [Console] option naming the command to take over instead, unset leaves it out
+	const char		* name;
+	const char		* shortName;
+	const char		* helpString;
+	ExecuteFunction	execute;
+};
+
+// only SFSE's own command gets a fixed slot. other developer commands may already be claimed by other mods, so
+// anything else takes over whichever one the user names in sfse.ini:
+//
+// [Console]
+// sReportCommand=TestCode
+// sProfileResetCommand=<another unused command>
+static const ConsoleCommandReplacement kConsoleCommands[] =
+{
+	{ "BetaComment",	nullptr,					"GetSFSEVersion",		"",	"",												GetSFSEVersion_Execute },
+	{ nullptr,			"sReportCommand",			"SFSEReport",			"",	"SFSE plugin memory, heap and papyrus reports",	SFSEReport_Execute },
+	{ nullptr,			"sProfileResetCommand",		"SFSEProfileReset",		"",	"reset the papyrus native call profile",		SFSEProfileReset_Execute },
+};
+
 typedef bool (*_ConsoleCommandInit)(void* unk1);
 RelocAddr <_ConsoleCommandInit> ConsoleCommandInit(0x01AEB870);
 _ConsoleCommandInit ConsoleCommandInit_Original = nullptr;
@@ -28,25 +92,39 @@ void ConsoleCommandInit_Hook(void* unk1)
 {
 	ConsoleCommandInit_Original(unk1);
 
-	for (Script::SCRIPT_FUNCTION* iter = g_firstConsoleCommand; iter->eOutput < (Script::kScript_NumConsoleCommands + Script::kScript_ConsoleOpBase); ++iter)
+	for (auto& replacement : kConsoleCommands)
 	{
-		if (!strcmp(iter->pFunctionName, "BetaComment"))
+		std::string replacedName = replacement.configKey ? getConfigOption("Console", replacement.configKey) : replacement.replacedName;
+		if (replacedName.empty())
+			continue;
+
+		bool found = false;
+
+		for (Script::SCRIPT_FUNCTION* iter = g_firstConsoleCommand; iter->eOutput < (Script::kScript_NumConsoleCommands + Script::kScript_ConsoleOpBase); ++iter)
 		{
-			Script::SCRIPT_FUNCTION& cmd = *iter;
-			cmd.pFunctionName = "GetSFSEVersion";
-			cmd.pShortName = "";
-			cmd.pHelpString = "";
-			cmd.bReferenceFunction = 0;
-			cmd.sParamCount = 0;
-			cmd.pExecuteFunction = GetSFSEVersion_Execute;
-			cmd.bEditorFilter = 0;
-			cmd.bInvalidatesCellList = 0;
-			break;
+			if (!_stricmp(iter->pFunctionName, replacedName.c_str()))
+			{
+				Script::SCRIPT_FUNCTION& cmd = *iter;
+				cmd.pFunctionName = replacement.name;
+				cmd.pShortName = replacement.shortName;
+				cmd.pHelpString = replacement.helpString;
+				cmd.bReferenceFunction = 0;
+				cmd.sParamCount = 0;
+				cmd.pExecuteFunction = replacement.execute;
+				cmd.bEditorFilter = 0;
+				cmd.bInvalidatesCellList = 0;
+
+				found = true;
+				break;
+			}
 		}
+
+		if (!found)
+			_WARNING("couldn't find console command %s to replace with %s", replacedName.c_str(), replacement.name);
 	}
 }
 
-void Hooks_Script_Apply()
+static bool ConsoleCommandInit_Install()
 {
 	{
 		struct ConsoleCommandInit_Code : Xbyak::CodeGenerator {
@@ -70,6 +148,21 @@ void Hooks_Script_Apply()
 
 		ConsoleCommandInit_Original = (_ConsoleCommandInit)codeBuf;
 
+		HookCatalog_AddSite(ConsoleCommandInit.getUIntPtr(), 6);
+
 		g_branchTrampoline.write6Branch(ConsoleCommandInit.getUIntPtr(), (uintptr_t)ConsoleCommandInit_Hook);
 	}
+
+	return true;
+}
+
+void Hooks_Script_Register()
+{
+	HookCatalog_Register("ConsoleCommandInit", ConsoleCommandInit_Install);
+}
+
+void Hooks_Script_Apply()
+{
+	// SFSE's console commands
+	HookCatalog_Acquire(0, "ConsoleCommandInit");
 }
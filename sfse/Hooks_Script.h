@@ -1,3 +1,4 @@
 #pragma once
 
+void Hooks_Script_Register();
 void Hooks_Script_Apply();
@@ -1,4 +1,5 @@
 #include "Hooks_Version.h"
+#include "sfse/HookCatalog.h"
 #include "sfse_common/SafeWrite.h"
 #include "sfse_common/sfse_version.h"
 #include "sfse_common/Errors.h"
@@ -13,9 +14,9 @@ const char * kHook_ShowVersion_FormatString =
 	__PREPRO_TOKEN_STR__(SFSE_VERSION_INTEGER_BETA) "]";
 RelocAddr <uintptr_t> kHook_ShowVersion_Offset(0x02079A4D);
 
-void Hooks_Version_Apply()
+// show SFSE version in menu
+static bool ShowVersion_Install()
 {
-	// show SFSE version in menu
 	{
 		struct ShowVersion_Code: Xbyak::CodeGenerator {
 			ShowVersion_Code(void * buf) : Xbyak::CodeGenerator(4096, buf)
@@ -38,7 +39,21 @@ void Hooks_Version_Apply()
 		ShowVersion_Code code(codeBuf);
 		g_localTrampoline.endAlloc(code.getCurr());
 
+		HookCatalog_AddSite(kHook_ShowVersion_Offset.getUIntPtr(), 7);
+
 		g_branchTrampoline.write6Branch(kHook_ShowVersion_Offset.getUIntPtr(), uintptr_t(code.getCode()));
 		safeWrite8(kHook_ShowVersion_Offset.getUIntPtr() + 6, 0x90);
 	}
+
+	return true;
+}
+
+void Hooks_Version_Register()
+{
+	HookCatalog_Register("ShowVersion", ShowVersion_Install);
+}
+
+void Hooks_Version_Apply()
+{
+	HookCatalog_Acquire(0, "ShowVersion");
 }
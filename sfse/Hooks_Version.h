@@ -1,3 +1,4 @@
 #pragma once
 
+void Hooks_Version_Register();
 void Hooks_Version_Apply();
@@ -0,0 +1,381 @@
+#include "sfse/PapyrusProfiler.h"
+#include "sfse/HookCatalog.h"
+#include "sfse/GameTypes.h"
+#include "sfse_common/Relocation.h"
+#include "sfse_common/SafeWrite.h"
+#include "sfse_common/Utilities.h"
+#include "sfse_common/Log.h"
+#include "sfse_common/Metrics.h"
+#include "sfse_common/ThreadPolicy.h"
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum
+{
+	kTableSize = 2048,		// functions per thread, must be a power of two
+	kInvokeSlot = 0x0F,		// IFunction::Invoke
+};
+
+// written only by the owning thread, read by the reporter
+struct ThreadCallCounters
+{
+	struct Entry
+	{
+		std::atomic <const void *>	className;	// published last
+		std::atomic <const void *>	name;
+		std::atomic <u64>			calls;
+		std::atomic <u64>			ticks;
+	};
+
+	Entry	entries[kTableSize];
+	Entry	overflow;		// everything past a full table
+
+	ThreadCallCounters();
+	~ThreadCallCounters();
+};
+
+struct CallTotals
+{
+	u64	calls = 0;
+	u64	ticks = 0;
+};
+
+typedef std::pair <const void *, const void *>	FunctionKey;	// class, name
+
+static std::mutex							s_countersLock;
+static std::vector <ThreadCallCounters *>	s_threadCounters;
+static std::map <FunctionKey, CallTotals>	s_retiredCounters;	// from exited threads
+
+class VMClassRegistry;
+class VMState;
+
+// the name fields of NativeFunctionBase, PapyrusNativeFunctions.h can't be included by a translation unit yet
+struct NativeFunctionNames
+{
+	void					* vtbl;			// 00
+	u64						refCount;		// 08
+	BSStringPool::Entry		* name;			// 10
+	BSStringPool::Entry		* className;	// 18
+};
+
+typedef u32 (* _Invoke)(NativeFunctionNames * fn, u64 unk0, u64 unk1, VMClassRegistry * registry, VMState * state);
+RelocAddr <_Invoke> NativeFunctionBase_Invoke(0x03076F64);	// NativeFunctionBase::Impl_Invoke
+static _Invoke	s_originalInvoke = nullptr;
+
+static s32	s_enabled = -1;
+static u32	s_reportCount = 25;
+
+// stands in for a null class name, a null className is what marks an empty slot
+static const char	s_noClassName = 0;
+
+static void ResetEntry(ThreadCallCounters::Entry & entry)
+{
+	entry.className = nullptr;
+	entry.name = nullptr;
+	entry.calls = 0;
+	entry.ticks = 0;
+}
+
+ThreadCallCounters::ThreadCallCounters()
+{
+	for(auto & entry : entries)
+		ResetEntry(entry);
+
+	ResetEntry(overflow);
+
+	std::lock_guard <std::mutex> locker(s_countersLock);
+	s_threadCounters.push_back(this);
+}
+
+static void AddEntry(std::map <FunctionKey, CallTotals> & totals, const ThreadCallCounters::Entry & entry)
+{
+	const void * className = entry.className.load(std::memory_order_acquire);
+	u64 calls = entry.calls.load(std::memory_order_relaxed);
+
+	if(!calls)
+		return;
+
+	CallTotals & total = totals[FunctionKey(className, entry.name.load(std::memory_order_relaxed))];
+	total.calls += calls;
+	total.ticks += entry.ticks.load(std::memory_order_relaxed);
+}
+
+ThreadCallCounters::~ThreadCallCounters()
+{
+	std::lock_guard <std::mutex> locker(s_countersLock);
+
+	for(auto & entry : entries)
+		AddEntry(s_retiredCounters, entry);
+
+	AddEntry(s_retiredCounters, overflow);
+
+	for(auto iter = s_threadCounters.begin(); iter != s_threadCounters.end(); ++iter)
+	{
+		if(*iter == this)
+		{
+			s_threadCounters.erase(iter);
+			break;
+		}
+	}
+}
+
+// single writer, so no interlocked ops needed
+static inline void Bump(std::atomic <u64> & counter, u64 amount)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void RecordCall(const void * className, const void * name, u64 ticks)
+{
+	static thread_local ThreadCallCounters s_counters;
+
+	if(!className)
+		className = &s_noClassName;
+
+	uintptr_t hash = (uintptr_t(className) * 31) ^ uintptr_t(name);
+	hash ^= hash >> 17;
+
+	for(u32 i = 0; i < kTableSize; i++)
+	{
+		ThreadCallCounters::Entry & entry = s_counters.entries[(hash + i) & (kTableSize - 1)];
+		const void * entryClass = entry.className.load(std::memory_order_relaxed);
+
+		if(!entryClass)
+		{
+			entry.name.store(name, std::memory_order_relaxed);
+			entry.className.store(className, std::memory_order_release);
+		}
+		else if((entryClass != className) || (entry.name.load(std::memory_order_relaxed) != name))
+		{
+			continue;
+		}
+
+		Bump(entry.calls, 1);
+		Bump(entry.ticks, ticks);
+		return;
+	}
+
+	Bump(s_counters.overflow.calls, 1);
+	Bump(s_counters.overflow.ticks, ticks);
+}
+
+static void PrintToLog(const char * fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	DebugLog::log(DebugLog::kLevel_Message, fmt, args);
+	va_end(args);
+}
+
+static u32 ProfiledInvoke(NativeFunctionNames * fn, u64 unk0, u64 unk1, VMClassRegistry * registry, VMState * state)
+{
+	static const u32 hookCalls = Metrics_Register("sfse.hooks.papyrus_native_calls", kMetricType_Counter);
+
+	LARGE_INTEGER start, end;
+
+	Metrics_Add(hookCalls);
+
+	QueryPerformanceCounter(&start);
+	u32 result = s_originalInvoke(fn, unk0, unk1, registry, state);
+	QueryPerformanceCounter(&end);
+
+	// names are pooled, so the entry pointers identify the function
+	RecordCall(fn->className, fn->name, end.QuadPart - start.QuadPart);
+
+	return result;
+}
+
+bool PapyrusProfiler_IsEnabled()
+{
+	if(s_enabled < 0)
+	{
+		u32 enable = 0;
+		s_enabled = (getConfigOption_u32("Papyrus", "bProfileNativeCalls", &enable) && enable) ? 1 : 0;
+	}
+
+	return s_enabled != 0;
+}
+
+// same layout as the MSVC complete object locator
+struct RTTILocator
+{
+	u32 sig, offset, cdOffset;
+	u32 typeDesc;
+	u32 classDesc;
+};
+
+static bool NativeInvoke_Install()
+{
+	const u8 * base = (const u8 *)GetModuleHandle(nullptr);
+	auto * dosHeader = (const IMAGE_DOS_HEADER *)base;
+	auto * ntHeader = (const IMAGE_NT_HEADERS *)(base + dosHeader->e_lfanew);
+	auto * section = IMAGE_FIRST_SECTION(ntHeader);
+	const u64 imageSize = ntHeader->OptionalHeader.SizeOfImage;
+
+	const uintptr_t invokeAddr = NativeFunctionBase_Invoke.getUIntPtr();
+	s_originalInvoke = NativeFunctionBase_Invoke;
+
+	u32 numPatched = 0;
+
+	for(u32 i = 0; i < ntHeader->FileHeader.NumberOfSections; i++, section++)
+	{
+		if(strncmp((const char *)section->Name, ".rdata", 8))
+			continue;
+
+		auto * slots = (uintptr_t *)(base + section->VirtualAddress);
+		u64 numSlots = section->Misc.VirtualSize / sizeof(uintptr_t);
+
+		// every vtable that still uses the base Invoke, confirmed through RTTI so a stray matching constant
+		// doesn't get overwritten
+		for(u64 slot = kInvokeSlot + 1; slot < numSlots; slot++)
+		{
+			if(slots[slot] != invokeAddr)
+				continue;
+
+			uintptr_t locatorAddr = slots[slot - kInvokeSlot - 1];
+			if((locatorAddr < uintptr_t(base)) || (locatorAddr >= uintptr_t(base) + imageSize - sizeof(RTTILocator)))
+				continue;
+
+			auto * locator = (const RTTILocator *)locatorAddr;
+			if((locator->sig != 1) || (locator->typeDesc >= imageSize))
+				continue;
+
+			const char * typeName = (const char *)(base + locator->typeDesc + 0x10);
+			if(!strstr(typeName, "NativeFunction"))
+				continue;
+
+			HookCatalog_AddSite(uintptr_t(&slots[slot]), sizeof(uintptr_t));
+
+			safeWrite64(uintptr_t(&slots[slot]), uintptr_t(ProfiledInvoke));
+			numPatched++;
+		}
+	}
+
+	_MESSAGE("%d papyrus native function vtables patched", numPatched);
+
+	return numPatched != 0;
+}
+
+void PapyrusProfiler_Register()
+{
+	HookCatalog_Register(kPapyrusProfiler_HookName, NativeInvoke_Install);
+}
+
+void PapyrusProfiler_Install()
+{
+	if(!PapyrusProfiler_IsEnabled())
+		return;
+
+	if(!HookCatalog_Acquire(0, kPapyrusProfiler_HookName))
+		return;
+
+	u32 seconds = 60;
+	getConfigOption_u32("Papyrus", "uProfileReportSeconds", &seconds);
+	getConfigOption_u32("Papyrus", "uProfileReportCount", &s_reportCount);
+
+	// merging every thread's table takes a while, keep it off the VM threads. runs for the life of the process
+	if(seconds)
+	{
+		std::thread([seconds]()
+		{
+			ThreadPolicy_ApplyToCurrentThread();
+
+			for(;;)
+			{
+				std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+				if(HookCatalog_IsActive(kPapyrusProfiler_HookName))
+					PapyrusProfiler_Report(0, PrintToLog);
+			}
+		}).detach();
+	}
+
+	_MESSAGE("profiling papyrus native calls");
+}
+
+void PapyrusProfiler_Report(u32 maxFunctions, PapyrusProfiler_PrintFn print)
+{
+	if(!HookCatalog_IsActive(kPapyrusProfiler_HookName))
+	{
+		print("papyrus native call profiling is disabled (sfse.ini [Papyrus] bProfileNativeCalls=1)");
+		return;
+	}
+
+	if(!maxFunctions)
+		maxFunctions = s_reportCount;
+
+	std::map <FunctionKey, CallTotals> totals;
+
+	{
+		std::lock_guard <std::mutex> locker(s_countersLock);
+
+		totals = s_retiredCounters;
+
+		for(auto * thread : s_threadCounters)
+		{
+			for(auto & entry : thread->entries)
+				AddEntry(totals, entry);
+
+			AddEntry(totals, thread->overflow);
+		}
+	}
+
+	std::vector <std::pair <FunctionKey, CallTotals>> sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair <FunctionKey, CallTotals> & lhs, const std::pair <FunctionKey, CallTotals> & rhs) {
+		return lhs.second.ticks > rhs.second.ticks;
+	});
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	double msPerTick = 1000.0 / frequency.QuadPart;
+
+	print("papyrus native calls, top %d of %d by inclusive time:", maxFunctions, u32(sorted.size()));
+
+	for(u32 i = 0; (i < sorted.size()) && (i < maxFunctions); i++)
+	{
+		auto * className = (BSStringPool::Entry *)sorted[i].first.first;
+		auto * name = (BSStringPool::Entry *)sorted[i].first.second;
+		const CallTotals & total = sorted[i].second;
+
+		double ms = total.ticks * msPerTick;
+
+		const char * classNameStr = "<other>";
+		if(sorted[i].first.first == &s_noClassName)
+			classNameStr = "<none>";
+		else if(className)
+			classNameStr = className->GetStringC();
+
+		print("%s.%s: %I64u calls, %.3f ms, %.3f us/call",
+			classNameStr,
+			name ? name->GetStringC() : "<other>",
+			total.calls, ms, (ms * 1000.0) / total.calls);
+	}
+}
+
+void PapyrusProfiler_Reset()
+{
+	std::lock_guard <std::mutex> locker(s_countersLock);
+
+	s_retiredCounters.clear();
+
+	// owners may be mid-update, a count or two can survive the reset
+	for(auto * thread : s_threadCounters)
+	{
+		for(auto & entry : thread->entries)
+		{
+			entry.calls.store(0, std::memory_order_relaxed);
+			entry.ticks.store(0, std::memory_order_relaxed);
+		}
+
+		thread->overflow.calls.store(0, std::memory_order_relaxed);
+		thread->overflow.ticks.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+// per-function timing of papyrus native calls
+//
+// every NativeFunction vtable's Invoke slot is pointed at a wrapper that times the call to the original. counts
+// and inclusive time go in per-thread tables keyed by the class and function name BSFixedStrings, compared by
+// pool entry pointer, and are only merged when a report is written. latent functions are timed until they
+// return to the VM, not until their result arrives.
+//
+// the wrapper is the "PapyrusNativeInvoke" entry in the hook catalogue. the setting below has SFSE acquire it at
+// init, plugins can acquire it through SFSEHooksInterface for the counts without the periodic log report. the
+// periodic report is written by a background thread, the SFSEReport console command prints one on request and
+// SFSEProfileReset (given a slot with sProfileResetCommand under [Console]) clears the counts.
+//
+// [Papyrus]
+// bProfileNativeCalls=1
+// uProfileReportSeconds=60	; 0 = only on request
+// uProfileReportCount=25
+
+static const char * const kPapyrusProfiler_HookName = "PapyrusNativeInvoke";
+
+bool PapyrusProfiler_IsEnabled();
+void PapyrusProfiler_Register();
+void PapyrusProfiler_Install();
+
+typedef void (* PapyrusProfiler_PrintFn)(const char * fmt, ...);
+void PapyrusProfiler_Report(u32 maxFunctions, PapyrusProfiler_PrintFn print);	// 0 = uProfileReportCount
+void PapyrusProfiler_Reset();
@@ -12,6 +12,9 @@ class SFSEDelayFunctorManager;
 class SFSEObjectRegistry;
 class SFSEPersistentObjectStorage;
 class BranchTrampoline;
+class Setting;
+class Actor;
+class ActorValueInfo;
 
 struct PluginInfo
 {
@@ -35,6 +38,12 @@ enum
 	kInterface_Invalid = 0,
 	kInterface_Messaging,
 	kInterface_Trampoline,
+	kInterface_Memory,
+	kInterface_Settings,
+	kInterface_Forms,
+	kInterface_ActorValues,
+	kInterface_Metrics,
+	kInterface_Hooks,
 	kInterface_Max,
 };
 
@@ -125,6 +134,245 @@ struct SFSETrampolineInterface
 	void * (* AllocateFromLocalPool)(PluginHandle plugin, size_t size);
 };
 
+/**** Memory API docs *********************************************************
+ *
+ *	Allocate and Free give plugins access to SFSE's pooled slab heap. Small
+ *	requests are served from per-thread caches, so this is much cheaper than
+ *	the CRT heap for objects that are created and destroyed frequently.
+ *	Allocations are tagged with the plugin handle, and GetStats reports live
+ *	and peak usage per plugin.
+ *
+ *	To route a class through the heap, wrap the calls and use the wrappers
+ *	with DEFINE_STATIC_HEAP:
+ *
+ *	static void * MyAllocate(size_t size) { return g_memory->Allocate(g_pluginHandle, size); }
+ *	static void MyFree(void * ptr) { g_memory->Free(ptr); }
+ *
+ *	class MySink : public BSTEventSink <MenuOpenCloseEvent>
+ *	{
+ *	public:
+ *		DEFINE_STATIC_HEAP(MyAllocate, MyFree);
+ *	};
+ *
+ ******************************************************************************/
+
+struct SFSEMemoryInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	struct Stats
+	{
+		std::uint64_t	allocs;
+		std::uint64_t	frees;
+		std::uint64_t	liveBytes;
+		std::uint64_t	peakBytes;
+	};
+
+	std::uint32_t interfaceVersion;
+
+	void *	(* Allocate)(PluginHandle plugin, size_t size);
+	void	(* Free)(void * ptr);
+	void	(* GetStats)(PluginHandle plugin, Stats * out);
+};
+
+/**** Settings API docs *******************************************************
+ *
+ *	Game settings are looked up by their full name, e.g. "fJumpHeightMin:Movement",
+ *	without regard to case. The first lookup builds a hash index over the
+ *	INIPref, INI and Reg collections, so later lookups don't walk the lists.
+ *
+ *	GetDoubles and SetDoubles handle a whole array under a single lock and
+ *	return how many entries were read or applied. Names that don't exist and
+ *	string settings are skipped, and their values are left untouched.
+ *
+ *	Settings the game adds or removes later are tracked automatically. Rebuild
+ *	drops the index and walks the collections again, for plugins that change
+ *	the lists directly.
+ *
+ ******************************************************************************/
+
+struct SFSESettingsInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	struct Value
+	{
+		const char	* name;
+		double		value;
+	};
+
+	std::uint32_t interfaceVersion;
+
+	Setting *		(* Lookup)(const char * name);
+	bool			(* GetDouble)(const char * name, double * out);
+	bool			(* SetDouble)(const char * name, double value);
+	std::uint32_t	(* GetDoubles)(Value * values, std::uint32_t count);
+	std::uint32_t	(* SetDoubles)(const Value * values, std::uint32_t count);
+	void			(* Rebuild)();
+};
+
+/**** Forms API docs **********************************************************
+ *
+ *	The runtime doesn't keep most editor IDs after loading, so SFSE keeps
+ *	its own editor ID <-> form ID map. Lookups are a single hash probe and
+ *	are case-insensitive. With [Forms] bIndexEditorIDs=1 in sfse.ini the map
+ *	is filled from the load order's plugin files on a background thread
+ *	started after plugins load, so lookups made before it finishes can miss.
+ *	Plugins that see editor IDs during data load (e.g. from their own hooks)
+ *	can add them with RegisterEditorID so every plugin can resolve them.
+ *
+ *	Strings returned by GetEditorID stay valid for the life of the process.
+ *
+ ******************************************************************************/
+
+struct SFSEFormsInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	std::uint32_t interfaceVersion;
+
+	std::uint32_t	(* LookupEditorID)(const char * editorID);	// returns 0 if not found
+	const char *	(* GetEditorID)(std::uint32_t formID);		// returns nullptr if not found
+	void			(* RegisterEditorID)(std::uint32_t formID, const char * editorID);
+};
+
+/**** Actor value API docs ****************************************************
+ *
+ *	ReadBatch reads numInfos actor values for numActors actors in one call.
+ *	Results are grouped by value, then by actor: out[info * numActors + actor],
+ *	so out must hold numInfos * numActors floats. Null actors read as 0.
+ *
+ *	The low byte of flags selects current, permanent or base values, the
+ *	other bits are reserved. Values are read on the calling thread, call it
+ *	from wherever reading those actors' values directly would be safe.
+ *
+ ******************************************************************************/
+
+struct SFSEActorValueInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	enum
+	{
+		kValue_Current = 0,
+		kValue_Permanent,
+		kValue_Base,
+	};
+
+	std::uint32_t interfaceVersion;
+
+	void	(* ReadBatch)(Actor * const * actors, std::uint32_t numActors, const ActorValueInfo * const * infos, std::uint32_t numInfos, std::uint32_t flags, float * out);
+};
+
+/**** Metrics API docs ********************************************************
+ *
+ *	A shared registry of named counters, gauges and latency histograms, so
+ *	plugins don't each need their own timing code. Register once, keep the
+ *	ID, and record through it. Registering a name that already exists with
+ *	the same type returns the same ID, so plugins can share a metric. Prefix
+ *	names with the plugin name to avoid that by accident. Register returns 0
+ *	if the name is taken by another type or the registry is full; recording
+ *	to ID 0 does nothing.
+ *
+ *	Add, Record and SetGauge can be called from any thread. Counters and
+ *	histograms are kept per thread and only merged for a snapshot, so
+ *	recording doesn't contend with other threads or allocate (after a
+ *	thread's first record of a histogram). Histograms hold any u64 value,
+ *	e.g. nanoseconds, and report percentiles within 1/16 of the true value.
+ *
+ *	Snapshot copies up to maxCount metrics in ID order and returns the
+ *	total, so a call with maxCount = 0 sizes the buffer. Names stay valid for
+ *	the life of the process. SFSE also writes every metric to sfse.txt
+ *	periodically if sfse.ini has [Metrics] uReportSeconds set.
+ *
+ ******************************************************************************/
+
+struct SFSEMetricsInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	enum
+	{
+		kType_Counter = 0,
+		kType_Gauge,
+		kType_Histogram,
+	};
+
+	struct Snapshot
+	{
+		const char *	name;
+		std::uint32_t	type;
+		std::uint64_t	count;	// counter total or histogram samples
+		std::int64_t	value;	// gauge
+		std::uint64_t	sum;	// histograms only from here on
+		std::uint64_t	min;
+		std::uint64_t	max;
+		std::uint64_t	p50;
+		std::uint64_t	p90;
+		std::uint64_t	p99;
+		std::uint64_t	p999;
+	};
+
+	std::uint32_t interfaceVersion;
+
+	std::uint32_t	(* Register)(const char * name, std::uint32_t type);
+	std::uint32_t	(* Find)(const char * name);
+	void			(* Add)(std::uint32_t id, std::uint64_t amount);
+	void			(* SetGauge)(std::uint32_t id, std::int64_t value);
+	void			(* AddGauge)(std::uint32_t id, std::int64_t delta);
+	void			(* Record)(std::uint32_t id, std::uint64_t value);
+	std::uint32_t	(* GetSnapshot)(Snapshot * out, std::uint32_t maxCount);
+};
+
+/**** Hooks API docs **********************************************************
+ *
+ *	SFSE's optional hooks are registered by name but stay uninstalled until
+ *	something needs them, so features nobody uses cost nothing. Acquire a
+ *	hook to have it installed, and Release it when you're done; the hook is
+ *	removed again when its last user releases it. Acquires are counted per
+ *	plugin, and a plugin that fails to load has its acquires released.
+ *
+ *	Acquire returns false if the name isn't known or the hook couldn't be
+ *	installed. Acquire and release from your load function, a messaging
+ *	callback or the game's main thread; patching isn't safe against other
+ *	threads running the hooked code.
+ *
+ *	Current hooks:
+ *	PapyrusNativeInvoke - times papyrus native calls, feeding the
+ *		sfse.hooks.papyrus_native_calls metric and the papyrus profiler
+ *	ShowVersion, ConsoleCommandInit - always held by SFSE
+ *
+ ******************************************************************************/
+
+struct SFSEHooksInterface
+{
+	enum
+	{
+		kInterfaceVersion = 1
+	};
+
+	std::uint32_t interfaceVersion;
+
+	bool	(* Acquire)(PluginHandle plugin, const char * name);
+	bool	(* Release)(PluginHandle plugin, const char * name);
+	bool	(* IsActive)(const char * name);
+};
+
 typedef bool (* _SFSEPlugin_Load)(const SFSEInterface * sfse);
 
 /**** plugin versioning ********************************************************
@@ -4,8 +4,19 @@
 #include "sfse_common/Utilities.h"
 #include "sfse_common/sfse_version.h"
 #include "sfse_common/BranchTrampoline.h"
+#include "sfse_common/SlabHeap.h"
+#include "sfse_common/Metrics.h"
+#include "sfse/PluginMemoryStats.h"
+#include "sfse/GameSettings.h"
+#include "sfse/FormIndex.h"
+#include "sfse/ActorValueBatch.h"
+#include "sfse/DispatchStub.h"
+#include "sfse/HookCatalog.h"
 #include "sfse_common/Log.h"
 #include "sfse_common/Errors.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
 PluginManager	g_pluginManager;
 
@@ -34,6 +45,59 @@ static const SFSETrampolineInterface g_SFSETrampolineInterface =
 	AllocateFromSFSELocalPool
 };
 
+static const SFSEMemoryInterface g_SFSEMemoryInterface =
+{
+	SFSEMemoryInterface::kInterfaceVersion,
+	AllocateFromSFSEHeap,
+	FreeToSFSEHeap,
+	GetSFSEHeapStats
+};
+
+static const SFSESettingsInterface g_SFSESettingsInterface =
+{
+	SFSESettingsInterface::kInterfaceVersion,
+	LookupSetting,
+	GetSettingDouble,
+	SetSettingDouble,
+	GetSettingDoubles,
+	SetSettingDoubles,
+	RebuildSettingsIndex
+};
+
+static const SFSEFormsInterface g_SFSEFormsInterface =
+{
+	SFSEFormsInterface::kInterfaceVersion,
+	FormIndex_LookupEditorID,
+	FormIndex_GetEditorID,
+	FormIndex_AddEditorID
+};
+
+static const SFSEActorValueInterface g_SFSEActorValueInterface =
+{
+	SFSEActorValueInterface::kInterfaceVersion,
+	ActorValueBatch_Read
+};
+
+static const SFSEMetricsInterface g_SFSEMetricsInterface =
+{
+	SFSEMetricsInterface::kInterfaceVersion,
+	Metrics_Register,
+	Metrics_Find,
+	Metrics_Add,
+	Metrics_SetGauge,
+	Metrics_AddGauge,
+	Metrics_Record,
+	GetSFSEMetricsSnapshot
+};
+
+static const SFSEHooksInterface g_SFSEHooksInterface =
+{
+	SFSEHooksInterface::kInterfaceVersion,
+	HookCatalog_Acquire,
+	HookCatalog_Release,
+	HookCatalog_IsActive
+};
+
 static SFSEMessagingInterface g_SFSEMessagingInterface =
 {
 	SFSEMessagingInterface::kInterfaceVersion,
@@ -78,6 +142,39 @@ void PluginManager::init()
 	}
 }
 
+enum
+{
+	kSlowPluginLoadUS = 50 * 1000,	// loads slower than this get a gauge of their own
+	kMaxSlowPluginGauges = 32,		// the metrics registry is shared and small
+};
+
+static void RecordPluginLoadTime(const char * pluginName, u32 phase, std::chrono::steady_clock::duration elapsed)
+{
+	static const u32 preloadTimes = Metrics_Register("sfse.plugins.preload_us", kMetricType_Histogram);
+	static const u32 loadTimes = Metrics_Register("sfse.plugins.load_us", kMetricType_Histogram);
+	static u32 numSlowGauges = 0;
+
+	u64 elapsedUS = std::chrono::duration_cast <std::chrono::microseconds>(elapsed).count();
+	const char * phaseName = (phase == PluginManager::kPhase_Preload) ? "preload" : "load";
+
+	_MESSAGE("plugin \"%s\" %s took %I64u us", pluginName, phaseName, elapsedUS);
+
+	Metrics_Record((phase == PluginManager::kPhase_Preload) ? preloadTimes : loadTimes, elapsedUS);
+
+	// the histogram covers the whole set, only slow loaders are worth picking out by name
+	if((elapsedUS >= kSlowPluginLoadUS) && (numSlowGauges < kMaxSlowPluginGauges))
+	{
+		std::string name = std::string("sfse.plugins.") + pluginName + "." + phaseName + "_us";
+
+		u32 gauge = Metrics_Register(name.c_str(), kMetricType_Gauge);
+		if(gauge)
+		{
+			Metrics_SetGauge(gauge, elapsedUS);
+			numSlowGauges++;
+		}
+	}
+}
+
 void PluginManager::installPlugins(u32 phase)
 {
 	for(size_t i = 0; i < m_plugins.size(); i++)
@@ -103,10 +200,14 @@ void PluginManager::installPlugins(u32 phase)
 
 		std::string pluginPath = m_pluginDirectory + plugin.dllName;
 
+		auto loadStart = std::chrono::steady_clock::now();
+
 		if(!plugin.handle)
 		{
 			plugin.handle = (HMODULE)LoadLibrary(pluginPath.c_str());
-			if(!plugin.handle)
+			if(plugin.handle)
+				PluginMemoryStats_Install(plugin.handle, plugin.internalHandle);
+			else
 				logPluginLoadError(plugin, "couldn't load plugin", GetLastError());
 		}
 
@@ -136,8 +237,13 @@ void PluginManager::installPlugins(u32 phase)
 			}
 		}
 
+		RecordPluginLoadTime(plugin.version.name, phase, std::chrono::steady_clock::now() - loadStart);
+
 		if(!success)
 		{
+			// drop any hooks it acquired before failing
+			HookCatalog_ReleaseAll(plugin.internalHandle);
+
 			// failed, unload the library
 			if(plugin.handle) FreeLibrary(plugin.handle);
 
@@ -183,6 +289,9 @@ void PluginManager::loadComplete()
 	dispatchMessage(0, SFSEMessagingInterface::kMessage_PostLoad, nullptr, 0, nullptr);
 	// second post-load dispatch
 	dispatchMessage(0, SFSEMessagingInterface::kMessage_PostPostLoad, nullptr, 0, nullptr);
+
+	// listeners are mostly registered by now, compile them
+	enableDispatchStubs();
 }
 
 void PluginManager::deinit()
@@ -197,6 +306,8 @@ void PluginManager::deinit()
 		}
 	}
 
+	releaseDispatchStubs();
+
 	m_plugins.clear();
 }
 
@@ -263,6 +374,25 @@ void * PluginManager::queryInterface(u32 id)
 	case kInterface_Trampoline:
 		result = (void *)&g_SFSETrampolineInterface;
 		break;
+	case kInterface_Memory:
+		result = (void *)&g_SFSEMemoryInterface;
+		break;
+	case kInterface_Settings:
+		result = (void *)&g_SFSESettingsInterface;
+		break;
+	case kInterface_Forms:
+		result = (void *)&g_SFSEFormsInterface;
+		break;
+	case kInterface_ActorValues:
+		result = (void *)&g_SFSEActorValueInterface;
+		break;
+	case kInterface_Metrics:
+		result = (void *)&g_SFSEMetricsInterface;
+		break;
+
+	case kInterface_Hooks:
+		result = (void *)&g_SFSEHooksInterface;
+		break;
 
 	default:
 		_WARNING("unknown QueryInterface %08X", id);
@@ -630,8 +760,220 @@ struct PluginListener {
 typedef std::vector<std::vector<PluginListener> > PluginListeners;
 static PluginListeners s_pluginListeners;
 
+// broadcasts go through a generated stub per sender once plugin load is done, see DispatchStub.h
+//
+// the table, unwind info and code share one block. registering a listener only marks the stubs stale, they're
+// rebuilt by the next dispatch so a burst of registrations costs one rebuild. the block is rewritten in place
+// when it's big enough and no other dispatch is running a stub, otherwise the old one is retired and freed by a
+// later rebuild that finds nothing in flight. dispatches count themselves in before loading the table, so once
+// the table is cleared a zero count means nothing can still be running the old code.
+struct DispatchStubTable
+{
+	u64				numSenders;
+	DispatchStubFn	stubs[1];	// numSenders entries, null for senders without listeners
+};
+
+struct DispatchStubBlock
+{
+	u8					* base;
+	size_t				size;
+	RUNTIME_FUNCTION	* functions;	// registered with RtlAddFunctionTable, null if not
+};
+
+static std::atomic<DispatchStubTable *>	s_dispatchStubs(nullptr);
+static std::atomic<u32>					s_dispatchStubsInFlight(0);
+static std::atomic<bool>				s_dispatchStubsStale(false);
+static bool								s_dispatchStubsEnabled = false;
+static std::mutex						s_dispatchStubLock;	// the blocks, and s_pluginListeners against rebuilds
+static DispatchStubBlock				s_dispatchStubBlock = { nullptr, 0, nullptr };
+static std::vector<DispatchStubBlock>	s_retiredDispatchStubBlocks;
+
+static void FreeDispatchStubBlock(const DispatchStubBlock & block)
+{
+	if(block.functions)
+		RtlDeleteFunctionTable(block.functions);
+
+	VirtualFree(block.base, 0, MEM_RELEASE);
+}
+
+// counts a dispatch in for as long as it might be running stub code, however it leaves
+struct DispatchStubGuard
+{
+	DispatchStubGuard()		{ s_dispatchStubsInFlight++; }
+	~DispatchStubGuard()	{ s_dispatchStubsInFlight--; }
+};
+
+void PluginManager::enableDispatchStubs()
+{
+	u32	disable = 0;
+	if(getConfigOption_u32("Messaging", "bDisableDispatchStubs", &disable) && disable)
+	{
+		_MESSAGE("message dispatch stubs disabled");
+		return;
+	}
+
+	std::lock_guard<std::mutex> locker(s_dispatchStubLock);
+
+	s_dispatchStubsEnabled = true;
+
+	buildDispatchStubs();
+}
+
+// called with s_dispatchStubLock held
+void PluginManager::buildDispatchStubs()
+{
+	s_dispatchStubsStale = false;
+
+	const u64 numSenders = s_pluginListeners.size();
+
+	u32 numStubs = 0;
+	size_t codeSize = 0;
+
+	for(auto & listeners : s_pluginListeners)
+	{
+		if(!listeners.empty())
+		{
+			numStubs++;
+			codeSize += (GetDispatchStubSize(u32(listeners.size())) + 15) & ~15;
+		}
+	}
+
+	const size_t tableSize = (offsetof(DispatchStubTable, stubs) + numSenders * sizeof(DispatchStubFn) + 15) & ~15;
+	const size_t unwindSize = (numStubs * sizeof(RUNTIME_FUNCTION) + kDispatchStubUnwindInfoSize + 15) & ~15;
+	const size_t blockSize = tableSize + unwindSize + codeSize;
+
+	// nothing can start running the old stubs after this, only finish
+	s_dispatchStubs = nullptr;
+
+	bool idle = !s_dispatchStubsInFlight;
+
+	if(idle)
+	{
+		for(auto & retired : s_retiredDispatchStubBlocks)
+			FreeDispatchStubBlock(retired);
+
+		s_retiredDispatchStubBlocks.clear();
+	}
+
+	DispatchStubBlock & block = s_dispatchStubBlock;
+
+	if(block.base)
+	{
+		if(idle && (block.size >= blockSize))
+		{
+			if(block.functions)
+			{
+				RtlDeleteFunctionTable(block.functions);
+				block.functions = nullptr;
+			}
+
+			DWORD oldProtect;
+			VirtualProtect(block.base, block.size, PAGE_READWRITE, &oldProtect);
+		}
+		else
+		{
+			if(idle)
+				FreeDispatchStubBlock(block);
+			else
+				s_retiredDispatchStubBlocks.push_back(block);
+
+			block.base = nullptr;
+		}
+	}
+
+	if(!block.base)
+	{
+		block.size = (blockSize + 0xFFF) & ~0xFFF;	// all of it is usable by later rebuilds
+		block.functions = nullptr;
+		block.base = (u8 *)VirtualAlloc(nullptr, block.size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+		if(!block.base)
+		{
+			_WARNING("couldn't allocate message dispatch stubs (%08X), using the generic path", GetLastError());
+			return;
+		}
+	}
+
+	u8 * base = block.base;
+
+	DispatchStubTable * table = (DispatchStubTable *)base;
+	table->numSenders = numSenders;
+
+	RUNTIME_FUNCTION * functions = (RUNTIME_FUNCTION *)(base + tableSize);
+	u8 * unwindInfo = (u8 *)(functions + numStubs);
+	u32 numFunctions = 0;
+
+	BuildDispatchStubUnwindInfo(unwindInfo);
+
+	u8 * code = base + tableSize + unwindSize;
+	std::vector<uintptr_t> handlers;
+
+	for(u64 sender = 0; sender < numSenders; sender++)
+	{
+		const std::vector<PluginListener> & listeners = s_pluginListeners[sender];
+		const char * senderName = g_pluginManager.pluginNameFromHandle(PluginHandle(sender));
+
+		table->stubs[sender] = nullptr;
+
+		if(listeners.empty() || !senderName)
+			continue;
+
+		handlers.clear();
+		for(auto & listener : listeners)
+			handlers.push_back(uintptr_t(listener.handleMessage));
+
+		size_t len = BuildDispatchStub(senderName, handlers.data(), u32(handlers.size()), code, base + blockSize - code);
+
+		RUNTIME_FUNCTION & function = functions[numFunctions++];
+
+		function.BeginAddress = DWORD(code - base);
+		function.EndAddress = DWORD(code + len - base);
+		function.UnwindData = DWORD(unwindInfo - base);
+
+		table->stubs[sender] = DispatchStubFn(code);
+		code += (len + 15) & ~15;
+	}
+
+	DWORD oldProtect;
+	VirtualProtect(base, block.size, PAGE_EXECUTE_READ, &oldProtect);
+	FlushInstructionCache(GetCurrentProcess(), base, block.size);
+
+	if(numFunctions)
+	{
+		if(RtlAddFunctionTable(functions, numFunctions, DWORD64(base)))
+			block.functions = functions;
+		else
+			_WARNING("couldn't register unwind info for message dispatch stubs");
+	}
+
+	s_dispatchStubs = table;
+
+	_DMESSAGE("built message dispatch stubs for %I64u senders (%I64u bytes, %d retired blocks)", numSenders, u64(blockSize), u32(s_retiredDispatchStubBlocks.size()));
+}
+
+void PluginManager::releaseDispatchStubs()
+{
+	std::lock_guard<std::mutex> locker(s_dispatchStubLock);
+
+	s_dispatchStubs = nullptr;
+	s_dispatchStubsEnabled = false;
+	s_dispatchStubsStale = false;
+
+	if(s_dispatchStubBlock.base)
+		FreeDispatchStubBlock(s_dispatchStubBlock);
+
+	s_dispatchStubBlock.base = nullptr;
+
+	for(auto & retired : s_retiredDispatchStubBlocks)
+		FreeDispatchStubBlock(retired);
+
+	s_retiredDispatchStubBlocks.clear();
+}
+
 bool PluginManager::registerListener(PluginHandle listener, const char* sender, SFSEMessagingInterface::EventCallback handler)
 {
+	std::lock_guard<std::mutex> locker(s_dispatchStubLock);
+
 	// because this can be called while plugins are loading, gotta make sure number of plugins hasn't increased
 	u32 numPlugins = g_pluginManager.numPlugins() + 1;
 	if (s_pluginListeners.size() < numPlugins)
@@ -704,11 +1046,72 @@ bool PluginManager::registerListener(PluginHandle listener, const char* sender,
 		}
 	}
 
+	// registered after the stubs were built, the next dispatch regenerates them
+	if (s_dispatchStubsEnabled)
+	{
+		s_dispatchStubsStale = true;
+	}
+
 	return true;
 }
 
+enum
+{
+	kDispatchSampleRate = 16,	// power of two
+};
+
+// counts every dispatch and times one in kDispatchSampleRate per thread, however it returns. reading the clock
+// twice costs more than a stub dispatch to a few listeners
+struct DispatchTimer
+{
+	bool									sampled;
+	std::chrono::steady_clock::time_point	start;
+
+	DispatchTimer()
+	{
+		static thread_local u32 numDispatches = 0;
+
+		sampled = !(numDispatches++ & (kDispatchSampleRate - 1));
+		if(sampled)
+			start = std::chrono::steady_clock::now();
+	}
+
+	~DispatchTimer()
+	{
+		static const u32 dispatches = Metrics_Register("sfse.messaging.dispatches", kMetricType_Counter);
+		static const u32 dispatchTimes = Metrics_Register("sfse.messaging.dispatch_ns", kMetricType_Histogram);
+
+		Metrics_Add(dispatches);
+
+		if(sampled)
+			Metrics_Record(dispatchTimes, std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+};
+
 bool PluginManager::dispatchMessage(PluginHandle sender, u32 messageType, void * data, u32 dataLen, const char* receiver)
 {
+	DispatchTimer timer;
+
+	if (s_dispatchStubsStale)
+	{
+		std::lock_guard<std::mutex> locker(s_dispatchStubLock);
+
+		if (s_dispatchStubsStale)
+			buildDispatchStubs();
+	}
+
+	// compiled broadcast
+	{
+		DispatchStubGuard inFlight;
+
+		DispatchStubTable * stubs = s_dispatchStubs;
+		if (stubs && !receiver && sender < stubs->numSenders && stubs->stubs[sender])
+		{
+			_DMESSAGE("dispatch message (%d) to plugin listeners via stub", messageType);
+			return stubs->stubs[sender](messageType, data, dataLen);
+		}
+	}
+
 	_MESSAGE("dispatch message (%d) to plugin listeners", messageType);
 	u32 numRespondents = 0;
 	PluginHandle target = kPluginHandle_Invalid;
@@ -798,3 +1201,81 @@ void * AllocateFromSFSELocalPool(PluginHandle plugin, size_t size)
 	}
 	return g_localTrampolineManager.allocate(plugin, size);
 }
+
+void * AllocateFromSFSEHeap(PluginHandle plugin, size_t size)
+{
+	return g_slabHeap.allocate(size, plugin);
+}
+
+void FreeToSFSEHeap(void * ptr)
+{
+	g_slabHeap.free(ptr);
+}
+
+void GetSFSEHeapStats(PluginHandle plugin, SFSEMemoryInterface::Stats * out)
+{
+	SlabHeap::Stats stats;
+	g_slabHeap.getStats(plugin, &stats);
+
+	out->allocs = stats.allocs;
+	out->frees = stats.frees;
+	out->liveBytes = stats.liveBytes;
+	out->peakBytes = stats.peakBytes;
+}
+
+u32 GetSFSEMetricsSnapshot(SFSEMetricsInterface::Snapshot * out, u32 maxCount)
+{
+	std::vector <MetricsSnapshot> snapshots(maxCount);
+	u32 total = Metrics_Snapshot(snapshots.data(), maxCount);
+
+	for(u32 i = 0; (i < maxCount) && (i < total); i++)
+	{
+		const MetricsSnapshot & src = snapshots[i];
+		SFSEMetricsInterface::Snapshot & dst = out[i];
+
+		dst.name = src.name;
+		dst.type = src.type;
+		dst.count = src.count;
+		dst.value = src.value;
+		dst.sum = src.sum;
+		dst.min = src.min;
+		dst.max = src.max;
+		dst.p50 = src.p50;
+		dst.p90 = src.p90;
+		dst.p99 = src.p99;
+		dst.p999 = src.p999;
+	}
+
+	return total;
+}
+
+Setting * LookupSetting(const char * name)
+{
+	return g_settingsIndex.lookup(name);
+}
+
+bool GetSettingDouble(const char * name, double * out)
+{
+	return g_settingsIndex.getDouble(name, out);
+}
+
+bool SetSettingDouble(const char * name, double value)
+{
+	return g_settingsIndex.setDouble(name, value);
+}
+
+// SFSESettingsInterface::Value and SettingsIndex::Value share a layout
+u32 GetSettingDoubles(SFSESettingsInterface::Value * values, u32 count)
+{
+	return g_settingsIndex.getDoubles(reinterpret_cast<SettingsIndex::Value *>(values), count);
+}
+
+u32 SetSettingDoubles(const SFSESettingsInterface::Value * values, u32 count)
+{
+	return g_settingsIndex.setDoubles(reinterpret_cast<const SettingsIndex::Value *>(values), count);
+}
+
+void RebuildSettingsIndex()
+{
+	g_settingsIndex.rebuild();
+}
@@ -44,6 +44,10 @@ public:
 	static bool	registerListener(PluginHandle listener, const char* sender, SFSEMessagingInterface::EventCallback handler);
 
 private:
+	static void	enableDispatchStubs();
+	static void	buildDispatchStubs();
+	static void	releaseDispatchStubs();
+
 	struct LoadedPlugin
 	{
 		LoadedPlugin();
@@ -112,4 +116,16 @@ extern BranchTrampolineManager g_localTrampolineManager;
 void * AllocateFromSFSEBranchPool(PluginHandle plugin, size_t size);
 void * AllocateFromSFSELocalPool(PluginHandle plugin, size_t size);
 
+void * AllocateFromSFSEHeap(PluginHandle plugin, size_t size);
+void FreeToSFSEHeap(void * ptr);
+void GetSFSEHeapStats(PluginHandle plugin, SFSEMemoryInterface::Stats * out);
+u32 GetSFSEMetricsSnapshot(SFSEMetricsInterface::Snapshot * out, u32 maxCount);
+
+Setting * LookupSetting(const char * name);
+bool GetSettingDouble(const char * name, double * out);
+bool SetSettingDouble(const char * name, double value);
+u32 GetSettingDoubles(SFSESettingsInterface::Value * values, u32 count);
+u32 SetSettingDoubles(const SFSESettingsInterface::Value * values, u32 count);
+void RebuildSettingsIndex();
+
 extern PluginManager	g_pluginManager;
@@ -0,0 +1,177 @@
+#include "sfse/PluginMemoryStats.h"
+#include "sfse/PluginManager.h"
+#include "sfse_common/AllocTracker.h"
+#include "sfse_common/BranchTrampoline.h"
+#include "sfse_common/SafeWrite.h"
+#include "sfse_common/Utilities.h"
+#include "sfse_common/Log.h"
+#include "xbyak/xbyak.h"
+
+static AllocTracker s_tracker;
+
+// allocation rate state, only touched by reports
+static u64	s_lastAllocs[AllocTracker::kMaxOwners];
+static u64	s_lastReportTime = 0;
+
+typedef void * (* _malloc)(size_t size);
+typedef void * (* _calloc)(size_t num, size_t size);
+typedef void * (* _realloc)(void * ptr, size_t size);
+typedef void (* _free)(void * ptr);
+
+static _malloc	s_malloc = nullptr;
+static _calloc	s_calloc = nullptr;
+static _realloc	s_realloc = nullptr;
+static _free	s_free = nullptr;
+
+// the thunks pass the plugin handle in r9, the fourth argument
+static void * Tracked_malloc(size_t size, u64, u64, u32 plugin)
+{
+	void * result = s_malloc(size);
+
+	s_tracker.recordAlloc(plugin, result, size);
+
+	return result;
+}
+
+static void * Tracked_calloc(size_t num, size_t size, u64, u32 plugin)
+{
+	void * result = s_calloc(num, size);
+
+	s_tracker.recordAlloc(plugin, result, num * size);
+
+	return result;
+}
+
+static void * Tracked_realloc(void * ptr, size_t size, u64, u32 plugin)
+{
+	// recorded before the old block can be handed out to another thread
+	u64 oldSize = s_tracker.recordFree(plugin, ptr);
+
+	void * result = s_realloc(ptr, size);
+
+	if(result)
+		s_tracker.recordAlloc(plugin, result, size);
+	else if(size)
+		s_tracker.recordAlloc(plugin, ptr, oldSize);	// failed, the old block is still live
+
+	return result;
+}
+
+static void Tracked_free(void * ptr, u64, u64, u32 plugin)
+{
+	// recorded first, the address can be handed out again as soon as it's freed
+	s_tracker.recordFree(plugin, ptr);
+
+	s_free(ptr);
+}
+
+bool PluginMemoryStats_IsEnabled()
+{
+	static int s_enabled = -1;
+
+	if(s_enabled < 0)
+	{
+		u32 enable = 0;
+		s_enabled = (getConfigOption_u32("Memory", "bTrackPluginAllocations", &enable) && enable) ? 1 : 0;
+	}
+
+	return s_enabled != 0;
+}
+
+static uintptr_t MakeAccountingThunk(PluginHandle handle, uintptr_t target)
+{
+	struct AccountingThunk_Code : Xbyak::CodeGenerator {
+		AccountingThunk_Code(void * buf, PluginHandle handle, uintptr_t target) : Xbyak::CodeGenerator(4096, buf)
+		{
+			Xbyak::Label targetLabel;
+
+			mov(r9d, handle);
+			jmp(ptr[rip + targetLabel]);
+
+			L(targetLabel);
+			dq(target);
+		}
+	};
+
+	void * codeBuf = g_localTrampoline.startAlloc();
+	AccountingThunk_Code code(codeBuf, handle, target);
+	g_localTrampoline.endAlloc(code.getCurr());
+
+	return uintptr_t(codeBuf);
+}
+
+void PluginMemoryStats_Install(HMODULE module, PluginHandle handle)
+{
+	if(!PluginMemoryStats_IsEnabled())
+		return;
+
+	static const char * kHeapDll = "api-ms-win-crt-heap-l1-1-0.dll";
+
+	struct TrackedImport
+	{
+		const char	* name;
+		void		** original;
+		uintptr_t	wrapper;
+	};
+
+	const TrackedImport kImports[] =
+	{
+		{ "malloc",		(void **)&s_malloc,		uintptr_t(Tracked_malloc) },
+		{ "calloc",		(void **)&s_calloc,		uintptr_t(Tracked_calloc) },
+		{ "realloc",	(void **)&s_realloc,	uintptr_t(Tracked_realloc) },
+		{ "free",		(void **)&s_free,		uintptr_t(Tracked_free) },
+	};
+
+	u32 numHooked = 0;
+
+	for(auto & import : kImports)
+	{
+		auto * iat = (void **)getIATAddr(module, kHeapDll, import.name);
+		if(!iat)
+			continue;
+
+		// every module imports the same CRT, so the first one seen is the real function
+		if(!*import.original)
+			*import.original = *iat;
+
+		safeWrite64(uintptr_t(iat), MakeAccountingThunk(handle, import.wrapper));
+
+		numHooked++;
+	}
+
+	_MESSAGE("tracking %d heap imports for plugin %d", numHooked, handle);
+}
+
+void PluginMemoryStats_Report(PluginMemoryStats_PrintFn print)
+{
+	if(!PluginMemoryStats_IsEnabled())
+	{
+		print("plugin allocation tracking is disabled (sfse.ini [Memory] bTrackPluginAllocations=1)");
+		return;
+	}
+
+	u64 now = GetTickCount64();
+	double elapsed = s_lastReportTime ? (now - s_lastReportTime) / 1000.0 : 0;
+
+	for(u32 i = 0; i < AllocTracker::kMaxOwners; i++)
+	{
+		AllocTracker::Stats stats;
+		s_tracker.getStats(i, &stats);
+
+		if(!stats.allocs)
+			continue;
+
+		double rate = (elapsed > 0) ? (stats.allocs - s_lastAllocs[i]) / elapsed : 0;
+		s_lastAllocs[i] = stats.allocs;
+
+		const char * name = g_pluginManager.pluginNameFromHandle(i);
+
+		print("%s: %llu KB live, %llu KB peak, %llu allocs %llu frees, %.1f allocs/s",
+			name ? name : "<unknown>", stats.liveBytes >> 10, stats.peakBytes >> 10, stats.allocs, stats.frees, rate);
+	}
+
+	if(s_tracker.numUnsized())
+		print("%llu blocks couldn't be sized (tracking table full around them)", s_tracker.numUnsized());
+
+	s_lastReportTime = now;
+}
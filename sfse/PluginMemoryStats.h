@@ -0,0 +1,24 @@
+#pragma once
+
+#include "sfse/PluginAPI.h"
+#include <Windows.h>
+
+// per-plugin CRT heap accounting
+//
+// each plugin's malloc/calloc/realloc/free imports are redirected to a small per-plugin thunk that tags the
+// call with the plugin's handle and forwards to the real CRT. block sizes and per-plugin totals are kept by an
+// AllocTracker, so frees don't have to call _msize and nothing on the path takes a lock.
+//
+// the imports are patched once LoadLibrary returns, so whatever the plugin allocates from its static
+// initializers and DllMain isn't counted, and freeing those blocks later counts the free without any bytes.
+// a block stays charged to the plugin that allocated it until some plugin frees it, or until its address is
+// allocated again if the game freed it.
+//
+// [Memory]
+// bTrackPluginAllocations=1
+
+bool PluginMemoryStats_IsEnabled();
+void PluginMemoryStats_Install(HMODULE module, PluginHandle handle);
+
+typedef void (* PluginMemoryStats_PrintFn)(const char * fmt, ...);
+void PluginMemoryStats_Report(PluginMemoryStats_PrintFn print);
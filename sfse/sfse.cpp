@@ -6,10 +6,19 @@
 #include "sfse_common/Utilities.h"
 #include "sfse_common/SafeWrite.h"
 #include "sfse_common/BranchTrampoline.h"
+#include "sfse_common/Metrics.h"
+#include "sfse_common/Telemetry.h"
+#include "sfse_common/CPUTopology.h"
+#include "sfse_common/ThreadPolicy.h"
 #include "PluginManager.h"
 
 #include "Hooks_Version.h"
 #include "Hooks_Script.h"
+#include "Hooks_Memory.h"
+#include "PapyrusProfiler.h"
+#include "HookCatalog.h"
+#include "GameSettings.h"
+#include "FormIndex.h"
 
 // Global variable to store the module handle.
 HINSTANCE g_moduleHandle = nullptr;
@@ -54,6 +63,14 @@ void installBaseHooks(void)
     // Open a debug log file.
     DebugLog::openRelative(CSIDL_MYDOCUMENTS, "\\My Games\\" SAVE_FOLDER_NAME "\\SFSE\\Logs\\sfse.txt");
 
+    // Mirror it in to a crash-surviving ring (sfse.ring) if requested.
+    u32 flightRecorderKB = 0;
+    if (getConfigOption_u32("Log", "uFlightRecorderKB", &flightRecorderKB) && flightRecorderKB)
+    {
+        if (!DebugLog::openFlightRecorder(flightRecorderKB * 1024ull))
+            _WARNING("couldn't create flight recorder");
+    }
+
     // Get the module handle for the executable.
     HANDLE exe = GetModuleHandle(nullptr);
 
@@ -96,6 +113,53 @@ void WaitForDebugger(void)
     Sleep(1000 * 2);
 }
 
+/**
+ * @brief Read the affinity and priority for SFSE's own background threads from sfse.ini.
+ *
+ * [Threads]
+ * sAffinityPolicy=ecores    same presets as the loader's -affinitypolicy
+ * sPriority=below           lowest, below, normal, above or highest, relative to the process
+ */
+static void LoadThreadPolicy()
+{
+    u64 affinity = 0;
+    s32 priority = 0;
+
+    std::string policyStr = getConfigOption("Threads", "sAffinityPolicy");
+    if (!policyStr.empty())
+    {
+        u32 policy = 0, param = 0;
+        CPUTopology topology;
+
+        if (!CPUTopology::parsePolicy(policyStr.c_str(), &policy, &param))
+            _WARNING("couldn't read thread affinity policy (%s)", policyStr.c_str());
+        else if (!topology.loadSystem())
+            _WARNING("couldn't read cpu topology, thread affinity policy ignored");
+        else if (!(affinity = topology.policyMask(policy, param)))
+            _WARNING("thread affinity policy %s matches no cpus on this system, ignored", policyStr.c_str());
+    }
+
+    std::string priorityStr = getConfigOption("Threads", "sPriority");
+    if (!priorityStr.empty())
+    {
+        static const char * kPriorityNames[] = { "lowest", "below", "normal", "above", "highest" };
+
+        u32 i = 0;
+        while ((i < _countof(kPriorityNames)) && _stricmp(priorityStr.c_str(), kPriorityNames[i]))
+            i++;
+
+        if (i < _countof(kPriorityNames))
+            priority = s32(i) + kThreadPriority_Lowest;
+        else
+            _WARNING("couldn't read thread priority (%s)", priorityStr.c_str());
+    }
+
+    if (affinity || priority)
+        _MESSAGE("sfse threads: affinity %016I64X priority %d", affinity, priority);
+
+    ThreadPolicy_Set(affinity, priority);
+}
+
 /**
  * @brief Perform pre-initialization tasks for SFSE.
  */
@@ -135,6 +199,29 @@ void SFSE_Preinit()
         return;
     }
 
+    // Replace the runtime's heap if requested, this has to happen before global initializers run.
+    Hooks_Memory_Apply();
+
+    // Before SFSE starts any threads of its own.
+    LoadThreadPolicy();
+
+    // Publish metrics to shared memory for external tools, started before plugins load so their timings are visible.
+    u32 telemetryEnable = 0;
+    if (getConfigOption_u32("Telemetry", "bEnable", &telemetryEnable) && telemetryEnable)
+    {
+        u32 telemetryPublishMS = 250;
+        getConfigOption_u32("Telemetry", "uPublishMS", &telemetryPublishMS);
+
+        if (!Telemetry_StartPublishing(kTelemetryDefaultName, telemetryPublishMS))
+            _WARNING("couldn't create telemetry segment %s", kTelemetryDefaultName);
+    }
+
+    // Catalogue the optional hooks before any plugin can ask for them, they're only installed once acquired.
+    Hooks_Version_Register();
+    Hooks_Script_Register();
+    PapyrusProfiler_Register();
+    SettingsIndex_Register();
+
     // Scan the plugin folder.
     g_pluginManager.init();
 
@@ -144,6 +231,26 @@ void SFSE_Preinit()
     _MESSAGE("preinit complete");
 }
 
+/**
+ * @brief Write a line of a periodic report to the log.
+ */
+static void PrintReportToLog(const char* fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    DebugLog::log(DebugLog::kLevel_Message, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief Append the statistics that aren't metrics to each periodic report.
+ */
+static void ReportSFSEStats(Metrics_PrintFn print)
+{
+    Hooks_Memory_Report(print);
+}
+
 /**
  * @brief Perform initialization tasks for SFSE.
  */
@@ -158,9 +265,23 @@ void SFSE_Initialize()
     g_pluginManager.installPlugins(PluginManager::kPhase_Load);
     g_pluginManager.loadComplete();
 
+    // Acquire the hooks behind SFSE's own features.
     Hooks_Version_Apply();
     Hooks_Script_Apply();
 
+    PapyrusProfiler_Install();
+
+    // Read the editor IDs out of the load order's plugin files if requested.
+    FormIndex_Init();
+
+    // Dump the metrics registry to the log periodically if requested.
+    u32 metricsReportSeconds = 0;
+    if (getConfigOption_u32("Metrics", "uReportSeconds", &metricsReportSeconds))
+        Metrics_StartReporting(metricsReportSeconds, PrintReportToLog, ReportSFSEStats);
+
+    // Which optional hooks ended up installed.
+    HookCatalog_Report(PrintReportToLog);
+
     FlushInstructionCache(GetCurrentProcess(), NULL, 0);
 
     _MESSAGE("init complete");
@@ -0,0 +1,250 @@
+#include "Bench.h"
+#include "sfse_common/sfse_version.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+volatile u64 g_benchSink = 0;
+
+struct BenchEntry
+{
+	std::string	name;
+	BenchFn		fn;
+};
+
+// registration happens during static init, so the list can't be a plain global
+static std::vector <BenchEntry> & GetBenchmarks()
+{
+	static std::vector <BenchEntry> benchmarks;
+	return benchmarks;
+}
+
+static std::string s_tempDir = ".";
+
+void Bench_Register(const char * group, const char * name, BenchFn fn)
+{
+	BenchEntry entry;
+
+	entry.name = std::string(group) + "/" + name;
+	entry.fn = fn;
+
+	GetBenchmarks().push_back(entry);
+}
+
+const std::string & Bench_GetTempDir()
+{
+	return s_tempDir;
+}
+
+void Bench_SetTempDir(const char * path)
+{
+	s_tempDir = path;
+}
+
+f64 BenchResult::min() const
+{
+	return nsPerOp.empty() ? 0 : *std::min_element(nsPerOp.begin(), nsPerOp.end());
+}
+
+f64 BenchResult::median() const
+{
+	if(nsPerOp.empty())
+		return 0;
+
+	std::vector <f64> sorted(nsPerOp);
+	std::sort(sorted.begin(), sorted.end());
+
+	size_t mid = sorted.size() / 2;
+
+	return (sorted.size() & 1) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+static u64 TimeRun(BenchFn fn, BenchState & state)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	fn(state);
+
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast <std::chrono::nanoseconds>(end - start).count();
+}
+
+static void RunOne(const BenchEntry & entry, const BenchOptions & options, BenchResult * result)
+{
+	u64 minTimeNS = u64(options.minTimeMS) * 1000 * 1000;
+	u64 iterations = 1;
+	u64 elapsed = 0;
+	u64 bytesPerOp = 0;
+
+	// a run with no iterations first, so fixtures built on first use and one-off checks aren't timed
+	{
+		BenchState state(0);
+		entry.fn(state);
+	}
+
+	// grow the run until it's long enough to time, the first few runs double as warmup
+	for(;;)
+	{
+		BenchState state(iterations);
+
+		elapsed = TimeRun(entry.fn, state);
+		bytesPerOp = state.bytesPerOp;
+
+		if(elapsed >= minTimeNS)
+			break;
+
+		u64 next;
+		if(elapsed < minTimeNS / 100)
+			next = iterations * 10;
+		else
+			next = u64(f64(iterations) * 1.2 * f64(minTimeNS) / f64(elapsed));
+
+		iterations = std::max(next, iterations + 1);
+	}
+
+	result->name = entry.name;
+	result->iterations = iterations;
+	result->bytesPerOp = bytesPerOp;
+	result->nsPerOp.clear();
+
+	for(u32 i = 0; i < options.repetitions; i++)
+	{
+		BenchState state(iterations);
+
+		elapsed = TimeRun(entry.fn, state);
+
+		result->nsPerOp.push_back(f64(elapsed) / f64(iterations));
+	}
+}
+
+void Bench_List()
+{
+	for(auto & entry : GetBenchmarks())
+		printf("%s\n", entry.name.c_str());
+}
+
+void Bench_Run(const BenchOptions & options, std::vector <BenchResult> * results)
+{
+	for(auto & entry : GetBenchmarks())
+	{
+		if(!options.filter.empty() && (entry.name.find(options.filter) == std::string::npos))
+			continue;
+
+		BenchResult result;
+
+		RunOne(entry, options, &result);
+
+		results->push_back(result);
+	}
+}
+
+void Bench_PrintTable(const std::vector <BenchResult> & results)
+{
+	printf("%-36s %14s %12s %12s %12s\n", "benchmark", "iterations", "min ns/op", "median ns/op", "MB/s");
+
+	for(auto & result : results)
+	{
+		char throughput[32] = "-";
+
+		if(result.bytesPerOp && result.median() > 0)
+			snprintf(throughput, sizeof(throughput), "%.1f", f64(result.bytesPerOp) * 1000.0 / result.median());
+
+		printf("%-36s %14llu %12.2f %12.2f %12s\n", result.name.c_str(), result.iterations, result.min(), result.median(), throughput);
+	}
+}
+
+static void WriteJSONString(FILE * dst, const char * str)
+{
+	fputc('"', dst);
+
+	for(; *str; str++)
+	{
+		unsigned char c = *str;
+
+		if((c == '"') || (c == '\\'))
+			fprintf(dst, "\\%c", c);
+		else if(c < 0x20)
+			fprintf(dst, "\\u%04X", c);
+		else
+			fputc(c, dst);
+	}
+
+	fputc('"', dst);
+}
+
+static const char * GetCompilerName()
+{
+#if defined(__clang__)
+	return "clang " __clang_version__;
+#elif defined(__GNUC__)
+	return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+	return "msvc";
+#else
+	return "unknown";
+#endif
+}
+
+static const char * GetPlatformName()
+{
+#if defined(_WIN32)
+	return "windows";
+#elif defined(__linux__)
+	return "linux";
+#else
+	return "unknown";
+#endif
+}
+
+bool Bench_WriteJSON(const char * path, const BenchOptions & options, const std::vector <BenchResult> & results)
+{
+	FILE * dst = strcmp(path, "-") ? fopen(path, "w") : stdout;
+	if(!dst)
+		return false;
+
+	char timestamp[32];
+	time_t now = time(nullptr);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(dst, "{\n");
+	fprintf(dst, "\t\"schema\": 1,\n");
+	fprintf(dst, "\t\"sfse_version\": \"%d.%d.%d\",\n", SFSE_VERSION_INTEGER, SFSE_VERSION_INTEGER_MINOR, SFSE_VERSION_INTEGER_BETA);
+	fprintf(dst, "\t\"timestamp\": \"%s\",\n", timestamp);
+	fprintf(dst, "\t\"platform\": \"%s\",\n", GetPlatformName());
+	fprintf(dst, "\t\"compiler\": ");
+	WriteJSONString(dst, GetCompilerName());
+	fprintf(dst, ",\n");
+	fprintf(dst, "\t\"min_time_ms\": %u,\n", options.minTimeMS);
+	fprintf(dst, "\t\"repetitions\": %u,\n", options.repetitions);
+	fprintf(dst, "\t\"benchmarks\": [");
+
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult & result = results[i];
+
+		fprintf(dst, "%s\n\t\t{\n", i ? "," : "");
+		fprintf(dst, "\t\t\t\"name\": ");
+		WriteJSONString(dst, result.name.c_str());
+		fprintf(dst, ",\n");
+		fprintf(dst, "\t\t\t\"iterations\": %llu,\n", result.iterations);
+		fprintf(dst, "\t\t\t\"bytes_per_op\": %llu,\n", result.bytesPerOp);
+		fprintf(dst, "\t\t\t\"ns_per_op_min\": %.3f,\n", result.min());
+		fprintf(dst, "\t\t\t\"ns_per_op_median\": %.3f,\n", result.median());
+		fprintf(dst, "\t\t\t\"ns_per_op\": [");
+
+		for(size_t j = 0; j < result.nsPerOp.size(); j++)
+			fprintf(dst, "%s%.3f", j ? ", " : "", result.nsPerOp[j]);
+
+		fprintf(dst, "]\n\t\t}");
+	}
+
+	fprintf(dst, "\n\t]\n}\n");
+
+	if(dst != stdout)
+		fclose(dst);
+
+	return true;
+}
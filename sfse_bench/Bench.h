@@ -0,0 +1,70 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <string>
+#include <vector>
+
+// minimal micro-benchmark harness
+//
+// a benchmark is a function that runs its operation state.iterations times. the harness grows the iteration
+// count until one run takes at least the minimum time, then repeats that run and keeps every repetition so
+// the report can show min and median. results go to stdout as a table and optionally to a JSON file, which is
+// what release-to-release comparisons should diff. every benchmark is first called once with 0 iterations, which
+// is where expensive fixtures get built and results checked.
+
+class BenchState
+{
+public:
+	BenchState(u64 iterations) :iterations(iterations), bytesPerOp(0) { }
+
+	u64	iterations;
+	u64	bytesPerOp;		// optional, enables throughput in the report
+};
+
+typedef void (* BenchFn)(BenchState & state);
+
+// keeps results alive without compiler-specific barriers
+extern volatile u64 g_benchSink;
+
+inline void Bench_Keep(u64 value)
+{
+	g_benchSink = g_benchSink + value;
+}
+
+void Bench_Register(const char * group, const char * name, BenchFn fn);
+
+// scratch files go here
+const std::string & Bench_GetTempDir();
+void Bench_SetTempDir(const char * path);
+
+struct BenchResult
+{
+	std::string			name;			// group/name
+	u64					iterations;		// per repetition
+	u64					bytesPerOp;
+	std::vector <f64>	nsPerOp;		// one per repetition
+
+	f64	min() const;
+	f64	median() const;
+};
+
+struct BenchOptions
+{
+	BenchOptions() :minTimeMS(200), repetitions(5) { }
+
+	std::string	filter;			// substring of group/name, empty = everything
+	u32			minTimeMS;
+	u32			repetitions;
+};
+
+void Bench_List();
+void Bench_Run(const BenchOptions & options, std::vector <BenchResult> * results);
+
+void Bench_PrintTable(const std::vector <BenchResult> & results);
+bool Bench_WriteJSON(const char * path, const BenchOptions & options, const std::vector <BenchResult> & results);
+
+#define BENCH_REGISTER(group, name)												\
+	static void Bench_##group##_##name(BenchState & state);						\
+	static const bool s_registered_##group##_##name =							\
+		(Bench_Register(#group, #name, Bench_##group##_##name), true);			\
+	static void Bench_##group##_##name(BenchState & state)
@@ -0,0 +1,2237 @@
+#include "Bench.h"
+#include "sfse/DispatchStub.h"
+#include "sfse_common/AllocTracker.h"
+#include "sfse_common/BA2Archive.h"
+#include "sfse_common/BranchTrampoline.h"
+#include "sfse_common/BufferStream.h"
+#include "sfse_common/CPUTopology.h"
+#include "sfse_common/EditorIDMap.h"
+#include "sfse_common/FileStream.h"
+#include "sfse_common/FlightRecorder.h"
+#include "sfse_common/Log.h"
+#include "sfse_common/MappedStream.h"
+#include "sfse_common/Metrics.h"
+#include "sfse_common/Platform.h"
+#include "sfse_common/PluginFileIndex.h"
+#include "sfse_common/Relocation.h"
+#include "sfse_common/SlabHeap.h"
+#include "sfse_common/Telemetry.h"
+#include "sfse_common/Utilities.h"
+#include "sfse_loader/EntryStub.h"
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+// streams
+
+enum
+{
+	kScratchFileSize = 16 * 1024 * 1024,
+	kBlockSize = 64 * 1024,
+};
+
+// written once and reused, reads come from the page cache after the first run
+static const std::string & GetScratchFile()
+{
+	static std::string path;
+
+	if(path.empty())
+	{
+		path = Bench_GetTempDir() + "/sfse_bench_scratch.bin";
+
+		std::vector <u8> block(kBlockSize);
+		for(u32 i = 0; i < kBlockSize; i++)
+			block[i] = u8(i * 31);
+
+		FileStream file;
+		if(file.create(path.c_str()))
+		{
+			for(u32 i = 0; i < kScratchFileSize / kBlockSize; i++)
+				file.write(block.data(), block.size());
+		}
+		else
+		{
+			fprintf(stderr, "couldn't create %s\n", path.c_str());
+		}
+	}
+
+	return path;
+}
+
+static std::vector <u8> & GetScratchBuffer()
+{
+	static std::vector <u8> buf(1024 * 1024, 0x5A);
+	return buf;
+}
+
+BENCH_REGISTER(stream, buffer_r32)
+{
+	std::vector <u8> & buf = GetScratchBuffer();
+
+	BufferStream stream;
+	stream.attach(buf.data(), buf.size());
+
+	u64 sum = 0;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		if(stream.remain() < sizeof(u32))
+			stream.seek(0);
+
+		sum += stream.r32();
+	}
+
+	Bench_Keep(sum);
+	state.bytesPerOp = sizeof(u32);
+}
+
+BENCH_REGISTER(stream, buffer_read_4k)
+{
+	std::vector <u8> & buf = GetScratchBuffer();
+	u8 dst[4096];
+
+	BufferStream stream;
+	stream.attach(buf.data(), buf.size());
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		if(stream.remain() < sizeof(dst))
+			stream.seek(0);
+
+		stream.read(dst, sizeof(dst));
+	}
+
+	Bench_Keep(dst[0]);
+	state.bytesPerOp = sizeof(dst);
+}
+
+BENCH_REGISTER(stream, file_read_64k)
+{
+	std::vector <u8> dst(kBlockSize);
+
+	FileStream stream;
+	if(!stream.open(GetScratchFile().c_str()))
+		return;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		if(stream.remain() < dst.size())
+			stream.seek(0);
+
+		stream.read(dst.data(), dst.size());
+	}
+
+	Bench_Keep(dst[0]);
+	state.bytesPerOp = dst.size();
+}
+
+BENCH_REGISTER(stream, mapped_read_64k)
+{
+	std::vector <u8> dst(kBlockSize);
+
+	MappedStream stream;
+	if(!stream.open(GetScratchFile().c_str()))
+		return;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		if(stream.remain() < dst.size())
+			stream.seek(0);
+
+		stream.read(dst.data(), dst.size());
+	}
+
+	Bench_Keep(dst[0]);
+	state.bytesPerOp = dst.size();
+}
+
+// logging
+
+// the null device keeps this measuring formatting and stdio buffering rather than the disk
+static void OpenBenchLog()
+{
+	static bool opened = false;
+
+	if(!opened)
+	{
+#ifdef _WIN32
+		DebugLog::open("NUL");
+#else
+		DebugLog::open("/dev/null");
+#endif
+		opened = true;
+	}
+}
+
+BENCH_REGISTER(log, message_to_file)
+{
+	OpenBenchLog();
+
+	// _DMESSAGE goes to the file but not the console at the default levels
+	for(u64 i = 0; i < state.iterations; i++)
+		_DMESSAGE("plugin %s: loaded handle %d at %016llX", "BenchPlugin.dll", int(i & 0xFF), i);
+
+	DebugLog::flush();
+}
+
+BENCH_REGISTER(log, short_message_to_file)
+{
+	OpenBenchLog();
+
+	for(u64 i = 0; i < state.iterations; i++)
+		_DMESSAGE("done");
+
+	DebugLog::flush();
+}
+
+// what the flight recorder adds to each line, a 1MB ring so it wraps many times per run
+BENCH_REGISTER(log, flight_recorder_write)
+{
+	static FlightRecorder * recorder = nullptr;
+
+	if(!recorder)
+	{
+		recorder = new FlightRecorder;
+		if(!recorder->open((Bench_GetTempDir() + "/sfse_bench_scratch.ring").c_str(), 1024 * 1024))
+			fprintf(stderr, "couldn't create flight recorder ring\n");
+	}
+
+	static const char kLine[] = "plugin BenchPlugin.dll: loaded handle 12 at 00007FF6A0001000";
+
+	for(u64 i = 0; i < state.iterations; i++)
+		recorder->write(DebugLog::kLevel_DebugMessage, kLine, sizeof(kLine) - 1);
+
+	state.bytesPerOp = sizeof(kLine) - 1;
+}
+
+// what sfse_flightlog does with a ring file: a 64KB ring that has wrapped several times, records of varying
+// length. the decoder is checked once before timing against the ring, a copy with one record corrupted and a
+// truncated copy
+enum
+{
+	kBenchRingSize = 64 * 1024,
+	kBenchRingRecords = 4096,
+};
+
+static std::string MakeBenchRingText(u64 sequence)
+{
+	char text[128];
+	int len = snprintf(text, sizeof(text), "flight record %llu ", (unsigned long long)sequence);
+
+	std::string result(text, len);
+	result.append((sequence * 7) % 64, 'x');
+
+	return result;
+}
+
+static bool IsBenchRingEntry(const FlightRecorderEntry & entry)
+{
+	return (entry.level == entry.sequence % 5) && (entry.text == MakeBenchRingText(entry.sequence));
+}
+
+// offset of the intact record with this sequence in a ring image, or -1
+static s64 FindBenchRingRecord(const std::vector <u8> & image, u64 sequence)
+{
+	for(u64 pos = sizeof(FlightRecorderHeader); pos + sizeof(FlightRecord) <= image.size(); pos += kFlightRecordAlign)
+	{
+		const FlightRecord * record = (const FlightRecord *)&image[pos];
+
+		if((record->magic.load(std::memory_order_relaxed) == kFlightRecordMagic) && (record->sequence == sequence))
+			return s64(pos);
+	}
+
+	return -1;
+}
+
+static void CheckBenchRing(const std::vector <u8> & image)
+{
+	std::vector <FlightRecorderEntry> entries;
+
+	if(!FlightRecorder_Decode(image.data(), image.size(), nullptr, &entries) || entries.empty())
+	{
+		fprintf(stderr, "generated flight recorder ring didn't decode\n");
+		return;
+	}
+
+	// newest records, in order. the only gap allowed is before the run that ends at the last record written,
+	// where older records survived at the end of the ring past where a newer one didn't fit
+	u32 runStart = 0;
+
+	for(u32 i = 0; i < entries.size(); i++)
+	{
+		if(!IsBenchRingEntry(entries[i]))
+			fprintf(stderr, "flight recorder record %llu doesn't match what was written\n", (unsigned long long)entries[i].sequence);
+
+		if(i && (entries[i].sequence <= entries[i - 1].sequence))
+			fprintf(stderr, "flight recorder records %u and %u are out of order\n", i - 1, i);
+		else if(i && (entries[i].sequence != entries[i - 1].sequence + 1))
+			runStart = i;
+	}
+
+	// records are at most 120 bytes, the header and 82 of text rounded up
+	u32 runLength = u32(entries.size()) - runStart;
+
+	if((entries.back().sequence != kBenchRingRecords - 1) || (runLength < kBenchRingSize / 120 - 1))
+	{
+		fprintf(stderr, "flight recorder ring decoded to %u newest records ending at %llu\n",
+			runLength, (unsigned long long)entries.back().sequence);
+	}
+
+	// one flipped byte in a record from the middle drops that record and nothing else
+	const FlightRecorderEntry & victim = entries[runStart + runLength / 2];
+	s64 victimOffset = FindBenchRingRecord(image, victim.sequence);
+
+	if(victimOffset >= 0)
+	{
+		std::vector <u8> corrupt(image);
+		corrupt[victimOffset + sizeof(FlightRecord) + 3] ^= 0x20;
+
+		std::vector <FlightRecorderEntry> decoded;
+		FlightRecorder_Decode(corrupt.data(), corrupt.size(), nullptr, &decoded);
+
+		bool matches = decoded.size() + 1 == entries.size();
+
+		for(u32 i = 0, j = 0; matches && (i < entries.size()); i++)
+		{
+			if(entries[i].sequence == victim.sequence)
+				continue;
+
+			matches = (decoded[j].sequence == entries[i].sequence) && (decoded[j].text == entries[i].text);
+			j++;
+		}
+
+		if(!matches)
+			fprintf(stderr, "flight recorder ring with record %llu corrupted didn't decode to the rest\n", (unsigned long long)victim.sequence);
+	}
+	else
+		fprintf(stderr, "couldn't find flight recorder record %llu\n", (unsigned long long)victim.sequence);
+
+	// a copy cut off part way through a record keeps the records before the cut
+	u64 cut = image.size() / 2 + 3;
+
+	std::vector <FlightRecorderEntry> expected;
+
+	for(auto & entry : entries)
+	{
+		s64 offset = FindBenchRingRecord(image, entry.sequence);
+		const FlightRecord * record = (const FlightRecord *)&image[offset];
+
+		if(u64(offset) + record->size <= cut)
+			expected.push_back(entry);
+	}
+
+	std::vector <FlightRecorderEntry> truncated;
+
+	if(!FlightRecorder_Decode(image.data(), cut, nullptr, &truncated) ||
+		(truncated.size() != expected.size()) || expected.empty() ||
+		!std::equal(truncated.begin(), truncated.end(), expected.begin(), [](const FlightRecorderEntry & lhs, const FlightRecorderEntry & rhs)
+			{ return (lhs.sequence == rhs.sequence) && (lhs.text == rhs.text); }))
+	{
+		fprintf(stderr, "truncated flight recorder ring didn't decode to the records before the cut\n");
+	}
+
+	if(FlightRecorder_Decode(image.data(), sizeof(FlightRecorderHeader) - 1, nullptr, &truncated))
+		fprintf(stderr, "flight recorder ring cut off inside its header decoded\n");
+}
+
+static const std::vector <u8> & GetBenchRing()
+{
+	static std::vector <u8> * image = nullptr;
+
+	if(!image)
+	{
+		image = new std::vector <u8>;
+
+		std::string path = Bench_GetTempDir() + "/sfse_bench_decode.ring";
+
+		FlightRecorder recorder;
+		if(!recorder.open(path.c_str(), kBenchRingSize))
+		{
+			fprintf(stderr, "couldn't create flight recorder ring\n");
+			return *image;
+		}
+
+		for(u64 i = 0; i < kBenchRingRecords; i++)
+		{
+			std::string text = MakeBenchRingText(i);
+			recorder.write(u32(i % 5), text.data(), u32(text.size()));
+		}
+
+		recorder.close();
+
+		// read back the way sfse_flightlog would
+		FILE * f = fopen(path.c_str(), "rb");
+		if(f)
+		{
+			image->resize(sizeof(FlightRecorderHeader) + kBenchRingSize);
+			image->resize(fread(image->data(), 1, image->size(), f));
+			fclose(f);
+		}
+
+		CheckBenchRing(*image);
+	}
+
+	return *image;
+}
+
+BENCH_REGISTER(log, flight_recorder_decode)
+{
+	const std::vector <u8> & image = GetBenchRing();
+
+	std::vector <FlightRecorderEntry> entries;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		FlightRecorder_Decode(image.data(), image.size(), nullptr, &entries);
+		Bench_Keep(entries.size());
+	}
+
+	state.bytesPerOp = image.size();
+}
+
+// PE export lookup
+
+// in-memory PE32+ image with just enough of the headers for getResourceLibraryProcAddress
+class SyntheticImage
+{
+public:
+	SyntheticImage(u32 numExports, const char * lastExport)
+	{
+		std::vector <std::string> names;
+
+		for(u32 i = 0; i + 1 < numExports; i++)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "Export%04d", i);
+			names.push_back(name);
+		}
+
+		names.push_back(lastExport);
+
+		const u32 kNTOffset = sizeof(IMAGE_DOS_HEADER);
+		const u32 kExportOffset = 0x200;
+
+		u32 functionsOffset = kExportOffset + sizeof(IMAGE_EXPORT_DIRECTORY);
+		u32 namesOffset = functionsOffset + numExports * sizeof(u32);
+		u32 ordinalsOffset = namesOffset + numExports * sizeof(u32);
+		u32 stringsOffset = ordinalsOffset + numExports * sizeof(u16);
+
+		u32 size = stringsOffset;
+		for(auto & name : names)
+			size += u32(name.size() + 1);
+
+		// u64 storage so the base is aligned, the lookup masks off the low bits
+		m_data.resize((size + 7) / 8, 0);
+
+		u8 * base = (u8 *)m_data.data();
+
+		auto * dosHeader = (IMAGE_DOS_HEADER *)base;
+		dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+		dosHeader->e_lfanew = kNTOffset;
+
+		auto * ntHeader = (IMAGE_NT_HEADERS *)(base + kNTOffset);
+		ntHeader->Signature = IMAGE_NT_SIGNATURE;
+		ntHeader->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+		ntHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress = kExportOffset;
+
+		auto * exportTable = (IMAGE_EXPORT_DIRECTORY *)(base + kExportOffset);
+		exportTable->NumberOfFunctions = numExports;
+		exportTable->NumberOfNames = numExports;
+		exportTable->AddressOfFunctions = functionsOffset;
+		exportTable->AddressOfNames = namesOffset;
+		exportTable->AddressOfNameOrdinals = ordinalsOffset;
+
+		auto * functions = (u32 *)(base + functionsOffset);
+		auto * nameRVAs = (u32 *)(base + namesOffset);
+		auto * ordinals = (u16 *)(base + ordinalsOffset);
+
+		u32 stringOffset = stringsOffset;
+
+		for(u32 i = 0; i < numExports; i++)
+		{
+			functions[i] = 0x1000 + i * 0x10;
+			nameRVAs[i] = stringOffset;
+			ordinals[i] = u16(i);
+
+			memcpy(base + stringOffset, names[i].c_str(), names[i].size() + 1);
+			stringOffset += u32(names[i].size() + 1);
+		}
+	}
+
+	const void * base() const { return m_data.data(); }
+
+private:
+	std::vector <u64>	m_data;
+};
+
+BENCH_REGISTER(pe, export_lookup_plugin)
+{
+	// typical plugin dll, the loader looks for the version export
+	static SyntheticImage image(4, "SFSEPlugin_Version");
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(uintptr_t(getResourceLibraryProcAddress(image.base(), "SFSEPlugin_Version")));
+}
+
+BENCH_REGISTER(pe, export_lookup_large)
+{
+	static SyntheticImage image(1024, "SFSEPlugin_Version");
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(uintptr_t(getResourceLibraryProcAddress(image.base(), "SFSEPlugin_Version")));
+}
+
+BENCH_REGISTER(pe, is_64bit)
+{
+	static SyntheticImage image(1, "SFSEPlugin_Version");
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(is64BitDLL(image.base()));
+}
+
+// member function relocation
+
+// DEFINE_MEMBER_FN_* read a pointer-to-member out of the slot, which is only pointer sized with MSVC, so these
+// call through the slot with a plain function pointer instead. the object goes in the first argument register
+// either way. the table is rebased on to a stand-in base so the slot lands on BenchMemberFn_Target
+enum
+{
+	kBenchMemberFnOffset = 0x1000,
+};
+
+struct BenchMemberFnObject
+{
+	u64	value;
+};
+
+typedef u64 (* BenchMemberFn)(BenchMemberFnObject * obj, u64 arg);
+
+static u64 BenchMemberFn_Target(BenchMemberFnObject * obj, u64 arg)
+{
+	return obj->value += arg;
+}
+
+static bool SetUpMemberFnTable()
+{
+	static bool result = false;
+
+	if(!result)
+	{
+		RelocationManager::Rebase(uintptr_t(&BenchMemberFn_Target) - kBenchMemberFnOffset);
+
+		result = RelocMemberFn <kBenchMemberFnOffset>::s_addr == uintptr_t(&BenchMemberFn_Target);
+		if(!result)
+			fprintf(stderr, "member function table wasn't rebased\n");
+	}
+
+	return result;
+}
+
+// current DEFINE_MEMBER_FN_*: one load from the rebased slot
+BENCH_REGISTER(reloc, member_fn_slot)
+{
+	if(!SetUpMemberFnTable())
+		return;
+
+	BenchMemberFnObject obj = { 0 };
+
+	// the same single load the macros do, without type punning the slot for GCC's aliasing rules
+	for(u64 i = 0; i < state.iterations; i++)
+		reinterpret_cast <BenchMemberFn>(RelocMemberFn <kBenchMemberFnOffset>::s_addr)(&obj, i);
+
+	Bench_Keep(obj.value);
+}
+
+// what DEFINE_MEMBER_FN_LONG did before: relocate and store to a static on every call
+static BenchMemberFn * BenchMemberFn_GetPtrStore()
+{
+	static uintptr_t _address;
+	_address = kBenchMemberFnOffset + RelocationManager::s_baseAddr;
+	return (BenchMemberFn *)&_address;
+}
+
+BENCH_REGISTER(reloc, member_fn_store)
+{
+	if(!SetUpMemberFnTable())
+		return;
+
+	BenchMemberFnObject obj = { 0 };
+
+	for(u64 i = 0; i < state.iterations; i++)
+		(*BenchMemberFn_GetPtrStore())(&obj, i);
+
+	Bench_Keep(obj.value);
+}
+
+// what DEFINE_MEMBER_FN_0..10 did before: a thread-safe function-local static
+static BenchMemberFn * BenchMemberFn_GetPtrGuarded()
+{
+	const static uintptr_t address = kBenchMemberFnOffset + RelocationManager::s_baseAddr;
+	return (BenchMemberFn *)&address;
+}
+
+BENCH_REGISTER(reloc, member_fn_guarded)
+{
+	if(!SetUpMemberFnTable())
+		return;
+
+	BenchMemberFnObject obj = { 0 };
+
+	for(u64 i = 0; i < state.iterations; i++)
+		(*BenchMemberFn_GetPtrGuarded())(&obj, i);
+
+	Bench_Keep(obj.value);
+}
+
+// trampoline
+
+enum
+{
+	kTrampolineSize = 64 * 1024,	// same as sfse
+};
+
+BENCH_REGISTER(trampoline, create_destroy)
+{
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		BranchTrampoline trampoline;
+
+		Bench_Keep(trampoline.create(kTrampolineSize));
+	}
+}
+
+BENCH_REGISTER(trampoline, allocate)
+{
+	// one op is one pointer-sized slot, refilling the trampoline is amortized over the slots
+	BranchTrampoline trampoline;
+
+	if(!trampoline.create(kTrampolineSize))
+		return;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		void * slot = trampoline.allocate();
+		if(!slot)
+		{
+			trampoline.destroy();
+			trampoline.create(kTrampolineSize);
+
+			slot = trampoline.allocate();
+		}
+
+		Bench_Keep(uintptr_t(slot));
+	}
+}
+
+BENCH_REGISTER(trampoline, start_end_alloc)
+{
+	BranchTrampoline trampoline;
+
+	if(!trampoline.create(kTrampolineSize))
+		return;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		if(trampoline.remain() < 32)
+		{
+			trampoline.destroy();
+			trampoline.create(kTrampolineSize);
+		}
+
+		u8 * code = (u8 *)trampoline.startAlloc();
+		trampoline.endAlloc(code + 32);
+
+		Bench_Keep(uintptr_t(code));
+	}
+}
+
+// plugin name lookup
+
+// PluginManager lives in sfse and doesn't build off Windows. infoByName and lookupHandleFromName are a linear
+// case-insensitive scan over the loaded plugin list, so this is the same scan over a list the size of a large
+// load order
+class PluginNameList
+{
+public:
+	PluginNameList(u32 numPlugins)
+	{
+		for(u32 i = 0; i < numPlugins; i++)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "SomeAuthor_PluginNumber%03d", i);
+			m_names.push_back(name);
+		}
+	}
+
+	s32 lookup(const char * name) const
+	{
+		for(size_t i = 0; i < m_names.size(); i++)
+			if(!_stricmp(name, m_names[i].c_str()))
+				return s32(i);
+
+		return -1;
+	}
+
+private:
+	std::vector <std::string>	m_names;
+};
+
+BENCH_REGISTER(plugin, name_lookup_last)
+{
+	static PluginNameList plugins(64);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(plugins.lookup("someauthor_pluginnumber063"));
+}
+
+BENCH_REGISTER(plugin, name_lookup_missing)
+{
+	static PluginNameList plugins(64);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(plugins.lookup("SomeAuthor_NotInstalled"));
+}
+
+// metrics
+
+// contended runs put every thread through the whole iteration count at once, so ns/op is the time each op
+// takes while all of them are recording
+static u32 GetNumContendingThreads()
+{
+	u32 numThreads = std::thread::hardware_concurrency();
+
+	return std::max(2u, std::min(numThreads, 8u));
+}
+
+template <typename Fn>
+static void RunOnThreads(Fn fn)
+{
+	std::vector <std::thread> threads;
+
+	for(u32 i = 0; i < GetNumContendingThreads(); i++)
+		threads.emplace_back(fn);
+
+	for(auto & thread : threads)
+		thread.join();
+}
+
+// spread over several magnitudes so histograms touch many buckets
+static inline u64 GetSampleValue(u64 i)
+{
+	return ((i * 0x9E3779B97F4A7C15ull) >> 40) >> (i & 15);
+}
+
+BENCH_REGISTER(metrics, counter_add)
+{
+	static u32 counter = Metrics_Register("bench.counter", kMetricType_Counter);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Metrics_Add(counter);
+}
+
+BENCH_REGISTER(metrics, counter_add_contended)
+{
+	static u32 counter = Metrics_Register("bench.counter", kMetricType_Counter);
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		for(u64 i = 0; i < iterations; i++)
+			Metrics_Add(counter);
+	});
+}
+
+// what a single shared counter costs under the same load, for comparison
+BENCH_REGISTER(metrics, shared_atomic_contended)
+{
+	static std::atomic <u64> counter(0);
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		for(u64 i = 0; i < iterations; i++)
+			counter.fetch_add(1, std::memory_order_relaxed);
+	});
+}
+
+BENCH_REGISTER(metrics, gauge_set)
+{
+	static u32 gauge = Metrics_Register("bench.gauge", kMetricType_Gauge);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Metrics_SetGauge(gauge, s64(i));
+}
+
+BENCH_REGISTER(metrics, histogram_record)
+{
+	static u32 histogram = Metrics_Register("bench.histogram", kMetricType_Histogram);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Metrics_Record(histogram, GetSampleValue(i));
+}
+
+BENCH_REGISTER(metrics, histogram_record_contended)
+{
+	static u32 histogram = Metrics_Register("bench.histogram", kMetricType_Histogram);
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		for(u64 i = 0; i < iterations; i++)
+			Metrics_Record(histogram, GetSampleValue(i));
+	});
+}
+
+BENCH_REGISTER(metrics, snapshot)
+{
+	// a handful of each type, as a plugin-heavy setup might have
+	static bool registered = false;
+	if(!registered)
+	{
+		for(u32 i = 0; i < 16; i++)
+		{
+			char name[64];
+
+			snprintf(name, sizeof(name), "bench.snapshot.counter%d", i);
+			Metrics_Add(Metrics_Register(name, kMetricType_Counter), i);
+
+			snprintf(name, sizeof(name), "bench.snapshot.histogram%d", i);
+			u32 histogram = Metrics_Register(name, kMetricType_Histogram);
+			for(u32 j = 0; j < 1000; j++)
+				Metrics_Record(histogram, GetSampleValue(j));
+		}
+
+		registered = true;
+	}
+
+	std::vector <MetricsSnapshot> snapshots(Metrics_Snapshot(nullptr, 0) + 64);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(Metrics_Snapshot(snapshots.data(), u32(snapshots.size())));
+}
+
+// telemetry
+
+// a segment of synthetic metrics where every field is derived from the publish number, so a reader can tell a
+// torn frame from a good one. the seqlock is checked once before timing with a writer thread running flat out
+enum
+{
+	kBenchTelemetryEntries = 64,
+	kBenchTelemetryCheckPublishes = 100000,
+};
+
+static void FillBenchTelemetry(std::vector <MetricsSnapshot> * metrics, u64 publish)
+{
+	static char names[kBenchTelemetryEntries][32];
+
+	metrics->resize(kBenchTelemetryEntries);
+
+	for(u32 i = 0; i < kBenchTelemetryEntries; i++)
+	{
+		if(!names[i][0])
+			snprintf(names[i], sizeof(names[i]), "bench.telemetry%u", i);
+
+		MetricsSnapshot & dst = (*metrics)[i];
+
+		memset(&dst, 0, sizeof(dst));
+
+		dst.name = names[i];
+		dst.type = kMetricType_Histogram;
+		dst.count = publish;
+		dst.value = s64(publish * (i + 1));
+		dst.sum = publish + i;
+	}
+}
+
+static bool IsBenchTelemetryFrameIntact(const TelemetryFrame & frame)
+{
+	// a fresh writer bumps the sequence by two per publish
+	if(frame.sequence != frame.publishCount * 2)
+		return false;
+
+	if(frame.entries.size() != (frame.publishCount ? kBenchTelemetryEntries : 0))
+		return false;
+
+	for(u32 i = 0; i < frame.entries.size(); i++)
+	{
+		const TelemetryEntry & entry = frame.entries[i];
+
+		if((entry.count != frame.publishCount) ||
+			(entry.value != s64(frame.publishCount * (i + 1))) ||
+			(entry.sum != frame.publishCount + i))
+			return false;
+	}
+
+	return true;
+}
+
+static void CheckBenchTelemetry()
+{
+	TelemetryWriter writer;
+	TelemetryReader reader;
+
+	if(!writer.create("sfse_bench_telemetry_check", kBenchTelemetryEntries) || !reader.open("sfse_bench_telemetry_check"))
+	{
+		fprintf(stderr, "couldn't create the telemetry check segment\n");
+		return;
+	}
+
+	std::atomic <bool> done(false);
+
+	std::thread publisher([&]()
+	{
+		std::vector <MetricsSnapshot> metrics;
+
+		for(u64 i = 1; i <= kBenchTelemetryCheckPublishes; i++)
+		{
+			FillBenchTelemetry(&metrics, i);
+			writer.publish(metrics.data(), u32(metrics.size()));
+		}
+
+		done = true;
+	});
+
+	TelemetryFrame frame;
+	u64 lastSequence = 0;
+	u64 numReads = 0;
+	u64 numBad = 0;
+
+	while(!done)
+	{
+		if(reader.read(&frame) != TelemetryReader::kRead_OK)
+			continue;
+
+		numReads++;
+
+		if(frame.sequence < lastSequence)
+		{
+			fprintf(stderr, "telemetry sequence went back from %llu to %llu\n", (unsigned long long)lastSequence, (unsigned long long)frame.sequence);
+			numBad++;
+		}
+		else if(!IsBenchTelemetryFrameIntact(frame))
+		{
+			if(!numBad)
+				fprintf(stderr, "telemetry frame %llu doesn't match its sequence\n", (unsigned long long)frame.sequence);
+
+			numBad++;
+		}
+
+		lastSequence = frame.sequence;
+	}
+
+	publisher.join();
+
+	if((reader.read(&frame) != TelemetryReader::kRead_OK) || (frame.publishCount != kBenchTelemetryCheckPublishes) || !IsBenchTelemetryFrameIntact(frame))
+		fprintf(stderr, "last telemetry frame doesn't match the last publish\n");
+
+	if(numBad)
+		fprintf(stderr, "%llu of %llu telemetry reads were torn or out of order\n", (unsigned long long)numBad, (unsigned long long)numReads);
+}
+
+static TelemetryWriter & GetBenchTelemetryWriter()
+{
+	static TelemetryWriter * writer = nullptr;
+
+	if(!writer)
+	{
+		CheckBenchTelemetry();
+
+		writer = new TelemetryWriter;
+		if(!writer->create("sfse_bench_telemetry", kBenchTelemetryEntries))
+			fprintf(stderr, "couldn't create the telemetry segment\n");
+	}
+
+	return *writer;
+}
+
+BENCH_REGISTER(telemetry, publish)
+{
+	TelemetryWriter & writer = GetBenchTelemetryWriter();
+
+	std::vector <MetricsSnapshot> metrics;
+	FillBenchTelemetry(&metrics, 1);
+
+	state.bytesPerOp = kBenchTelemetryEntries * sizeof(TelemetryEntry);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		writer.publish(metrics.data(), u32(metrics.size()));
+}
+
+// an overlay polling while the game publishes back to back, far more often than the real interval. ns/op
+// includes the retries
+BENCH_REGISTER(telemetry, read_contended)
+{
+	TelemetryWriter & writer = GetBenchTelemetryWriter();
+
+	static TelemetryReader * reader = nullptr;
+	if(!reader)
+	{
+		reader = new TelemetryReader;
+		if(!reader->open("sfse_bench_telemetry"))
+			fprintf(stderr, "couldn't open the telemetry segment\n");
+	}
+
+	if(!state.iterations)
+		return;
+
+	std::atomic <bool> done(false);
+
+	std::thread publisher([&]()
+	{
+		std::vector <MetricsSnapshot> metrics;
+		FillBenchTelemetry(&metrics, 1);
+
+		while(!done)
+			writer.publish(metrics.data(), u32(metrics.size()));
+	});
+
+	TelemetryFrame frame;
+
+	state.bytesPerOp = kBenchTelemetryEntries * sizeof(TelemetryEntry);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(reader->read(&frame));
+
+	done = true;
+	publisher.join();
+}
+
+// heap
+
+// the same patterns through SlabHeap and the system allocator. one op is one allocation and its free
+struct SlabHeapOps
+{
+	static void * allocate(size_t size)	{ return g_slabHeap.allocate(size); }
+	static void free(void * ptr)		{ g_slabHeap.free(ptr); }
+};
+
+struct MallocOps
+{
+	static void * allocate(size_t size)	{ return malloc(size); }
+	static void free(void * ptr)		{ ::free(ptr); }
+};
+
+enum
+{
+	kHeapBatchSize = 256,
+};
+
+// typical small object sizes, repeated so batches mix them
+static const u32 kHeapBenchSizes[] = { 16, 24, 40, 64, 96, 128, 200, 320, 512, 1024 };
+
+template <typename Ops>
+static void HeapAllocFree(u64 iterations)
+{
+	for(u64 i = 0; i < iterations; i++)
+	{
+		void * ptr = Ops::allocate(64);
+		Bench_Keep(uintptr_t(ptr));
+		Ops::free(ptr);
+	}
+}
+
+// allocate a batch of mixed sizes then free all of it, closer to how game objects come and go
+template <typename Ops>
+static void HeapBatchMixed(u64 iterations)
+{
+	void * ptrs[kHeapBatchSize];
+	const u32 numSizes = sizeof(kHeapBenchSizes) / sizeof(kHeapBenchSizes[0]);
+
+	for(u64 i = 0; i < iterations; i += kHeapBatchSize)
+	{
+		u32 count = u32(std::min <u64>(kHeapBatchSize, iterations - i));
+
+		for(u32 j = 0; j < count; j++)
+		{
+			ptrs[j] = Ops::allocate(kHeapBenchSizes[(i + j) % numSizes]);
+			*(u8 *)ptrs[j] = u8(j);
+		}
+
+		for(u32 j = 0; j < count; j++)
+			Ops::free(ptrs[j]);
+	}
+}
+
+BENCH_REGISTER(heap, slab_alloc_free_64)
+{
+	HeapAllocFree <SlabHeapOps>(state.iterations);
+}
+
+BENCH_REGISTER(heap, malloc_alloc_free_64)
+{
+	HeapAllocFree <MallocOps>(state.iterations);
+}
+
+BENCH_REGISTER(heap, slab_batch_mixed)
+{
+	HeapBatchMixed <SlabHeapOps>(state.iterations);
+}
+
+BENCH_REGISTER(heap, malloc_batch_mixed)
+{
+	HeapBatchMixed <MallocOps>(state.iterations);
+}
+
+BENCH_REGISTER(heap, slab_batch_mixed_contended)
+{
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		HeapBatchMixed <SlabHeapOps>(iterations);
+	});
+}
+
+BENCH_REGISTER(heap, malloc_batch_mixed_contended)
+{
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		HeapBatchMixed <MallocOps>(iterations);
+	});
+}
+
+// plugin allocation accounting
+
+// the CRT calls a tracked plugin import makes, compare with heap/malloc_alloc_free_64 and malloc_batch_mixed
+static AllocTracker & GetBenchAllocTracker()
+{
+	static AllocTracker * tracker = new AllocTracker;
+	return *tracker;
+}
+
+struct TrackedMallocOps
+{
+	static void * allocate(size_t size)
+	{
+		void * result = malloc(size);
+		GetBenchAllocTracker().recordAlloc(1, result, size);
+		return result;
+	}
+
+	static void free(void * ptr)
+	{
+		GetBenchAllocTracker().recordFree(1, ptr);
+		::free(ptr);
+	}
+};
+
+BENCH_REGISTER(alloc_tracker, malloc_free_64)
+{
+	HeapAllocFree <TrackedMallocOps>(state.iterations);
+}
+
+BENCH_REGISTER(alloc_tracker, malloc_batch_mixed)
+{
+	HeapBatchMixed <TrackedMallocOps>(state.iterations);
+}
+
+BENCH_REGISTER(alloc_tracker, malloc_batch_mixed_contended)
+{
+	u64 iterations = state.iterations;
+
+	RunOnThreads([=]()
+	{
+		HeapBatchMixed <TrackedMallocOps>(iterations);
+	});
+}
+
+// editor ID map
+
+// a whole load order's worth. the lookup tables are built by the untimed first call. lookups cycle through
+// names spread across the map, so they pay for the cache misses a map this size really has
+enum
+{
+	kBenchEditorIDs = 1024 * 1024,
+	kBenchEditorIDLookups = 1024,	// power of two
+	kBenchEditorIDStride = 1000003,	// odd, spreads the lookups over the map
+};
+
+static void MakeBenchEditorID(u32 idx, char * out, size_t len)
+{
+	snprintf(out, len, "SomeQuest_Stage%05d_Alias%03dRef", idx >> 8, idx & 0xFF);
+}
+
+static u32 GetBenchEditorIDIndex(u32 lookup)
+{
+	return (lookup * kBenchEditorIDStride) % kBenchEditorIDs;
+}
+
+struct BenchEditorIDNames
+{
+	char	names[kBenchEditorIDLookups][40];
+
+	BenchEditorIDNames()
+	{
+		for(u32 i = 0; i < kBenchEditorIDLookups; i++)
+			MakeBenchEditorID(GetBenchEditorIDIndex(i), names[i], sizeof(names[i]));
+	}
+};
+
+static const BenchEditorIDNames & GetBenchEditorIDNames()
+{
+	static const BenchEditorIDNames * names = new BenchEditorIDNames;
+	return *names;
+}
+
+static const EditorIDMap & GetBenchEditorIDMap()
+{
+	static EditorIDMap * map = nullptr;
+
+	if(!map)
+	{
+		map = new EditorIDMap;
+
+		char name[64];
+		size_t nameBytes = 0;
+
+		for(u32 i = 0; i < kBenchEditorIDs; i++)
+		{
+			MakeBenchEditorID(i, name, sizeof(name));
+			map->add(0x01000000 + i, name);
+
+			nameBytes += strlen(name) + 1;
+		}
+
+		// the footprint is what decides whether the map can stay on by default
+		size_t bytes = map->memoryUsage();
+
+		fprintf(stderr, "editor_id: %u names in %.1f MB, %.1f bytes per name of which %.1f are the name\n",
+			map->size(), bytes / (1024.0 * 1024.0), f64(bytes) / map->size(), f64(nameBytes) / map->size());
+	}
+
+	return *map;
+}
+
+BENCH_REGISTER(editor_id, add_1m)
+{
+	char name[64];
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		EditorIDMap map;
+
+		for(u32 j = 0; j < kBenchEditorIDs; j++)
+		{
+			MakeBenchEditorID(j, name, sizeof(name));
+			map.add(0x01000000 + j, name);
+		}
+
+		Bench_Keep(map.size());
+	}
+}
+
+BENCH_REGISTER(editor_id, lookup_hit)
+{
+	const EditorIDMap & map = GetBenchEditorIDMap();
+	const BenchEditorIDNames & names = GetBenchEditorIDNames();
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(map.lookup(names.names[i & (kBenchEditorIDLookups - 1)]));
+}
+
+BENCH_REGISTER(editor_id, lookup_miss)
+{
+	const EditorIDMap & map = GetBenchEditorIDMap();
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(map.lookup("SomeQuest_Stage99999_Alias999Ref"));
+}
+
+BENCH_REGISTER(editor_id, get_editor_id)
+{
+	const EditorIDMap & map = GetBenchEditorIDMap();
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(uintptr_t(map.getEditorID(0x01000000 + GetBenchEditorIDIndex(u32(i) & (kBenchEditorIDLookups - 1)))));
+}
+
+// what the map replaces: a node per name, and no case folding
+BENCH_REGISTER(editor_id, unordered_map_lookup_hit)
+{
+	static std::unordered_map <std::string, u32> * map = nullptr;
+
+	char name[64];
+
+	if(!map)
+	{
+		map = new std::unordered_map <std::string, u32>;
+
+		for(u32 i = 0; i < kBenchEditorIDs; i++)
+		{
+			MakeBenchEditorID(i, name, sizeof(name));
+			(*map)[name] = 0x01000000 + i;
+		}
+	}
+
+	const BenchEditorIDNames & names = GetBenchEditorIDNames();
+
+	// std::string keys, so the conversion is part of the lookup as it would be for a caller holding a char *
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(map->find(names.names[i & (kBenchEditorIDLookups - 1)])->second);
+}
+
+// plugin file index
+
+// synthetic plugin in the on-disk format: a TES4 header with one master, then top-level groups of records that
+// each start with an EDID. every eighth record is compressed, as a zlib stream of stored blocks
+enum
+{
+	kBenchPluginGroups = 64,
+	kBenchPluginRecordsPerGroup = 2048,
+	kBenchPluginRecordData = 96,	// bytes of filler after the EDID
+};
+
+class SyntheticPlugin
+{
+public:
+	SyntheticPlugin()
+	{
+		std::vector <u8> header;
+		addSubrecord(&header, "MAST", "Starfield.esm", 14);
+		addRecord("TES4", 0, 0, header);
+
+		for(u32 group = 0; group < kBenchPluginGroups; group++)
+		{
+			size_t groupStart = m_data.size();
+			addHeader("GRUP", 0, 0, 0);
+
+			for(u32 i = 0; i < kBenchPluginRecordsPerGroup; i++)
+			{
+				u32 idx = group * kBenchPluginRecordsPerGroup + i;
+
+				char editorID[48];
+				makeEditorID(idx, editorID, sizeof(editorID));
+
+				std::vector <u8> data;
+				addSubrecord(&data, "EDID", editorID, u32(strlen(editorID) + 1));
+
+				std::vector <u8> filler(kBenchPluginRecordData, u8(idx));
+				addSubrecord(&data, "DATA", filler.data(), u32(filler.size()));
+
+				if(idx % 8)
+					addRecord("STAT", formID(idx), 0, data);
+				else
+					addRecord("STAT", formID(idx), PluginFileIndex::kRecordFlag_Compressed, compress(data));
+			}
+
+			put32(groupStart + 4, u32(m_data.size() - groupStart));
+		}
+	}
+
+	const std::vector <u8> & data() const { return m_data; }
+
+	static u32 formID(u32 idx) { return 0x01000800 + idx; }	// master count = the file itself
+
+	static void makeEditorID(u32 idx, char * out, size_t len)
+	{
+		snprintf(out, len, "BenchStatic%06d", idx);
+	}
+
+private:
+	void put32(size_t offset, u32 value)
+	{
+		memcpy(&m_data[offset], &value, sizeof(value));
+	}
+
+	void addHeader(const char * type, u32 size, u32 flags, u32 id)
+	{
+		u32 fields[6] = { size, flags, id, 0, 0, 0 };
+
+		m_data.insert(m_data.end(), type, type + 4);
+		m_data.insert(m_data.end(), (const u8 *)fields, (const u8 *)(fields + 5));
+	}
+
+	void addRecord(const char * type, u32 id, u32 flags, const std::vector <u8> & data)
+	{
+		addHeader(type, u32(data.size()), flags, id);
+		m_data.insert(m_data.end(), data.begin(), data.end());
+	}
+
+	static void addSubrecord(std::vector <u8> * out, const char * type, const void * data, u32 size)
+	{
+		u16 size16 = u16(size);
+		size_t pos = out->size();
+
+		out->resize(pos + 6 + size);
+
+		u8 * dst = out->data() + pos;
+		memcpy(dst, type, 4);
+		memcpy(dst + 4, &size16, 2);
+		memcpy(dst + 6, data, size);
+	}
+
+	// decompressed size, then a zlib header and a single final stored block. the adler32 isn't checked
+	static std::vector <u8> compress(const std::vector <u8> & data)
+	{
+		u32 size = u32(data.size());
+		u16 len = u16(size);
+		u16 nlen = u16(~len);
+
+		std::vector <u8> out((const u8 *)&size, (const u8 *)&size + 4);
+		out.push_back(0x78);
+		out.push_back(0x01);
+		out.push_back(0x01);
+		out.insert(out.end(), (const u8 *)&len, (const u8 *)&len + 2);
+		out.insert(out.end(), (const u8 *)&nlen, (const u8 *)&nlen + 2);
+		out.insert(out.end(), data.begin(), data.end());
+		out.insert(out.end(), 4, 0);
+
+		return out;
+	}
+
+	std::vector <u8>	m_data;
+};
+
+static const std::string & GetBenchPluginPath()
+{
+	static std::string path;
+
+	if(path.empty())
+	{
+		path = Bench_GetTempDir() + "/sfse_bench_plugin.esm";
+
+		SyntheticPlugin plugin;
+
+		FileStream file;
+		if(file.create(path.c_str()))
+			file.write(plugin.data().data(), plugin.data().size());
+		else
+			fprintf(stderr, "couldn't create %s\n", path.c_str());
+	}
+
+	return path;
+}
+
+BENCH_REGISTER(plugin_file, index_open)
+{
+	const std::string & path = GetBenchPluginPath();
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		PluginFileIndex index;
+		index.open(path.c_str());
+
+		Bench_Keep(index.numRecords());
+	}
+
+	FileStream file;
+	if(file.open(path.c_str()))
+		state.bytesPerOp = file.length();
+}
+
+BENCH_REGISTER(plugin_file, lookup_editor_id)
+{
+	static PluginFileIndex * index = nullptr;
+
+	if(!index)
+	{
+		index = new PluginFileIndex;
+		index->open(GetBenchPluginPath().c_str());
+	}
+
+	char editorID[48];
+	SyntheticPlugin::makeEditorID(kBenchPluginGroups * kBenchPluginRecordsPerGroup / 3, editorID, sizeof(editorID));
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		const PluginFileIndex::Record * record = index->lookupEditorID(editorID);
+		Bench_Keep(record ? record->formID : 0);
+	}
+}
+
+// BA2 archive reads
+
+// generated version 3 general archive. each file is one LZ4 chunk: literals, a long overlapping match, then
+// the literals-only final sequence, so decompression speed is mostly the match copy. the contents are checked
+// against the generator once before timing
+enum
+{
+	kBenchArchiveFiles = 64,
+	kBenchArchiveFileSize = 256 * 1024,
+	kBenchArchivePeriod = 16,
+};
+
+static void MakeBenchArchiveName(u32 idx, char * out, size_t len)
+{
+	snprintf(out, len, "meshes/bench/file%03d.nif", idx);
+}
+
+static u8 BenchArchiveByte(u32 file, u32 pos)
+{
+	return u8((file * 131) + (pos % kBenchArchivePeriod));
+}
+
+static void AppendBytes(std::vector <u8> * out, const void * data, size_t len)
+{
+	size_t pos = out->size();
+
+	out->resize(pos + len);
+	memcpy(out->data() + pos, data, len);
+}
+
+template <typename T>
+static void AppendValue(std::vector <u8> * out, T value)
+{
+	AppendBytes(out, &value, sizeof(value));
+}
+
+static void AppendLZ4Length(std::vector <u8> * out, size_t len)
+{
+	for(; len >= 255; len -= 255)
+		out->push_back(255);
+
+	out->push_back(u8(len));
+}
+
+static std::vector <u8> MakeBenchArchiveChunk(u32 file)
+{
+	std::vector <u8> out;
+	u8 literals[kBenchArchivePeriod];
+
+	for(u32 i = 0; i < kBenchArchivePeriod; i++)
+		literals[i] = BenchArchiveByte(file, i);
+
+	size_t matchLen = kBenchArchiveFileSize - (kBenchArchivePeriod * 2);
+
+	// 16 literals, then a match of matchLen at offset 16
+	out.push_back(0xFF);
+	AppendLZ4Length(&out, kBenchArchivePeriod - 15);
+	AppendBytes(&out, literals, sizeof(literals));
+	AppendValue <u16>(&out, kBenchArchivePeriod);
+	AppendLZ4Length(&out, matchLen - 4 - 15);
+
+	// 16 literals to finish
+	out.push_back(0xF0);
+	AppendLZ4Length(&out, kBenchArchivePeriod - 15);
+	AppendBytes(&out, literals, sizeof(literals));
+
+	return out;
+}
+
+static const std::string & GetBenchArchivePath()
+{
+	static std::string path;
+
+	if(path.empty())
+	{
+		path = Bench_GetTempDir() + "/sfse_bench_archive.ba2";
+
+		std::vector <std::vector <u8>> chunks;
+		for(u32 i = 0; i < kBenchArchiveFiles; i++)
+			chunks.push_back(MakeBenchArchiveChunk(i));
+
+		const u32 kHeaderSize = 36;
+		const u32 kEntrySize = 36;
+
+		u64 dataPos = kHeaderSize + (kBenchArchiveFiles * kEntrySize);
+		u64 nameTable = dataPos;
+
+		for(auto & chunk : chunks)
+			nameTable += chunk.size();
+
+		std::vector <u8> archive;
+		AppendBytes(&archive, "BTDX", 4);
+		AppendValue <u32>(&archive, 3);
+		AppendBytes(&archive, "GNRL", 4);
+		AppendValue <u32>(&archive, kBenchArchiveFiles);
+		AppendValue <u64>(&archive, nameTable);
+		AppendValue <u64>(&archive, 0);
+		AppendValue <u32>(&archive, 3);		// LZ4
+
+		for(u32 i = 0; i < kBenchArchiveFiles; i++)
+		{
+			AppendValue <u32>(&archive, i);			// name hash
+			AppendBytes(&archive, "nif\0", 4);
+			AppendValue <u32>(&archive, 0);			// directory hash
+			AppendValue <u32>(&archive, 0);			// flags
+			AppendValue <u64>(&archive, dataPos);
+			AppendValue <u32>(&archive, u32(chunks[i].size()));
+			AppendValue <u32>(&archive, kBenchArchiveFileSize);
+			AppendValue <u32>(&archive, 0xBAADF00D);	// alignment marker
+
+			dataPos += chunks[i].size();
+		}
+
+		for(auto & chunk : chunks)
+			AppendBytes(&archive, chunk.data(), chunk.size());
+
+		for(u32 i = 0; i < kBenchArchiveFiles; i++)
+		{
+			char name[64];
+			MakeBenchArchiveName(i, name, sizeof(name));
+
+			AppendValue <u16>(&archive, u16(strlen(name)));
+			AppendBytes(&archive, name, strlen(name));
+		}
+
+		FileStream file;
+		if(file.create(path.c_str()))
+			file.write(archive.data(), archive.size());
+		else
+			fprintf(stderr, "couldn't create %s\n", path.c_str());
+	}
+
+	return path;
+}
+
+static BA2Archive * OpenBenchArchive(u32 numThreads)
+{
+	BA2Archive * archive = new BA2Archive;
+
+	if(!archive->open(GetBenchArchivePath().c_str(), numThreads))
+	{
+		fprintf(stderr, "couldn't open generated archive\n");
+		return archive;
+	}
+
+	// every read decompresses
+	archive->setCacheSize(0);
+
+	std::vector <u8> buf(kBenchArchiveFileSize);
+
+	for(u32 i = 0; i < kBenchArchiveFiles; i++)
+	{
+		char name[64];
+		MakeBenchArchiveName(i, name, sizeof(name));
+
+		s32 idx = archive->find(name);
+		bool match = (idx >= 0) && (archive->getSize(idx) == kBenchArchiveFileSize) && archive->read(idx, buf.data(), buf.size());
+
+		for(u32 j = 0; match && (j < kBenchArchiveFileSize); j++)
+			match = buf[j] == BenchArchiveByte(i, j);
+
+		if(!match)
+		{
+			fprintf(stderr, "generated archive file %s didn't read back correctly\n", name);
+			break;
+		}
+	}
+
+	return archive;
+}
+
+BENCH_REGISTER(ba2, read_single)
+{
+	static BA2Archive * archive = OpenBenchArchive(1);
+	static std::vector <u8> buf(kBenchArchiveFileSize);
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(archive->read(u32(i % kBenchArchiveFiles), buf.data(), buf.size()));
+
+	state.bytesPerOp = kBenchArchiveFileSize;
+}
+
+BENCH_REGISTER(ba2, read_batch_64)
+{
+	static BA2Archive * archive = OpenBenchArchive(0);
+	static std::vector <u8> buf(u64(kBenchArchiveFiles) * kBenchArchiveFileSize);
+
+	u32 indices[kBenchArchiveFiles];
+	void * dsts[kBenchArchiveFiles];
+	u64 dstLens[kBenchArchiveFiles];
+
+	for(u32 i = 0; i < kBenchArchiveFiles; i++)
+	{
+		indices[i] = i;
+		dsts[i] = buf.data() + (u64(i) * kBenchArchiveFileSize);
+		dstLens[i] = kBenchArchiveFileSize;
+	}
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(archive->readBatch(indices, dsts, dstLens, kBenchArchiveFiles));
+
+	state.bytesPerOp = u64(kBenchArchiveFiles) * kBenchArchiveFileSize;
+}
+
+// CPU topology
+
+// generated sysfs tree for a hybrid part: 4 P cores with SMT siblings (cpu0-7) listed under cpu_core, 6 E cores
+// without (cpu8-13), each kind behind its own L3. the affinity presets are checked against it once before timing
+enum
+{
+	kBenchTopologyPCPUs = 8,
+	kBenchTopologyCPUs = 14,
+};
+
+static void MakeBenchDir(const std::string & path)
+{
+#ifdef _WIN32
+	CreateDirectoryA(path.c_str(), nullptr);
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+static void WriteBenchFile(const std::string & path, const char * text)
+{
+	FILE * f = fopen(path.c_str(), "w");
+	if(f)
+	{
+		fprintf(f, "%s\n", text);
+		fclose(f);
+	}
+	else
+		fprintf(stderr, "couldn't create %s\n", path.c_str());
+}
+
+// returns the cpu directory, loadSysfs finds cpu_core two levels up from it as it would under /sys/devices
+static const std::string & GetBenchSysfsRoot()
+{
+	static std::string root;
+
+	if(root.empty())
+	{
+		std::string devices = Bench_GetTempDir() + "/sfse_bench_sysfs";
+		root = devices + "/system/cpu";
+
+		MakeBenchDir(devices);
+		MakeBenchDir(devices + "/system");
+		MakeBenchDir(root);
+		MakeBenchDir(devices + "/cpu_core");
+
+		WriteBenchFile(root + "/online", "0-13");
+		WriteBenchFile(devices + "/cpu_core/cpus", "0-7");
+
+		for(u32 i = 0; i < kBenchTopologyCPUs; i++)
+		{
+			bool pCore = i < kBenchTopologyPCPUs;
+
+			std::string cpu = root + "/cpu" + std::to_string(i);
+			std::string cache = cpu + "/cache";
+
+			MakeBenchDir(cpu);
+			MakeBenchDir(cpu + "/topology");
+			MakeBenchDir(cache);
+			MakeBenchDir(cache + "/index2");
+			MakeBenchDir(cache + "/index3");
+
+			WriteBenchFile(cpu + "/topology/physical_package_id", "0");
+			WriteBenchFile(cpu + "/topology/core_id", std::to_string(pCore ? (i / 2) : i).c_str());
+
+			// the L2 comes first so the scan has to skip it
+			WriteBenchFile(cache + "/index2/level", "2");
+			WriteBenchFile(cache + "/index2/shared_cpu_list", std::to_string(i).c_str());
+			WriteBenchFile(cache + "/index3/level", "3");
+			WriteBenchFile(cache + "/index3/shared_cpu_list", pCore ? "0-7" : "8-13");
+		}
+	}
+
+	return root;
+}
+
+static void CheckBenchTopology()
+{
+	CPUTopology topology;
+
+	if(!topology.loadSysfs(GetBenchSysfsRoot().c_str()))
+	{
+		fprintf(stderr, "couldn't load the generated sysfs tree\n");
+		return;
+	}
+
+	if((topology.numLogical() != kBenchTopologyCPUs) || (topology.numCores() != 10) || (topology.numL3() != 2))
+	{
+		fprintf(stderr, "generated sysfs tree loaded as %u CPUs, %u cores, %u L3s\n",
+			topology.numLogical(), topology.numCores(), topology.numL3());
+	}
+
+	static const struct
+	{
+		const char	* preset;
+		u64			mask;
+	} kChecks[] =
+	{
+		{ "pcores",		0x00FF },
+		{ "ecores",		0x3F00 },
+		{ "l3",			0x00FF },	// the larger domain
+		{ "l3:1",		0x3F00 },
+		{ "l3:2",		0 },
+		{ "reserve:2",	0x0FFF },	// highest numbered E cores first
+		{ "reserve:8",	0x000F },	// all E cores, then the highest numbered P cores
+		{ "reserve:99",	0x0003 },	// always leaves one core
+		{ "nosmt",		0x3F55 },
+	};
+
+	for(auto & check : kChecks)
+	{
+		u32 policy = 0;
+		u32 param = 0;
+
+		if(!CPUTopology::parsePolicy(check.preset, &policy, &param))
+		{
+			fprintf(stderr, "affinity preset %s didn't parse\n", check.preset);
+			continue;
+		}
+
+		u64 mask = topology.policyMask(policy, param);
+		if(mask != check.mask)
+			fprintf(stderr, "affinity preset %s gave %016llX, expected %016llX\n", check.preset, mask, check.mask);
+	}
+}
+
+BENCH_REGISTER(cpu_topology, load_sysfs)
+{
+	static bool checked = false;
+	if(!checked)
+	{
+		CheckBenchTopology();
+		checked = true;
+	}
+
+	const std::string & root = GetBenchSysfsRoot();
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		CPUTopology topology;
+
+		topology.loadSysfs(root.c_str());
+		Bench_Keep(topology.numLogical());
+	}
+}
+
+// loader entry stub
+
+// what BuildEntryStub must produce for kBenchStubParams, checked against a disassembly:
+//
+// 00 push rcx / push rdx / push r8 / push r9 / sub rsp, 28h
+// 0A lea rcx, [path]				-> 60
+// 11 call [LoadLibraryA]			-> 48
+// 17 test rax, rax / jz 31
+// 1C mov rcx, rax / mov edx, 1
+// 24 call [GetProcAddress]			-> 50
+// 2A test rax, rax / jz 31 / call rax
+// 31 add rsp, 28h / pop r9 / pop r8 / pop rdx / pop rcx
+// 3B jmp [originalEntry]			-> 58
+// 41 nop to 8 byte alignment, then the three addresses and the path
+static const EntryStubParams kBenchStubParams =
+{
+	0x1111111111111111ULL,
+	0x2222222222222222ULL,
+	0x3333333333333333ULL,
+	"sfse.dll"
+};
+
+static const u8 kBenchStubExpected[] =
+{
+	0x51, 0x52, 0x41, 0x50, 0x41, 0x51, 0x48, 0x83, 0xEC, 0x28, 0x48, 0x8D,
+	0x0D, 0x4F, 0x00, 0x00, 0x00, 0xFF, 0x15, 0x31, 0x00, 0x00, 0x00, 0x48,
+	0x85, 0xC0, 0x74, 0x15, 0x48, 0x89, 0xC1, 0xBA, 0x01, 0x00, 0x00, 0x00,
+	0xFF, 0x15, 0x26, 0x00, 0x00, 0x00, 0x48, 0x85, 0xC0, 0x74, 0x02, 0xFF,
+	0xD0, 0x48, 0x83, 0xC4, 0x28, 0x41, 0x59, 0x41, 0x58, 0x5A, 0x59, 0xFF,
+	0x25, 0x17, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00,
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x22, 0x22, 0x22, 0x22,
+	0x22, 0x22, 0x22, 0x22, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+	0x73, 0x66, 0x73, 0x65, 0x2E, 0x64, 0x6C, 0x6C, 0x00,
+};
+
+// DOS header, PE signature, file header and the start of a PE32+ optional header
+static std::vector <u8> MakeBenchPEHeaders(u32 ntOffset, u16 magic, u32 entryRVA)
+{
+	std::vector <u8> headers(ntOffset + 4 + 20 + 20, 0);
+
+	headers[0] = 'M';
+	headers[1] = 'Z';
+	memcpy(&headers[0x3C], &ntOffset, 4);
+	memcpy(&headers[ntOffset], "PE\0\0", 4);
+	memcpy(&headers[ntOffset + 24], &magic, 2);
+	memcpy(&headers[ntOffset + 24 + 16], &entryRVA, 4);
+
+	return headers;
+}
+
+static void CheckBenchEntryStub()
+{
+	std::vector <u8> stub;
+
+	if(!BuildEntryStub(kBenchStubParams, &stub) ||
+		(stub.size() != sizeof(kBenchStubExpected)) ||
+		memcmp(stub.data(), kBenchStubExpected, stub.size()))
+	{
+		fprintf(stderr, "entry stub bytes don't match the expected code\n");
+	}
+
+	std::string longPath(4096, 'a');
+	EntryStubParams longParams = kBenchStubParams;
+	longParams.dllPath = longPath.c_str();
+
+	if(BuildEntryStub(longParams, &stub))
+		fprintf(stderr, "entry stub accepted a path longer than its limit\n");
+
+	struct HeaderCase
+	{
+		const char			* name;
+		std::vector <u8>	headers;
+		bool				valid;
+	};
+
+	std::vector <u8> truncated = MakeBenchPEHeaders(0x80, 0x20B, 0x1234);
+	truncated.resize(0x80 + 24 + 10);
+
+	std::vector <u8> wrapped = MakeBenchPEHeaders(0x80, 0x20B, 0x1234);
+	u32 wrapOffset = 0xFFFFFFF0;
+	memcpy(&wrapped[0x3C], &wrapOffset, 4);
+
+	std::vector <u8> notMZ = MakeBenchPEHeaders(0x80, 0x20B, 0x1234);
+	notMZ[0] = 'X';
+
+	HeaderCase cases[] =
+	{
+		{ "PE32+",					MakeBenchPEHeaders(0x80, 0x20B, 0x1234),	true },
+		{ "PE32",					MakeBenchPEHeaders(0x80, 0x10B, 0x1234),	false },
+		{ "no entry point",			MakeBenchPEHeaders(0x80, 0x20B, 0),			false },
+		{ "truncated",				truncated,									false },
+		{ "e_lfanew past the end",	wrapped,									false },
+		{ "no MZ",					notMZ,										false },
+	};
+
+	for(auto & check : cases)
+	{
+		u32 rva = 0;
+		bool result = GetEntryPointRVA(check.headers.data(), check.headers.size(), &rva);
+
+		if((result != check.valid) || (result && (rva != 0x1234)))
+			fprintf(stderr, "GetEntryPointRVA got %s wrong\n", check.name);
+	}
+}
+
+BENCH_REGISTER(loader, entry_stub_build)
+{
+	static bool checked = false;
+	if(!checked)
+	{
+		CheckBenchEntryStub();
+		checked = true;
+	}
+
+	std::vector <u8> stub;
+
+	for(u64 i = 0; i < state.iterations; i++)
+	{
+		BuildEntryStub(kBenchStubParams, &stub);
+		Bench_Keep(stub.size());
+	}
+}
+
+// message dispatch
+
+// the generated stub from sfse/DispatchStub.h against the loop dispatchMessage falls back to, for the same
+// listeners. both sides call handlers through the win64 convention like plugins do. before timing, the stub is
+// run once with handlers that scribble on the message, and its prolog is checked against the unwind info
+#if defined(__x86_64__) || defined(_M_X64)
+
+#ifdef _WIN32
+#define BENCH_MSABI
+#else
+#define BENCH_MSABI __attribute__((ms_abi))
+#endif
+
+// SFSEMessagingInterface::Message, PluginAPI.h doesn't build here
+struct BenchMessage
+{
+	const char	* sender;
+	u32			type;
+	u32			dataLen;
+	void		* data;
+};
+
+typedef void (BENCH_MSABI * BenchMessageHandler)(BenchMessage * msg);
+typedef bool (BENCH_MSABI * BenchDispatchStubFn)(u32 type, void * data, u32 dataLen);
+
+enum
+{
+	kBenchDispatchMaxHandlers = 16,
+};
+
+static const char	kBenchDispatchSender[] = "BenchPlugin";
+static u64			s_benchDispatchTotal = 0;
+
+static void BENCH_MSABI BenchDispatch_Handler(BenchMessage * msg)
+{
+	s_benchDispatchTotal += msg->dataLen;
+}
+
+// what each checking handler saw, in call order
+struct BenchDispatchCall
+{
+	u32			handler;
+	BenchMessage	msg;
+};
+
+static std::vector <BenchDispatchCall>	s_benchDispatchCalls;
+
+template <u32 kIdx>
+static void BENCH_MSABI BenchDispatch_CheckHandler(BenchMessage * msg)
+{
+	BenchDispatchCall call = { kIdx, *msg };
+	s_benchDispatchCalls.push_back(call);
+
+	// the stub has to refill the message before the next handler
+	msg->sender = nullptr;
+	msg->type = 0xFFFFFFFF;
+	msg->dataLen = 0xFFFFFFFF;
+	msg->data = nullptr;
+}
+
+static const BenchMessageHandler kBenchDispatchCheckHandlers[kBenchDispatchMaxHandlers] =
+{
+	BenchDispatch_CheckHandler <0>,		BenchDispatch_CheckHandler <1>,
+	BenchDispatch_CheckHandler <2>,		BenchDispatch_CheckHandler <3>,
+	BenchDispatch_CheckHandler <4>,		BenchDispatch_CheckHandler <5>,
+	BenchDispatch_CheckHandler <6>,		BenchDispatch_CheckHandler <7>,
+	BenchDispatch_CheckHandler <8>,		BenchDispatch_CheckHandler <9>,
+	BenchDispatch_CheckHandler <10>,	BenchDispatch_CheckHandler <11>,
+	BenchDispatch_CheckHandler <12>,	BenchDispatch_CheckHandler <13>,
+	BenchDispatch_CheckHandler <14>,	BenchDispatch_CheckHandler <15>,
+};
+
+// builds a stub in executable memory. never freed, there's one per handler list
+static BenchDispatchStubFn MakeBenchDispatchStub(const BenchMessageHandler * handlers, u32 numHandlers, std::vector <u8> * code = nullptr)
+{
+	std::vector <uintptr_t> addresses;
+	for(u32 i = 0; i < numHandlers; i++)
+		addresses.push_back(uintptr_t(handlers[i]));
+
+	std::vector <u8> buf(GetDispatchStubSize(numHandlers));
+
+	size_t len = BuildDispatchStub(kBenchDispatchSender, addresses.data(), numHandlers, buf.data(), buf.size());
+	if(!len)
+		return nullptr;
+
+	buf.resize(len);
+
+	u8 * mem = (u8 *)Platform_AllocPages(len);
+	if(!mem)
+		return nullptr;
+
+	memcpy(mem, buf.data(), len);
+
+#ifdef _WIN32
+	DWORD oldProtect;
+	VirtualProtect(mem, len, PAGE_EXECUTE_READ, &oldProtect);
+	FlushInstructionCache(GetCurrentProcess(), mem, len);
+#else
+	mprotect(mem, len, PROT_READ | PROT_EXEC);
+#endif
+
+	if(code)
+		*code = buf;
+
+	return BenchDispatchStubFn(mem);
+}
+
+static void CheckBenchDispatchStub()
+{
+	// push rbx / push rsi / push rdi / sub rsp, 40h
+	static const u8 kProlog[] = { 0x53, 0x56, 0x57, 0x48, 0x83, 0xEC, 0x40 };
+	static const u8 kUnwindInfo[] = { 0x01, 0x07, 0x04, 0x00, 0x07, 0x72, 0x03, 0x70, 0x02, 0x60, 0x01, 0x30 };
+
+	for(u32 numHandlers = 0; numHandlers <= kBenchDispatchMaxHandlers; numHandlers++)
+	{
+		std::vector <u8> code;
+
+		BenchDispatchStubFn stub = MakeBenchDispatchStub(kBenchDispatchCheckHandlers, numHandlers, &code);
+		if(!stub)
+		{
+			fprintf(stderr, "couldn't build a dispatch stub for %u handlers\n", numHandlers);
+			continue;
+		}
+
+		if((code.size() < sizeof(kProlog)) || memcmp(code.data(), kProlog, sizeof(kProlog)))
+			fprintf(stderr, "dispatch stub for %u handlers has the wrong prolog\n", numHandlers);
+
+		u32 data = 0;
+
+		s_benchDispatchCalls.clear();
+
+		bool result = stub(0x12345678, &data, 0x9ABCDEF0);
+
+		if(result != (numHandlers != 0))
+			fprintf(stderr, "dispatch stub for %u handlers returned %d\n", numHandlers, result);
+
+		if(s_benchDispatchCalls.size() != numHandlers)
+			fprintf(stderr, "dispatch stub for %u handlers made %u calls\n", numHandlers, u32(s_benchDispatchCalls.size()));
+
+		for(u32 i = 0; i < s_benchDispatchCalls.size(); i++)
+		{
+			const BenchDispatchCall & call = s_benchDispatchCalls[i];
+
+			if((call.handler != i) ||
+				(call.msg.sender != kBenchDispatchSender) ||
+				(call.msg.type != 0x12345678) ||
+				(call.msg.dataLen != 0x9ABCDEF0) ||
+				(call.msg.data != &data))
+			{
+				fprintf(stderr, "dispatch stub for %u handlers got call %u wrong\n", numHandlers, i);
+			}
+		}
+	}
+
+	u8 info[kDispatchStubUnwindInfoSize];
+	BuildDispatchStubUnwindInfo(info);
+
+	if(memcmp(info, kUnwindInfo, sizeof(info)))
+		fprintf(stderr, "dispatch stub unwind info doesn't match the expected bytes\n");
+
+	// each unwind code has to name the instruction that ends at its offset, in reverse prolog order
+	enum
+	{
+		UWOP_PUSH_NONVOL = 0,
+		UWOP_ALLOC_SMALL = 2,
+	};
+
+	if(info[1] != sizeof(kProlog))
+		fprintf(stderr, "dispatch stub unwind info has a %u byte prolog\n", info[1]);
+
+	u32 lastOffset = sizeof(kProlog) + 1;
+
+	for(u32 i = 0; i < info[2]; i++)
+	{
+		u32 offset = info[4 + i * 2];
+		u32 op = info[5 + i * 2] & 0xF;
+		u32 opInfo = info[5 + i * 2] >> 4;
+
+		bool matches = (offset < lastOffset) && (offset <= sizeof(kProlog));
+
+		if(matches && (op == UWOP_PUSH_NONVOL))
+			matches = (offset >= 1) && (opInfo < 8) && (kProlog[offset - 1] == 0x50 + opInfo);
+		else if(matches && (op == UWOP_ALLOC_SMALL))	// sub rsp, imm8
+		{
+			matches = (offset >= 4) &&
+				(kProlog[offset - 4] == 0x48) && (kProlog[offset - 3] == 0x83) && (kProlog[offset - 2] == 0xEC) &&
+				(kProlog[offset - 1] == opInfo * 8 + 8);
+		}
+		else
+			matches = false;
+
+		if(!matches)
+			fprintf(stderr, "dispatch stub unwind code %u doesn't match the prolog\n", i);
+
+		lastOffset = offset;
+	}
+}
+
+static BenchDispatchStubFn GetBenchDispatchStub(u32 numHandlers)
+{
+	static BenchDispatchStubFn stubs[kBenchDispatchMaxHandlers + 1] = { nullptr };
+	static bool checked = false;
+
+	if(!checked)
+	{
+		CheckBenchDispatchStub();
+		checked = true;
+	}
+
+	if(!stubs[numHandlers])
+	{
+		BenchMessageHandler handlers[kBenchDispatchMaxHandlers];
+		for(u32 i = 0; i < numHandlers; i++)
+			handlers[i] = BenchDispatch_Handler;
+
+		stubs[numHandlers] = MakeBenchDispatchStub(handlers, numHandlers);
+		if(!stubs[numHandlers])
+			fprintf(stderr, "couldn't build a dispatch stub for %u handlers\n", numHandlers);
+	}
+
+	return stubs[numHandlers];
+}
+
+static void RunBenchDispatchStub(BenchState & state, u32 numHandlers)
+{
+	BenchDispatchStubFn stub = GetBenchDispatchStub(numHandlers);
+	if(!stub)
+		return;
+
+	u32 data = 0;
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(stub(1, &data, sizeof(data)));
+
+	Bench_Keep(s_benchDispatchTotal);
+}
+
+// dispatchMessage's loop over s_pluginListeners, without the logging
+struct BenchListener
+{
+	u32					listener;
+	BenchMessageHandler	handleMessage;
+};
+
+static bool BenchDispatchGeneric(const std::vector <BenchListener> & listeners, u32 type, void * data, u32 dataLen)
+{
+	u32 numRespondents = 0;
+
+	for(auto & iter : listeners)
+	{
+		BenchMessage msg;
+		msg.data = data;
+		msg.type = type;
+		msg.sender = kBenchDispatchSender;
+		msg.dataLen = dataLen;
+
+		iter.handleMessage(&msg);
+		numRespondents++;
+	}
+
+	return numRespondents ? true : false;
+}
+
+static void RunBenchDispatchGeneric(BenchState & state, u32 numHandlers)
+{
+	std::vector <BenchListener> listeners;
+	for(u32 i = 0; i < numHandlers; i++)
+	{
+		BenchListener listener = { i + 1, BenchDispatch_Handler };
+		listeners.push_back(listener);
+	}
+
+	u32 data = 0;
+
+	for(u64 i = 0; i < state.iterations; i++)
+		Bench_Keep(BenchDispatchGeneric(listeners, 1, &data, sizeof(data)));
+
+	Bench_Keep(s_benchDispatchTotal);
+}
+
+BENCH_REGISTER(dispatch, stub_1)
+{
+	RunBenchDispatchStub(state, 1);
+}
+
+BENCH_REGISTER(dispatch, stub_4)
+{
+	RunBenchDispatchStub(state, 4);
+}
+
+BENCH_REGISTER(dispatch, stub_16)
+{
+	RunBenchDispatchStub(state, 16);
+}
+
+BENCH_REGISTER(dispatch, generic_1)
+{
+	RunBenchDispatchGeneric(state, 1);
+}
+
+BENCH_REGISTER(dispatch, generic_4)
+{
+	RunBenchDispatchGeneric(state, 4);
+}
+
+BENCH_REGISTER(dispatch, generic_16)
+{
+	RunBenchDispatchGeneric(state, 16);
+}
+
+#endif
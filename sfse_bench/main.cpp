@@ -0,0 +1,106 @@
+#include "Bench.h"
+#include "sfse_common/Platform.h"
+#include <cstdio>
+#include <cstdlib>
+
+static void PrintUsage()
+{
+	printf("usage: sfse_bench [options]\n");
+	printf("\n");
+	printf("options:\n");
+	printf("  -h, -help - print this options list\n");
+	printf("  -list - print the available benchmarks and exit\n");
+	printf("  -filter <text> - only run benchmarks whose group/name contains <text>\n");
+	printf("  -mintime <ms> - minimum length of each timed run (default 200)\n");
+	printf("  -reps <n> - timed runs per benchmark (default 5)\n");
+	printf("  -json <path> - also write the results as JSON, - for stdout\n");
+	printf("  -tempdir <path> - where scratch files are created (default .)\n");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchOptions options;
+	const char * jsonPath = nullptr;
+	bool list = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char * arg = argv[i];
+		const char * param = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if(arg[0] != '-')
+		{
+			printf("unknown argument %s\n", arg);
+			PrintUsage();
+			return 1;
+		}
+
+		arg++;
+
+		if(!_stricmp(arg, "h") || !_stricmp(arg, "help"))
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if(!_stricmp(arg, "list"))
+		{
+			list = true;
+		}
+		else if(param && !_stricmp(arg, "filter"))
+		{
+			options.filter = param;
+			i++;
+		}
+		else if(param && !_stricmp(arg, "mintime"))
+		{
+			options.minTimeMS = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "reps"))
+		{
+			options.repetitions = strtoul(param, nullptr, 10);
+			if(!options.repetitions)
+				options.repetitions = 1;
+			i++;
+		}
+		else if(param && !_stricmp(arg, "json"))
+		{
+			jsonPath = param;
+			i++;
+		}
+		else if(param && !_stricmp(arg, "tempdir"))
+		{
+			Bench_SetTempDir(param);
+			i++;
+		}
+		else
+		{
+			printf("unknown switch or missing parameter -%s\n", arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if(list)
+	{
+		Bench_List();
+		return 0;
+	}
+
+	std::vector <BenchResult> results;
+
+	Bench_Run(options, &results);
+
+	// keep stdout clean JSON when that's where it's going
+	bool jsonToStdout = jsonPath && (jsonPath[0] == '-') && !jsonPath[1];
+	if(!jsonToStdout)
+		Bench_PrintTable(results);
+
+	if(jsonPath && !Bench_WriteJSON(jsonPath, options, results))
+	{
+		printf("couldn't write %s\n", jsonPath);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include "AllocTracker.h"
+#include "sfse_common/Platform.h"
+
+static inline u32 HashPointer(uintptr_t ptr)
+{
+	// heap blocks are at least 8 byte aligned, the low bits carry nothing
+	return u32((u64(ptr >> 3) * 0x9E3779B97F4A7C15ull) >> (64 - AllocTracker::kTableBits));
+}
+
+AllocTracker::AllocTracker()
+	:m_table(nullptr), m_unsized(0)
+{
+	for(auto & owner : m_owners)
+	{
+		owner.allocs = 0;
+		owner.frees = 0;
+		owner.liveBytes = 0;
+		owner.peakBytes = 0;
+	}
+}
+
+AllocTracker::~AllocTracker()
+{
+	// the table stays mapped, other threads may still be recording during shutdown
+}
+
+AllocTracker::Slot * AllocTracker::getTable()
+{
+	Slot * table = m_table.load(std::memory_order_acquire);
+	if(table)
+		return table;
+
+	// zero-filled pages are a valid empty table, they're only backed once touched
+	auto * newTable = (Slot *)Platform_AllocPages(sizeof(Slot) << kTableBits);
+	if(!newTable)
+		return nullptr;
+
+	if(!m_table.compare_exchange_strong(table, newTable, std::memory_order_acq_rel))
+	{
+		Platform_FreePages(newTable, sizeof(Slot) << kTableBits);
+		return table;
+	}
+
+	return newTable;
+}
+
+void AllocTracker::addLive(u32 owner, s64 size)
+{
+	OwnerStats & stats = m_owners[owner];
+
+	s64 live = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	if(size <= 0 || live <= 0)
+		return;
+
+	u64 peak = stats.peakBytes.load(std::memory_order_relaxed);
+
+	while((u64(live) > peak) && !stats.peakBytes.compare_exchange_weak(peak, u64(live), std::memory_order_relaxed)) { }
+}
+
+void AllocTracker::recordAlloc(u32 owner, const void * ptr, u64 size)
+{
+	if(!ptr)
+		return;
+
+	if(owner >= kMaxOwners) owner = kMaxOwners - 1;
+
+	m_owners[owner].allocs.fetch_add(1, std::memory_order_relaxed);
+
+	Slot * table = getTable();
+	if(!table)
+	{
+		m_unsized.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	uintptr_t key = uintptr_t(ptr);
+	u32 mask = (1 << kTableBits) - 1;
+	u32 idx = HashPointer(key);
+
+	for(u32 i = 0; i < kMaxProbe; i++, idx = (idx + 1) & mask)
+	{
+		Slot & slot = table[idx];
+		uintptr_t current = slot.ptr.load(std::memory_order_relaxed);
+
+		if(current == key)
+		{
+			// the previous block at this address was freed behind our back, retire it against its owner
+			u64 info = slot.info.exchange((size << 8) | owner, std::memory_order_relaxed);
+			addLive(u32(info & 0xFF), -s64(info >> 8));
+			addLive(owner, s64(size));
+
+			return;
+		}
+
+		if(((current == 0) || (current == kTombstone)) &&
+			slot.ptr.compare_exchange_strong(current, key, std::memory_order_relaxed))
+		{
+			// nobody can free this block until we've returned it, so info doesn't need to be published first
+			slot.info.store((size << 8) | owner, std::memory_order_relaxed);
+			addLive(owner, s64(size));
+
+			return;
+		}
+	}
+
+	m_unsized.fetch_add(1, std::memory_order_relaxed);
+}
+
+u64 AllocTracker::recordFree(u32 owner, const void * ptr)
+{
+	if(!ptr)
+		return 0;
+
+	if(owner >= kMaxOwners) owner = kMaxOwners - 1;
+
+	m_owners[owner].frees.fetch_add(1, std::memory_order_relaxed);
+
+	Slot * table = m_table.load(std::memory_order_acquire);
+	if(!table)
+		return 0;
+
+	uintptr_t key = uintptr_t(ptr);
+	u32 mask = (1 << kTableBits) - 1;
+	u32 idx = HashPointer(key);
+
+	for(u32 i = 0; i < kMaxProbe; i++, idx = (idx + 1) & mask)
+	{
+		Slot & slot = table[idx];
+		uintptr_t current = slot.ptr.load(std::memory_order_relaxed);
+
+		if(current == key)
+		{
+			u64 info = slot.info.load(std::memory_order_relaxed);
+
+			if(!slot.ptr.compare_exchange_strong(current, kTombstone, std::memory_order_relaxed))
+				return 0;
+
+			addLive(u32(info & 0xFF), -s64(info >> 8));
+
+			return info >> 8;
+		}
+
+		// nothing was ever inserted past an empty slot
+		if(!current)
+			return 0;
+	}
+
+	return 0;
+}
+
+void AllocTracker::getStats(u32 owner, Stats * out) const
+{
+	if(owner >= kMaxOwners) owner = kMaxOwners - 1;
+
+	const OwnerStats & stats = m_owners[owner];
+
+	s64 live = stats.liveBytes.load(std::memory_order_relaxed);
+
+	out->allocs = stats.allocs.load(std::memory_order_relaxed);
+	out->frees = stats.frees.load(std::memory_order_relaxed);
+	out->liveBytes = (live > 0) ? u64(live) : 0;
+	out->peakBytes = stats.peakBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <atomic>
+
+// per-owner heap accounting for allocations observed from outside the allocator
+//
+// the size of each tracked block is kept in a lock-free open addressing table keyed by pointer, so a free never
+// has to ask the heap how big the block was (_msize takes the heap lock). the bytes are credited back to the owner
+// that allocated the block, whoever frees it. blocks freed without going through recordFree stay in the table,
+// and are retired against their original owner when the same address is recorded again and probes to them.
+//
+// live bytes and the peak are per-owner atomics updated on every call, so the peak is a true high water mark
+// rather than whatever a report happened to sample. nothing on these paths takes a lock.
+//
+// blocks that find no free slot within kMaxProbe of their hash are counted but not sized, as are frees of
+// blocks that were never recorded (allocated before tracking started, or by another module).
+
+class AllocTracker
+{
+public:
+	AllocTracker();
+	~AllocTracker();
+
+	enum
+	{
+		kMaxOwners = 256,		// owners past this are counted in the last slot
+		kTableBits = 20,		// 1M blocks, 16MB of address space committed on first touch
+		kMaxProbe = 32,
+	};
+
+	struct Stats
+	{
+		u64	allocs;
+		u64	frees;
+		u64	liveBytes;
+		u64	peakBytes;
+	};
+
+	void	recordAlloc(u32 owner, const void * ptr, u64 size);
+	u64		recordFree(u32 owner, const void * ptr);	// returns the block's size, 0 if it wasn't tracked
+
+	void	getStats(u32 owner, Stats * out) const;
+	u64		numUnsized() const	{ return m_unsized.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot
+	{
+		std::atomic <uintptr_t>	ptr;	// 0 = empty, kTombstone = removed
+		std::atomic <u64>		info;	// size << 8 | owner
+	};
+
+	struct alignas(64) OwnerStats
+	{
+		std::atomic <u64>	allocs;
+		std::atomic <u64>	frees;
+		std::atomic <s64>	liveBytes;	// can dip below zero briefly while another thread's alloc is in flight
+		std::atomic <u64>	peakBytes;
+	};
+
+	enum
+	{
+		kTombstone = 1,
+	};
+
+	Slot *	getTable();
+	void	addLive(u32 owner, s64 size);
+
+	std::atomic <Slot *>	m_table;
+	OwnerStats				m_owners[kMaxOwners];
+	std::atomic <u64>		m_unsized;
+};
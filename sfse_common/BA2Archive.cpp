@@ -0,0 +1,539 @@
+#include "BA2Archive.h"
+#include "Inflate.h"
+#include <cstring>
+
+// header: 'BTDX', version, type ('GNRL' / 'DX10'), numFiles, nameTableOffset (u64)
+// version 2+ adds a u64, version 3 adds a u32 compression method
+
+enum
+{
+	kGeneralEntrySize = 36,
+	kTextureEntrySize = 24,
+	kTextureChunkSize = 24,
+
+	kMaxCachedChunk = 1024 * 1024,
+	kDefaultCacheSize = 32 * 1024 * 1024,
+};
+
+static inline u32 Read32(const u8 * data)
+{
+	u32 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+static inline u16 Read16(const u8 * data)
+{
+	u16 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+static inline u64 Read64(const u8 * data)
+{
+	u64 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+// offsets and sizes come from the file, so nothing here can be allowed to wrap
+static inline bool InRange(u64 offset, u64 size, u64 len)
+{
+	return (offset <= len) && (size <= len - offset);
+}
+
+static std::string NormalizePath(const char * path, size_t len)
+{
+	std::string result(path, len);
+
+	for(auto & c : result)
+	{
+		if(c == '/')
+			c = '\\';
+		else if(c >= 'A' && c <= 'Z')
+			c = c - 'A' + 'a';
+	}
+
+	return result;
+}
+
+// LZ4 block format, output size must be known
+static bool LZ4Decompress(const u8 * src, size_t srcLen, u8 * dst, size_t dstLen)
+{
+	const u8 * srcEnd = src + srcLen;
+	u8 * out = dst;
+	u8 * outEnd = dst + dstLen;
+
+	while(src < srcEnd)
+	{
+		u8 token = *src++;
+
+		size_t literals = token >> 4;
+		if(literals == 15)
+		{
+			u8 byte;
+			do
+			{
+				if(src >= srcEnd)
+					return false;
+
+				byte = *src++;
+				literals += byte;
+			} while(byte == 255);
+		}
+
+		if((literals > size_t(srcEnd - src)) || (literals > size_t(outEnd - out)))
+			return false;
+
+		memcpy(out, src, literals);
+		out += literals;
+		src += literals;
+
+		// the last sequence is literals only
+		if(src == srcEnd)
+			break;
+
+		if(srcEnd - src < 2)
+			return false;
+
+		size_t offset = Read16(src);
+		src += 2;
+
+		if(!offset || (offset > size_t(out - dst)))
+			return false;
+
+		size_t matchLen = token & 0xF;
+		if(matchLen == 15)
+		{
+			u8 byte;
+			do
+			{
+				if(src >= srcEnd)
+					return false;
+
+				byte = *src++;
+				matchLen += byte;
+			} while(byte == 255);
+		}
+
+		matchLen += 4;
+
+		if(matchLen > size_t(outEnd - out))
+			return false;
+
+		// may overlap
+		const u8 * match = out - offset;
+		for(size_t i = 0; i < matchLen; i++)
+			out[i] = match[i];
+
+		out += matchLen;
+	}
+
+	return out == outEnd;
+}
+
+size_t BA2Archive::NameHash::operator()(const std::string & name) const
+{
+	// FNV-1a, names are already normalized
+	size_t hash = 14695981039346656037ULL;
+
+	for(char c : name)
+	{
+		hash ^= u8(c);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+BA2Archive::BA2Archive()
+:m_type(kType_General), m_compression(kCompression_Zlib), m_cacheBytes(0), m_cacheLimit(kDefaultCacheSize)
+{
+	//
+}
+
+BA2Archive::~BA2Archive()
+{
+	close();
+}
+
+bool BA2Archive::open(const char * path, u32 numThreads, u64 affinity)
+{
+	close();
+
+	if(!m_file.open(path))
+		return false;
+
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	if((len < 24) || memcmp(data, "BTDX", 4))
+	{
+		close();
+		return false;
+	}
+
+	u32 version = Read32(data + 4);
+	u32 numFiles = Read32(data + 12);
+	u64 nameTable = Read64(data + 16);
+	u64 pos = 24;
+
+	if(version >= 2)
+		pos += 8;
+
+	if(version >= 3)
+	{
+		if(len < 36)
+		{
+			close();
+			return false;
+		}
+
+		m_compression = Read32(data + 32);
+		pos += 4;
+	}
+
+	bool result = false;
+
+	if((m_compression == kCompression_Zlib) || (m_compression == kCompression_LZ4))
+	{
+		if(!memcmp(data + 8, "GNRL", 4))
+		{
+			m_type = kType_General;
+			result = readGeneral(pos, numFiles);
+		}
+		else if(!memcmp(data + 8, "DX10", 4))
+		{
+			m_type = kType_Texture;
+			result = readTextures(pos, numFiles);
+		}
+	}
+
+	if(result)
+		result = readNames(nameTable);
+
+	if(!result)
+	{
+		close();
+		return false;
+	}
+
+	m_pool.start(numThreads, affinity);
+
+	return true;
+}
+
+void BA2Archive::close()
+{
+	m_pool.stop();
+
+	m_file.close();
+	m_files.clear();
+	m_chunks.clear();
+	m_names.clear();
+	m_lookup.clear();
+
+	m_compression = kCompression_Zlib;
+
+	std::lock_guard <std::mutex> lock(m_cacheLock);
+
+	m_cache.clear();
+	m_cacheLookup.clear();
+	m_cacheBytes = 0;
+}
+
+s32 BA2Archive::find(const char * path) const
+{
+	auto iter = m_lookup.find(NormalizePath(path, strlen(path)));
+
+	return (iter != m_lookup.end()) ? s32(iter->second) : -1;
+}
+
+const char * BA2Archive::getName(u32 idx) const
+{
+	return (idx < m_files.size()) ? &m_names[m_files[idx].nameOffset] : nullptr;
+}
+
+u64 BA2Archive::getSize(u32 idx) const
+{
+	return (idx < m_files.size()) ? m_files[idx].size : 0;
+}
+
+bool BA2Archive::getTextureInfo(u32 idx, TextureInfo * out) const
+{
+	if((m_type != kType_Texture) || (idx >= m_files.size()))
+		return false;
+
+	*out = m_files[idx].texInfo;
+
+	return true;
+}
+
+bool BA2Archive::read(u32 idx, void * dst, u64 dstLen)
+{
+	return readBatch(&idx, &dst, &dstLen, 1) == 1;
+}
+
+u32 BA2Archive::readBatch(const u32 * indices, void * const * dsts, const u64 * dstLens, u32 count)
+{
+	std::vector <Task> tasks;
+	std::vector <u32> firstTask(count + 1);
+	std::vector <u8> failed(count, 0);
+
+	for(u32 i = 0; i < count; i++)
+	{
+		firstTask[i] = u32(tasks.size());
+
+		if(addTasks(indices[i], dsts[i], dstLens[i], &tasks) == u32(-1))
+			failed[i] = 1;
+	}
+
+	firstTask[count] = u32(tasks.size());
+
+	// one result slot per task so the workers never share a write
+	std::vector <u8> taskOK(tasks.size(), 0);
+
+	m_pool.run(u32(tasks.size()), [&](u32 taskIdx)
+	{
+		taskOK[taskIdx] = decompressChunk(tasks[taskIdx].chunk, tasks[taskIdx].dst) ? 1 : 0;
+	});
+
+	u32 result = 0;
+	for(u32 i = 0; i < count; i++)
+	{
+		for(u32 j = firstTask[i]; j < firstTask[i + 1]; j++)
+			if(!taskOK[j])
+				failed[i] = 1;
+
+		if(!failed[i])
+			result++;
+	}
+
+	return result;
+}
+
+void BA2Archive::setCacheSize(u64 bytes)
+{
+	std::lock_guard <std::mutex> lock(m_cacheLock);
+
+	m_cacheLimit = bytes;
+
+	while(m_cacheBytes > m_cacheLimit)
+	{
+		auto & oldest = m_cache.back();
+
+		m_cacheBytes -= oldest.second.size();
+		m_cacheLookup.erase(oldest.first);
+		m_cache.pop_back();
+	}
+}
+
+bool BA2Archive::readGeneral(u64 pos, u32 numFiles)
+{
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	if(!InRange(pos, u64(numFiles) * kGeneralEntrySize, len))
+		return false;
+
+	m_files.resize(numFiles);
+	m_chunks.resize(numFiles);
+
+	for(u32 i = 0; i < numFiles; i++, pos += kGeneralEntrySize)
+	{
+		const u8 * entry = data + pos;
+
+		Chunk & chunk = m_chunks[i];
+		chunk.offset = Read64(entry + 16);
+		chunk.packedSize = Read32(entry + 24);
+		chunk.unpackedSize = Read32(entry + 28);
+
+		if(!InRange(chunk.offset, chunk.packedSize ? chunk.packedSize : chunk.unpackedSize, len))
+			return false;
+
+		File & file = m_files[i];
+		file.firstChunk = i;
+		file.numChunks = 1;
+		file.size = chunk.unpackedSize;
+		file.nameOffset = 0;
+		file.texInfo = TextureInfo();
+	}
+
+	return true;
+}
+
+bool BA2Archive::readTextures(u64 pos, u32 numFiles)
+{
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	// lower bound, entries are followed by their chunks
+	if(!InRange(pos, u64(numFiles) * kTextureEntrySize, len))
+		return false;
+
+	m_files.resize(numFiles);
+
+	for(u32 i = 0; i < numFiles; i++)
+	{
+		if(!InRange(pos, kTextureEntrySize, len))
+			return false;
+
+		const u8 * entry = data + pos;
+		u32 numChunks = entry[13];
+
+		File & file = m_files[i];
+		file.firstChunk = u32(m_chunks.size());
+		file.numChunks = numChunks;
+		file.size = 0;
+		file.nameOffset = 0;
+		file.texInfo.height = Read16(entry + 16);
+		file.texInfo.width = Read16(entry + 18);
+		file.texInfo.numMips = entry[20];
+		file.texInfo.format = entry[21];
+		file.texInfo.flags = entry[22];
+		file.texInfo.tileMode = entry[23];
+
+		pos += kTextureEntrySize;
+
+		if(!InRange(pos, u64(numChunks) * kTextureChunkSize, len))
+			return false;
+
+		for(u32 j = 0; j < numChunks; j++, pos += kTextureChunkSize)
+		{
+			const u8 * chunkData = data + pos;
+
+			Chunk chunk;
+			chunk.offset = Read64(chunkData);
+			chunk.packedSize = Read32(chunkData + 8);
+			chunk.unpackedSize = Read32(chunkData + 12);
+
+			if(!InRange(chunk.offset, chunk.packedSize ? chunk.packedSize : chunk.unpackedSize, len))
+				return false;
+
+			file.size += chunk.unpackedSize;
+			m_chunks.push_back(chunk);
+		}
+	}
+
+	return true;
+}
+
+bool BA2Archive::readNames(u64 pos)
+{
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	m_lookup.reserve(m_files.size());
+
+	for(u32 i = 0; i < m_files.size(); i++)
+	{
+		if(!InRange(pos, 2, len))
+			return false;
+
+		u16 nameLen = Read16(data + pos);
+		pos += 2;
+
+		if(!InRange(pos, nameLen, len))
+			return false;
+
+		std::string name = NormalizePath((const char *)data + pos, nameLen);
+		pos += nameLen;
+
+		m_files[i].nameOffset = u32(m_names.size());
+		m_names.insert(m_names.end(), name.begin(), name.end());
+		m_names.push_back(0);
+
+		m_lookup.emplace(std::move(name), i);
+	}
+
+	return true;
+}
+
+u32 BA2Archive::addTasks(u32 idx, void * dst, u64 dstLen, std::vector <Task> * tasks) const
+{
+	if((idx >= m_files.size()) || (dstLen < m_files[idx].size))
+		return u32(-1);
+
+	const File & file = m_files[idx];
+	u8 * out = (u8 *)dst;
+
+	for(u32 i = 0; i < file.numChunks; i++)
+	{
+		Task task = { file.firstChunk + i, out };
+		tasks->push_back(task);
+
+		out += m_chunks[file.firstChunk + i].unpackedSize;
+	}
+
+	return file.numChunks;
+}
+
+bool BA2Archive::decompressChunk(u32 chunkIdx, u8 * dst)
+{
+	const Chunk & chunk = m_chunks[chunkIdx];
+	const u8 * src = m_file.data() + chunk.offset;
+
+	if(!chunk.packedSize)
+	{
+		memcpy(dst, src, chunk.unpackedSize);
+		return true;
+	}
+
+	if(getCached(chunkIdx, dst))
+		return true;
+
+	bool result;
+
+	if(m_compression == kCompression_LZ4)
+	{
+		result = LZ4Decompress(src, chunk.packedSize, dst, chunk.unpackedSize);
+	}
+	else
+	{
+		size_t written;
+		result = Inflate(src, chunk.packedSize, dst, chunk.unpackedSize, &written) && (written == chunk.unpackedSize);
+	}
+
+	if(result)
+		addCached(chunkIdx, dst, chunk.unpackedSize);
+
+	return result;
+}
+
+bool BA2Archive::getCached(u32 chunk, u8 * dst)
+{
+	std::lock_guard <std::mutex> lock(m_cacheLock);
+
+	auto iter = m_cacheLookup.find(chunk);
+	if(iter == m_cacheLookup.end())
+		return false;
+
+	m_cache.splice(m_cache.begin(), m_cache, iter->second);
+	memcpy(dst, iter->second->second.data(), iter->second->second.size());
+
+	return true;
+}
+
+void BA2Archive::addCached(u32 chunk, const u8 * src, u32 len)
+{
+	if(len > kMaxCachedChunk)
+		return;
+
+	std::lock_guard <std::mutex> lock(m_cacheLock);
+
+	if((len > m_cacheLimit) || m_cacheLookup.count(chunk))
+		return;
+
+	while(m_cacheBytes + len > m_cacheLimit)
+	{
+		auto & oldest = m_cache.back();
+
+		m_cacheBytes -= oldest.second.size();
+		m_cacheLookup.erase(oldest.first);
+		m_cache.pop_back();
+	}
+
+	m_cache.emplace_front(chunk, std::vector <u8>(src, src + len));
+	m_cacheLookup[chunk] = m_cache.begin();
+	m_cacheBytes += len;
+}
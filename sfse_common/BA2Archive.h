@@ -0,0 +1,125 @@
+#pragma once
+
+#include "sfse_common/MappedStream.h"
+#include "sfse_common/WorkerPool.h"
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// reader for Bethesda BA2 archives (general and DX10, versions 1-3)
+//
+// the archive is memory-mapped and the name table is hashed once on open, so finding a file is a single
+// lookup. files are decompressed straight into caller buffers, chunk by chunk (DX10 files store one chunk per
+// mip range), with the chunks spread across a worker pool. recently decompressed chunks are kept in a small LRU
+// cache for assets that get read repeatedly.
+//
+// DX10 entries are returned as raw mip data, without a DDS header. getTextureInfo has what's needed to build
+// one.
+
+class BA2Archive
+{
+public:
+	BA2Archive();
+	~BA2Archive();
+
+	enum
+	{
+		kType_General = 0,
+		kType_Texture,
+	};
+
+	struct TextureInfo
+	{
+		u16	height;
+		u16	width;
+		u8	numMips;
+		u8	format;		// DXGI_FORMAT
+		u8	flags;		// 1 = cubemap
+		u8	tileMode;
+	};
+
+	bool	open(const char * path, u32 numThreads = 0, u64 affinity = 0);	// 0 = one per core, see WorkerPool::start
+	void	close();
+
+	u32		type() const { return m_type; }
+	u32		numFiles() const { return u32(m_files.size()); }
+
+	s32				find(const char * path) const;	// case and slash insensitive, -1 if not found
+	const char *	getName(u32 idx) const;
+	u64				getSize(u32 idx) const;			// decompressed
+	bool			getTextureInfo(u32 idx, TextureInfo * out) const;
+
+	// dstLen must be at least getSize(idx)
+	bool	read(u32 idx, void * dst, u64 dstLen);
+
+	// reads several files with all of their chunks in one parallel pass, returns the number read successfully
+	u32		readBatch(const u32 * indices, void * const * dsts, const u64 * dstLens, u32 count);
+
+	void	setCacheSize(u64 bytes);
+
+private:
+	enum
+	{
+		kCompression_Zlib = 0,
+		kCompression_LZ4 = 3,
+	};
+
+	struct Chunk
+	{
+		u64	offset;
+		u32	packedSize;		// 0 = stored
+		u32	unpackedSize;
+	};
+
+	struct File
+	{
+		u32			firstChunk;
+		u32			numChunks;
+		u64			size;
+		u32			nameOffset;
+		TextureInfo	texInfo;
+	};
+
+	struct Task
+	{
+		u32	chunk;
+		u8	* dst;
+	};
+
+	struct NameHash
+	{
+		size_t operator()(const std::string & name) const;
+	};
+
+	bool	readGeneral(u64 pos, u32 numFiles);
+	bool	readTextures(u64 pos, u32 numFiles);
+	bool	readNames(u64 pos);
+
+	u32		addTasks(u32 idx, void * dst, u64 dstLen, std::vector <Task> * tasks) const;
+	bool	decompressChunk(u32 chunk, u8 * dst);
+
+	bool	getCached(u32 chunk, u8 * dst);
+	void	addCached(u32 chunk, const u8 * src, u32 len);
+
+	MappedStream				m_file;
+	u32							m_type;
+	u32							m_compression;
+
+	std::vector <File>			m_files;
+	std::vector <Chunk>			m_chunks;
+	std::vector <char>			m_names;
+	std::unordered_map <std::string, u32, NameHash>	m_lookup;
+
+	WorkerPool					m_pool;
+
+	// LRU of decompressed chunks, front is most recent
+	typedef std::list <std::pair <u32, std::vector <u8>>>	CacheList;
+
+	std::mutex					m_cacheLock;
+	CacheList					m_cache;
+	std::unordered_map <u32, CacheList::iterator>	m_cacheLookup;
+	u64							m_cacheBytes;
+	u64							m_cacheLimit;
+};
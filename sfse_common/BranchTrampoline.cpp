@@ -1,10 +1,17 @@
 #include "BranchTrampoline.h"
 #include "SafeWrite.h"
 #include <climits>
-#include <Windows.h>
+#include <cstdint>
 #include "sfse_common/Log.h"
 #include "sfse_common/Errors.h"
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 BranchTrampoline g_branchTrampoline;
 BranchTrampoline g_localTrampoline;
 
@@ -22,6 +29,8 @@ BranchTrampoline::~BranchTrampoline()
 	destroy();
 }
 
+#ifdef _WIN32
+
 bool BranchTrampoline::create(size_t len, void * module)
 {
 	if (!module) module = GetModuleHandle(NULL);
@@ -59,7 +68,7 @@ bool BranchTrampoline::create(size_t len, void * module)
 				}
 				else
 				{
-					_WARNING("trampoline alloc %016I64Xx%016I64X failed (%08X)", addr, len, GetLastError());
+					_WARNING("trampoline alloc %016llXx%016llX failed (%08X)", u64(addr), u64(len), GetLastError());
 				}
 			}
 		}
@@ -89,6 +98,59 @@ void BranchTrampoline::destroy()
 	}
 }
 
+#else
+
+bool BranchTrampoline::create(size_t len, void * module)
+{
+	// this is only here so the allocator can be built and measured off Windows. there's no VirtualQuery, so
+	// walk down from the image asking for each candidate address in turn
+	if (!module) module = &g_branchTrampoline;
+
+	uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t step = 1024 * 1024;
+
+	len = (len + pageSize - 1) & ~(pageSize - 1);
+
+	uintptr_t moduleBase = uintptr_t(module) & ~(step - 1);
+	uintptr_t maxDisplacement = 0x80000000 - (1024 * 1024 * 128); // largest 32-bit displacement with 128MB scratch space
+	uintptr_t lowestOKAddress = (moduleBase >= maxDisplacement) ? moduleBase - maxDisplacement : 0;
+
+	for (uintptr_t addr = moduleBase - len; (addr >= lowestOKAddress) && (addr < moduleBase); addr -= step)
+	{
+		void * result = mmap((void *)addr, len, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (result == MAP_FAILED)
+			continue;
+
+		// older kernels treat the address as a hint
+		if (result != (void *)addr)
+		{
+			munmap(result, len);
+			continue;
+		}
+
+		m_base = result;
+		m_len = len;
+		m_allocated = 0;
+
+		return true;
+	}
+
+	_ERROR("couldn't allocate trampoline, no free space before image");
+
+	return false;
+}
+
+void BranchTrampoline::destroy()
+{
+	if (m_base)
+	{
+		munmap(m_base, m_len);
+		m_base = nullptr;
+	}
+}
+
+#endif
+
 void BranchTrampoline::setBase(size_t len, void * base)
 {
 	ASSERT(!m_base);
@@ -166,7 +228,7 @@ bool BranchTrampoline::write6Branch_Internal(uintptr_t src, uintptr_t dst, u8 op
 		uintptr_t	nextInstr = src + 6;
 		ptrdiff_t	trampolineDispl = trampolineAddr - nextInstr;
 
-		if ((trampolineDispl >= _I32_MIN) && (trampolineDispl <= _I32_MAX))
+		if ((trampolineDispl >= INT32_MIN) && (trampolineDispl <= INT32_MAX))
 		{
 			u8	code[6];
 
@@ -242,7 +304,7 @@ bool BranchTrampoline::write5Branch_Internal(uintptr_t src, uintptr_t dst, u8 op
 		ptrdiff_t	trampolineDispl = trampolineAddr - nextInstr;
 
 		// should never fail because we're branching in to the trampoline
-		ASSERT((trampolineDispl >= _I32_MIN) && (trampolineDispl <= _I32_MAX));
+		ASSERT((trampolineDispl >= INT32_MIN) && (trampolineDispl <= INT32_MAX));
 
 		hookCode.Init(trampolineDispl, op);
 
@@ -0,0 +1,428 @@
+#include "CPUTopology.h"
+#include "sfse_common/Log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+enum
+{
+	kMaxCPUs = 64,
+};
+
+CPUTopology::CPUTopology()
+:m_numCores(0), m_numL3(0)
+{
+	//
+}
+
+CPUTopology::~CPUTopology()
+{
+	//
+}
+
+// "0-3,8,10-11" -> mask
+static u64 ParseCPUList(const char * str)
+{
+	u64 result = 0;
+
+	while(*str)
+	{
+		char * end;
+		u32 first = strtoul(str, &end, 10);
+		if(end == str)
+			break;
+
+		u32 last = first;
+		str = end;
+
+		if(*str == '-')
+		{
+			last = strtoul(str + 1, &end, 10);
+			str = end;
+		}
+
+		for(u32 i = first; (i <= last) && (i < kMaxCPUs); i++)
+			result |= 1ull << i;
+
+		if(*str != ',')
+			break;
+
+		str++;
+	}
+
+	return result;
+}
+
+static bool ReadSysfsFile(const std::string & path, std::string * out)
+{
+	FILE * f = fopen(path.c_str(), "r");
+	if(!f)
+		return false;
+
+	char buf[1024];
+	size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+
+	// strip the trailing newline
+	while(len && ((buf[len - 1] == '\n') || (buf[len - 1] == ' ')))
+		len--;
+
+	out->assign(buf, len);
+
+	return true;
+}
+
+bool CPUTopology::loadSysfs(const char * root)
+{
+	m_cpus.clear();
+
+	std::string base(root);
+	std::string text;
+
+	if(!ReadSysfsFile(base + "/online", &text) && !ReadSysfsFile(base + "/possible", &text))
+		return false;
+
+	u64 online = ParseCPUList(text.c_str());
+
+	// hybrid Intel parts list their P cores under the cpu_core PMU, other hybrid parts expose cpu_capacity
+	u64 performanceCores = 0;
+	bool hasCoreList = ReadSysfsFile(base + "/../../cpu_core/cpus", &text);
+	if(hasCoreList)
+		performanceCores = ParseCPUList(text.c_str());
+
+	std::map <std::pair <u32, u32>, u32>	cores;		// package, core id -> core
+	std::map <std::string, u32>				domains;	// L3 shared_cpu_list -> domain
+	std::vector <u32>						capacities;
+
+	for(u32 i = 0; i < kMaxCPUs; i++)
+	{
+		if(!(online & (1ull << i)))
+			continue;
+
+		std::string cpu = base + "/cpu" + std::to_string(i);
+
+		u32 package = 0;
+		u32 coreID = i;
+
+		if(ReadSysfsFile(cpu + "/topology/physical_package_id", &text))
+			package = strtoul(text.c_str(), nullptr, 10);
+		if(ReadSysfsFile(cpu + "/topology/core_id", &text))
+			coreID = strtoul(text.c_str(), nullptr, 10);
+
+		// no L3 entry falls back to one domain per package
+		std::string domain = "package" + std::to_string(package);
+
+		for(u32 index = 0; index < 8; index++)
+		{
+			std::string cache = cpu + "/cache/index" + std::to_string(index);
+			if(!ReadSysfsFile(cache + "/level", &text))
+				continue;
+
+			if((text == "3") && ReadSysfsFile(cache + "/shared_cpu_list", &text))
+			{
+				domain = text;
+				break;
+			}
+		}
+
+		u32 capacity = 0;
+		if(ReadSysfsFile(cpu + "/cpu_capacity", &text))
+			capacity = strtoul(text.c_str(), nullptr, 10);
+		else if(hasCoreList)
+			capacity = (performanceCores & (1ull << i)) ? 1 : 0;
+
+		auto core = cores.emplace(std::make_pair(package, coreID), u32(cores.size())).first;
+		auto l3 = domains.emplace(domain, u32(domains.size())).first;
+
+		LogicalCPU entry;
+		entry.id = i;
+		entry.core = core->second;
+		entry.l3 = l3->second;
+		entry.efficiencyClass = capacity;
+
+		m_cpus.push_back(entry);
+		capacities.push_back(capacity);
+	}
+
+	// capacities are arbitrary numbers, rank them so they look like windows' efficiency classes
+	std::sort(capacities.begin(), capacities.end());
+	capacities.erase(std::unique(capacities.begin(), capacities.end()), capacities.end());
+
+	for(auto & entry : m_cpus)
+		entry.efficiencyClass = u32(std::lower_bound(capacities.begin(), capacities.end(), entry.efficiencyClass) - capacities.begin());
+
+	finish();
+
+	return !m_cpus.empty();
+}
+
+#ifdef _WIN32
+
+bool CPUTopology::loadSystem()
+{
+	m_cpus.clear();
+
+	DWORD len = 0;
+	if(GetLogicalProcessorInformationEx(RelationAll, nullptr, &len) || (GetLastError() != ERROR_INSUFFICIENT_BUFFER))
+		return false;
+
+	std::vector <u8> buf(len);
+	if(!GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buf.data(), &len))
+		return false;
+
+	std::vector <u64> domains;
+	u32 numCores = 0;
+
+	for(DWORD offset = 0; offset < len; )
+	{
+		auto * info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buf.data() + offset);
+
+		if(info->Relationship == RelationProcessorCore)
+		{
+			const GROUP_AFFINITY & group = info->Processor.GroupMask[0];
+
+			if(!group.Group)
+			{
+				for(u32 i = 0; i < kMaxCPUs; i++)
+				{
+					if(group.Mask & (1ull << i))
+					{
+						LogicalCPU entry;
+						entry.id = i;
+						entry.core = numCores;
+						entry.l3 = 0;
+						entry.efficiencyClass = info->Processor.EfficiencyClass;
+
+						m_cpus.push_back(entry);
+					}
+				}
+
+				numCores++;
+			}
+		}
+		else if(info->Relationship == RelationCache)
+		{
+			if((info->Cache.Level == 3) && !info->Cache.GroupMask.Group)
+				domains.push_back(info->Cache.GroupMask.Mask);
+		}
+
+		offset += info->Size;
+	}
+
+	for(auto & entry : m_cpus)
+	{
+		for(u32 i = 0; i < domains.size(); i++)
+		{
+			if(domains[i] & (1ull << entry.id))
+			{
+				entry.l3 = i;
+				break;
+			}
+		}
+	}
+
+	finish();
+
+	return !m_cpus.empty();
+}
+
+#else
+
+bool CPUTopology::loadSystem()
+{
+	return loadSysfs();
+}
+
+#endif
+
+void CPUTopology::finish()
+{
+	std::sort(m_cpus.begin(), m_cpus.end(), [](const LogicalCPU & lhs, const LogicalCPU & rhs) {
+		return lhs.id < rhs.id;
+	});
+
+	m_numCores = 0;
+	m_numL3 = 0;
+
+	for(auto & entry : m_cpus)
+	{
+		m_numCores = std::max(m_numCores, entry.core + 1);
+		m_numL3 = std::max(m_numL3, entry.l3 + 1);
+	}
+}
+
+u64 CPUTopology::policyMask(u32 policy, u32 param) const
+{
+	if(m_cpus.empty())
+		return 0;
+
+	u64 result = 0;
+
+	u32 minClass = m_cpus[0].efficiencyClass;
+	u32 maxClass = m_cpus[0].efficiencyClass;
+
+	for(auto & entry : m_cpus)
+	{
+		minClass = std::min(minClass, entry.efficiencyClass);
+		maxClass = std::max(maxClass, entry.efficiencyClass);
+	}
+
+	switch(policy)
+	{
+		case kPolicy_PerformanceCores:
+		case kPolicy_EfficiencyCores:
+		{
+			// everything is in one class on non-hybrid parts, so this ends up being all CPUs
+			u32 wanted = (policy == kPolicy_PerformanceCores) ? maxClass : minClass;
+
+			for(auto & entry : m_cpus)
+				if(entry.efficiencyClass == wanted)
+					result |= 1ull << entry.id;
+		}
+		break;
+
+		case kPolicy_SingleL3:
+		{
+			// rank domains by size then speed, so the default is the biggest and fastest
+			std::vector <u32> size(m_numL3, 0);
+			std::vector <u32> speed(m_numL3, 0);
+			std::vector <u32> order(m_numL3);
+
+			for(auto & entry : m_cpus)
+			{
+				size[entry.l3]++;
+				speed[entry.l3] = std::max(speed[entry.l3], entry.efficiencyClass);
+			}
+
+			for(u32 i = 0; i < m_numL3; i++)
+				order[i] = i;
+
+			std::stable_sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) {
+				if(size[lhs] != size[rhs])
+					return size[lhs] > size[rhs];
+
+				return speed[lhs] > speed[rhs];
+			});
+
+			if(param < m_numL3)
+			{
+				for(auto & entry : m_cpus)
+					if(entry.l3 == order[param])
+						result |= 1ull << entry.id;
+			}
+		}
+		break;
+
+		case kPolicy_ReserveCores:
+		{
+			// give up the slowest cores first, highest numbered within a class
+			std::vector <u32> coreClass(m_numCores, 0);
+			std::vector <u32> order(m_numCores);
+			std::vector <bool> reserved(m_numCores, false);
+
+			for(auto & entry : m_cpus)
+				coreClass[entry.core] = entry.efficiencyClass;
+
+			for(u32 i = 0; i < m_numCores; i++)
+				order[i] = i;
+
+			std::sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) {
+				if(coreClass[lhs] != coreClass[rhs])
+					return coreClass[lhs] < coreClass[rhs];
+
+				return lhs > rhs;
+			});
+
+			// always leave the game at least one core
+			u32 numReserved = std::min(param, m_numCores - 1);
+			for(u32 i = 0; i < numReserved; i++)
+				reserved[order[i]] = true;
+
+			for(auto & entry : m_cpus)
+				if(!reserved[entry.core])
+					result |= 1ull << entry.id;
+		}
+		break;
+
+		case kPolicy_NoSMT:
+		{
+			std::vector <bool> seen(m_numCores, false);
+
+			for(auto & entry : m_cpus)
+			{
+				if(!seen[entry.core])
+				{
+					seen[entry.core] = true;
+					result |= 1ull << entry.id;
+				}
+			}
+		}
+		break;
+
+		case kPolicy_None:
+		default:
+			for(auto & entry : m_cpus)
+				result |= 1ull << entry.id;
+			break;
+	}
+
+	return result;
+}
+
+bool CPUTopology::parsePolicy(const char * str, u32 * policy, u32 * param)
+{
+	static const struct
+	{
+		const char	* name;
+		u32			policy;
+		bool		needsParam;
+	} kPolicies[] =
+	{
+		{ "pcores",		kPolicy_PerformanceCores,	false },
+		{ "ecores",		kPolicy_EfficiencyCores,	false },
+		{ "l3",			kPolicy_SingleL3,			false },
+		{ "reserve",	kPolicy_ReserveCores,		true },
+		{ "nosmt",		kPolicy_NoSMT,				false },
+	};
+
+	const char * sep = strchr(str, ':');
+	size_t nameLen = sep ? size_t(sep - str) : strlen(str);
+
+	for(auto & entry : kPolicies)
+	{
+		if((strlen(entry.name) != nameLen) || strncmp(str, entry.name, nameLen))
+			continue;
+
+		*policy = entry.policy;
+		*param = 0;
+
+		if(sep)
+		{
+			char * end;
+			*param = strtoul(sep + 1, &end, 10);
+			if((end == sep + 1) || *end)
+				return false;
+		}
+		else if(entry.needsParam)
+			return false;
+
+		return true;
+	}
+
+	return false;
+}
+
+void CPUTopology::log() const
+{
+	_MESSAGE("cpu topology: %d logical, %d cores, %d L3 domains", numLogical(), m_numCores, m_numL3);
+
+	for(auto & entry : m_cpus)
+		_MESSAGE("cpu %d: core %d L3 %d class %d", entry.id, entry.core, entry.l3, entry.efficiencyClass);
+}
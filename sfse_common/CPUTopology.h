@@ -0,0 +1,58 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <vector>
+
+// logical CPU -> physical core / L3 domain / efficiency class model, and affinity presets built from it
+//
+// loadSystem() uses GetLogicalProcessorInformationEx on Windows and sysfs elsewhere. loadSysfs() can also be
+// pointed at a copy of a sysfs cpu tree. only the first 64 logical CPUs (processor group 0) are modeled,
+// since affinity masks are 64 bits.
+
+class CPUTopology
+{
+public:
+	CPUTopology();
+	~CPUTopology();
+
+	enum
+	{
+		kPolicy_None = 0,
+		kPolicy_PerformanceCores,	// fastest efficiency class only
+		kPolicy_EfficiencyCores,	// slowest efficiency class only
+		kPolicy_SingleL3,			// one L3 domain, param picks which (largest first)
+		kPolicy_ReserveCores,		// leave param physical cores free, taken from the slowest
+		kPolicy_NoSMT,				// one logical CPU per physical core
+	};
+
+	struct LogicalCPU
+	{
+		u32	id;					// bit in the affinity mask
+		u32	core;				// physical core, shared by SMT siblings
+		u32	l3;					// L3 domain
+		u32	efficiencyClass;	// higher is faster, all 0 on non-hybrid parts
+	};
+
+	bool	loadSystem();
+	bool	loadSysfs(const char * root = "/sys/devices/system/cpu");
+
+	u32		numLogical() const { return u32(m_cpus.size()); }
+	u32		numCores() const { return m_numCores; }
+	u32		numL3() const { return m_numL3; }
+	const LogicalCPU *	getCPU(u32 idx) const { return (idx < m_cpus.size()) ? &m_cpus[idx] : nullptr; }
+
+	// 0 if the policy can't be satisfied
+	u64		policyMask(u32 policy, u32 param = 0) const;
+
+	// "pcores", "ecores", "l3[:n]", "reserve:n", "nosmt"
+	static bool	parsePolicy(const char * str, u32 * policy, u32 * param);
+
+	void	log() const;
+
+private:
+	void	finish();
+
+	std::vector <LogicalCPU>	m_cpus;		// sorted by id
+	u32		m_numCores;
+	u32		m_numL3;
+};
@@ -0,0 +1,370 @@
+#include "sfse_common/EditorIDMap.h"
+#include <cstring>
+#include <utility>
+
+// names are folded eight bytes at a time, byte-at-a-time hashing and compares were most of a lookup
+
+static inline u64 ReadWord(const char * data)
+{
+	u64 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+static inline u64 ReadTail(const char * data, u32 len)
+{
+	u64 result = 0;
+	memcpy(&result, data, len);
+	return result;
+}
+
+// ASCII A-Z to lowercase in every byte, other bytes unchanged
+static inline u64 LowerWord(u64 word)
+{
+	const u64 kHighBits = 0x8080808080808080ULL;
+
+	u64 low = word & ~kHighBits;
+	u64 atLeastA = low + 0x3F3F3F3F3F3F3F3FULL;	// 0x80 - 'A'
+	u64 pastZ = low + 0x2525252525252525ULL;		// 0x80 - 'Z' - 1
+	u64 upper = atLeastA & ~pastZ & ~word & kHighBits;
+
+	return word | (upper >> 2);
+}
+
+static inline u64 MixWord(u64 hash, u64 word)
+{
+	hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+	return hash ^ (hash >> 32);
+}
+
+static u32 HashName(const char * name, u32 len)
+{
+	u64 hash = len * 0x9E3779B97F4A7C15ULL;
+	u32 pos = 0;
+
+	for(; pos + 8 <= len; pos += 8)
+		hash = MixWord(hash, LowerWord(ReadWord(name + pos)));
+
+	if(pos < len)
+		hash = MixWord(hash, LowerWord(ReadTail(name + pos, len - pos)));
+
+	hash ^= hash >> 29;
+	hash *= 0xBF58476D1CE4E5B9ULL;
+	hash ^= hash >> 32;
+
+	return u32(hash);
+}
+
+// stored must have at least len + 1 readable bytes
+static bool NamesEqual(const char * stored, const char * name, u32 len)
+{
+	u32 pos = 0;
+
+	for(; pos + 8 <= len; pos += 8)
+		if(LowerWord(ReadWord(stored + pos)) != LowerWord(ReadWord(name + pos)))
+			return false;
+
+	if((pos < len) && (LowerWord(ReadTail(stored + pos, len - pos)) != LowerWord(ReadTail(name + pos, len - pos))))
+		return false;
+
+	return !stored[len];
+}
+
+// form IDs are sequential within a plugin, spread them before masking
+static inline u32 HashID(u32 formID)
+{
+	return u32((formID * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+EditorIDMap::EditorIDMap()
+	:m_mask(0), m_size(0), m_chunkUsed(kChunkSize)
+{
+	//
+}
+
+EditorIDMap::~EditorIDMap()
+{
+	//
+}
+
+void EditorIDMap::reserve(u32 count)
+{
+	u32 capacity = kMinCapacity;
+	while(capacity - (capacity / 5) < count)
+		capacity <<= 1;
+
+	if(capacity > m_names.size())
+		rehash(capacity);
+}
+
+void EditorIDMap::clear()
+{
+	m_names.clear();
+	m_ids.clear();
+	m_mask = 0;
+	m_size = 0;
+
+	m_chunks.clear();
+	m_chunkUsed = kChunkSize;
+}
+
+void EditorIDMap::add(u32 formID, const char * editorID)
+{
+	if(!formID || !editorID || !editorID[0])
+		return;
+
+	u32 len = u32(strlen(editorID));
+	u32 hash = HashName(editorID, len);
+
+	s32 nameIdx = findName(editorID, len, hash);
+	if(nameIdx >= 0 && m_names[nameIdx].formID == formID)
+		return;
+
+	remove(formID);
+
+	if(nameIdx >= 0)
+	{
+		// remove() may have shifted the name table
+		nameIdx = findName(editorID, len, hash);
+
+		// name moves to the new form
+		NameSlot & slot = m_names[nameIdx];
+
+		s32 idIdx = findID(slot.formID);
+		if(idIdx >= 0)
+			eraseIDAt(idIdx);
+
+		slot.formID = formID;
+
+		IDSlot id = { formID, slot.name };
+		insertID(id);
+	}
+	else
+	{
+		if(m_size + 1 > m_names.size() - (m_names.size() / 5))
+			rehash(m_names.empty() ? u32(kMinCapacity) : u32(m_names.size() * 2));
+
+		u32 name = storeName(editorID);
+		if(!name)
+			return;
+
+		NameSlot slot = { hash, formID, name };
+		insertName(slot);
+
+		IDSlot id = { formID, name };
+		insertID(id);
+
+		m_size++;
+	}
+}
+
+void EditorIDMap::remove(u32 formID)
+{
+	s32 idIdx = findID(formID);
+	if(idIdx < 0)
+		return;
+
+	const char * name = getName(m_ids[idIdx].name);
+	eraseIDAt(idIdx);
+
+	u32 len = u32(strlen(name));
+
+	s32 nameIdx = findName(name, len, HashName(name, len));
+	if(nameIdx >= 0)
+		eraseNameAt(nameIdx);
+
+	// the string stays in the arena until clear()
+	m_size--;
+}
+
+u32 EditorIDMap::lookup(const char * editorID) const
+{
+	if(!editorID)
+		return 0;
+
+	u32 len = u32(strlen(editorID));
+
+	s32 idx = findName(editorID, len, HashName(editorID, len));
+
+	return (idx >= 0) ? m_names[idx].formID : 0;
+}
+
+const char * EditorIDMap::getEditorID(u32 formID) const
+{
+	s32 idx = findID(formID);
+
+	return (idx >= 0) ? getName(m_ids[idx].name) : nullptr;
+}
+
+size_t EditorIDMap::memoryUsage() const
+{
+	return (m_names.capacity() * sizeof(NameSlot)) + (m_ids.capacity() * sizeof(IDSlot)) + (m_chunks.size() * size_t(kChunkSize));
+}
+
+const char * EditorIDMap::getName(u32 offset) const
+{
+	return m_chunks[offset / kChunkSize].get() + (offset % kChunkSize);
+}
+
+u32 EditorIDMap::storeName(const char * name)
+{
+	size_t len = strlen(name) + 1;
+	if(len >= kChunkSize)
+		return 0;
+
+	if(m_chunkUsed + len > kChunkSize)
+	{
+		if(m_chunks.size() >= (0xFFFFFFFF / kChunkSize))
+			return 0;
+
+		m_chunks.emplace_back(new char[kChunkSize]);
+
+		// offset 0 marks an empty slot
+		m_chunkUsed = m_chunks.size() == 1 ? 1 : 0;
+	}
+
+	u32 offset = u32((m_chunks.size() - 1) * kChunkSize) + m_chunkUsed;
+	memcpy(m_chunks.back().get() + m_chunkUsed, name, len);
+	m_chunkUsed += u32(len);
+
+	return offset;
+}
+
+void EditorIDMap::rehash(u32 capacity)
+{
+	std::vector <NameSlot> names(capacity);
+	std::vector <IDSlot> ids(capacity);
+
+	names.swap(m_names);
+	ids.swap(m_ids);
+	m_mask = capacity - 1;
+
+	for(auto & slot : names)
+		if(slot.name)
+			insertName(slot);
+
+	for(auto & slot : ids)
+		if(slot.name)
+			insertID(slot);
+}
+
+s32 EditorIDMap::findName(const char * name, u32 len, u32 hash) const
+{
+	// names never span chunks, so a name this long can't be stored too close to the end of one
+	if(m_names.empty() || (len >= kChunkSize))
+		return -1;
+
+	u32 idx = hash & m_mask;
+
+	for(u32 dist = 0; ; dist++)
+	{
+		const NameSlot & slot = m_names[idx];
+
+		// robin hood invariant: the key would have displaced anything closer to home than it
+		if(!slot.name || ((idx - slot.hash) & m_mask) < dist)
+			return -1;
+
+		if(slot.hash == hash && ((slot.name % kChunkSize) + len < kChunkSize) && NamesEqual(getName(slot.name), name, len))
+			return s32(idx);
+
+		idx = (idx + 1) & m_mask;
+	}
+}
+
+s32 EditorIDMap::findID(u32 formID) const
+{
+	if(m_ids.empty())
+		return -1;
+
+	u32 idx = HashID(formID) & m_mask;
+
+	for(u32 dist = 0; ; dist++)
+	{
+		const IDSlot & slot = m_ids[idx];
+
+		if(!slot.name || ((idx - HashID(slot.formID)) & m_mask) < dist)
+			return -1;
+
+		if(slot.formID == formID)
+			return s32(idx);
+
+		idx = (idx + 1) & m_mask;
+	}
+}
+
+void EditorIDMap::insertName(NameSlot slot)
+{
+	u32 idx = slot.hash & m_mask;
+	u32 dist = 0;
+
+	while(m_names[idx].name)
+	{
+		u32 existingDist = (idx - m_names[idx].hash) & m_mask;
+		if(existingDist < dist)
+		{
+			std::swap(slot, m_names[idx]);
+			dist = existingDist;
+		}
+
+		idx = (idx + 1) & m_mask;
+		dist++;
+	}
+
+	m_names[idx] = slot;
+}
+
+void EditorIDMap::insertID(IDSlot slot)
+{
+	u32 idx = HashID(slot.formID) & m_mask;
+	u32 dist = 0;
+
+	while(m_ids[idx].name)
+	{
+		u32 existingDist = (idx - HashID(m_ids[idx].formID)) & m_mask;
+		if(existingDist < dist)
+		{
+			std::swap(slot, m_ids[idx]);
+			dist = existingDist;
+		}
+
+		idx = (idx + 1) & m_mask;
+		dist++;
+	}
+
+	m_ids[idx] = slot;
+}
+
+// backward shift deletion, no tombstones
+void EditorIDMap::eraseNameAt(u32 idx)
+{
+	for(;;)
+	{
+		u32 next = (idx + 1) & m_mask;
+		const NameSlot & slot = m_names[next];
+
+		if(!slot.name || ((next - slot.hash) & m_mask) == 0)
+			break;
+
+		m_names[idx] = slot;
+		idx = next;
+	}
+
+	m_names[idx] = NameSlot();
+}
+
+void EditorIDMap::eraseIDAt(u32 idx)
+{
+	for(;;)
+	{
+		u32 next = (idx + 1) & m_mask;
+		const IDSlot & slot = m_ids[next];
+
+		if(!slot.name || ((next - HashID(slot.formID)) & m_mask) == 0)
+			break;
+
+		m_ids[idx] = slot;
+		idx = next;
+	}
+
+	m_ids[idx] = IDSlot();
+}
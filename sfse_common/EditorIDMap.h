@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <memory>
+#include <vector>
+
+// compact editor ID <-> form ID map
+//
+// names are copied into a chunked string arena and referenced by a 32-bit offset, so returned strings stay
+// valid until clear(). both directions are open-addressed robin hood tables that share a capacity: a lookup
+// is one hash and a short linear probe, and each pairing costs 12 + 8 bytes of table plus its string.
+// names compare case-insensitively, like the game's.
+
+class EditorIDMap
+{
+public:
+	EditorIDMap();
+	~EditorIDMap();
+
+	void	reserve(u32 count);
+	void	clear();
+
+	// a form has one editor ID and a name belongs to one form, re-adding either replaces the old pairing
+	void	add(u32 formID, const char * editorID);
+	void	remove(u32 formID);
+
+	u32				lookup(const char * editorID) const;	// 0 if not found
+	const char *	getEditorID(u32 formID) const;			// nullptr if not found
+
+	u32		size() const { return m_size; }
+	size_t	memoryUsage() const;
+
+private:
+	enum
+	{
+		kChunkSize = 64 * 1024,
+		kMinCapacity = 1024,
+	};
+
+	struct NameSlot
+	{
+		u32	hash;
+		u32	formID;
+		u32	name;	// arena offset, 0 = empty
+	};
+
+	struct IDSlot
+	{
+		u32	formID;
+		u32	name;	// arena offset, 0 = empty
+	};
+
+	const char *	getName(u32 offset) const;
+	u32		storeName(const char * name);
+
+	void	rehash(u32 capacity);
+
+	s32		findName(const char * name, u32 len, u32 hash) const;
+	s32		findID(u32 formID) const;
+	void	insertName(NameSlot slot);
+	void	insertID(IDSlot slot);
+	void	eraseNameAt(u32 idx);
+	void	eraseIDAt(u32 idx);
+
+	std::vector <NameSlot>	m_names;
+	std::vector <IDSlot>	m_ids;
+	u32		m_mask;		// capacity - 1
+	u32		m_size;
+
+	std::vector <std::unique_ptr <char[]>>	m_chunks;
+	u32		m_chunkUsed;
+};
@@ -2,11 +2,18 @@
 #include "Log.h"
 #include "Types.h"
 #include <cstdlib>
+
+#ifdef _MSC_VER
 #include <intrin.h>
+#endif
 
 [[noreturn]] static void IErrors_Halt(void)
 {
+#ifdef _MSC_VER
 	__ud2();
+#else
+	__builtin_trap();
+#endif
 }
 
 /**
@@ -34,7 +41,7 @@
 [[noreturn]] void _AssertionFailed_ErrCode(const char * file, unsigned long line, const char * desc, unsigned long long code)
 {
 	if(code & 0xFFFFFFFF00000000)
-		_FATALERROR("Assertion failed in %s (%d): %s (code = %16I64X (%I64d))", file, line, desc, code, code);
+		_FATALERROR("Assertion failed in %s (%d): %s (code = %16llX (%lld))", file, line, desc, code, code);
 	else
 	{
 		u32	code32 = code;
@@ -17,16 +17,11 @@
 //! Exit the program with and error code and message
 #define HALT_CODE(a, b)				do { _AssertionFailed_ErrCode(__FILE__, __LINE__, a, b); } while(0)
 
-// based on the boost implementation of static asserts
-template <bool x> struct StaticAssertFailure;
-template <> struct StaticAssertFailure <true> { enum { a = 1 }; };
-template <int x> struct static_assert_test { };
-
 #define __MACRO_JOIN__(a, b)		__MACRO_JOIN_2__(a, b)
 #define __MACRO_JOIN_2__(a, b)		__MACRO_JOIN_3__(a, b)
 #define __MACRO_JOIN_3__(a, b)		a##b
 #define __PREPRO_TOKEN_STR2__(a)	#a
 #define __PREPRO_TOKEN_STR__(a)		__PREPRO_TOKEN_STR2__(a)
-#define __LOC__						__FILE__ "("__PREPRO_TOKEN_STR__(__LINE__)") : "
+#define __LOC__						__FILE__ "(" __PREPRO_TOKEN_STR__(__LINE__) ") : "
 
-#define STATIC_ASSERT(a)	typedef static_assert_test <sizeof(StaticAssertFailure<(bool)(a)>)> __MACRO_JOIN__(static_assert_typedef_, __COUNTER__)
+#define STATIC_ASSERT(a)	static_assert(a, #a)
@@ -1,7 +1,49 @@
 #include "FileStream.h"
 #include <string>
+
+#ifdef _WIN32
+
 #include <direct.h>
 
+#else
+
+#include <cstdlib>
+#include <sys/stat.h>
+
+// stdio equivalents of the MSVC CRT calls used below
+#define _fseeki64_nolock	fseeko
+#define _ftelli64_nolock	ftello
+#define _fread_nolock		fread_unlocked
+#define _fwrite_nolock		fwrite_unlocked
+
+static int fopen_s(FILE ** file, const char * path, const char * mode)
+{
+	*file = fopen(path, mode);
+
+	return *file ? 0 : -1;
+}
+
+static int _wfopen_s(FILE ** file, const wchar_t * path, const wchar_t * mode)
+{
+	char narrowPath[4096];
+	char narrowMode[16];
+
+	*file = nullptr;
+
+	if((wcstombs(narrowPath, path, sizeof(narrowPath)) >= sizeof(narrowPath)) ||
+		(wcstombs(narrowMode, mode, sizeof(narrowMode)) >= sizeof(narrowMode)))
+		return -1;
+
+	return fopen_s(file, narrowPath, narrowMode);
+}
+
+static int _mkdir(const char * path)
+{
+	return mkdir(path, 0777);
+}
+
+#endif
+
 FileStream::FileStream()
 : m_file(nullptr)
 {
@@ -114,7 +156,7 @@ void FileStream::makeDirs(const char * path)
 {
 	std::string fullPath = path;
 
-	for (uint i = 1; i < fullPath.size(); i++)
+	for (size_t i = 1; i < fullPath.size(); i++)
 	{
 		char data = fullPath[i];
 
@@ -0,0 +1,273 @@
+#include "FlightRecorder.h"
+#include "sfse_common/Platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static u64 GetTimestamp()
+{
+	return std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// only has to catch torn and overwritten records, so a word at a time multiply/xorshift rather than a real CRC
+static u32 GetChecksum(const FlightRecord * record, const void * text)
+{
+	u64 hash = 0xCBF29CE484222325;
+
+	auto mix = [&hash](u64 value)
+	{
+		hash = (hash ^ value) * 0x9E3779B97F4A7C15;
+		hash ^= hash >> 29;
+	};
+
+	mix(record->sequence);
+	mix(record->timestamp);
+	mix(record->length | (u64(record->level) << 16) | (u64(record->pad1F) << 24));
+
+	const u8 * bytes = (const u8 *)text;
+	u32 len = record->length;
+
+	for(; len >= sizeof(u64); bytes += sizeof(u64), len -= sizeof(u64))
+	{
+		u64 value;
+		memcpy(&value, bytes, sizeof(value));
+		mix(value);
+	}
+
+	if(len)
+	{
+		u64 value = 0;
+		memcpy(&value, bytes, len);
+		mix(value);
+	}
+
+	return u32(hash ^ (hash >> 32));
+}
+
+FlightRecorder::FlightRecorder()
+	:m_header(nullptr), m_data(nullptr), m_mappedSize(0), m_file(nullptr), m_mapping(nullptr)
+{
+	//
+}
+
+FlightRecorder::~FlightRecorder()
+{
+	close();
+}
+
+bool FlightRecorder::open(const char * path, u64 size)
+{
+	close();
+
+	size = (size + kFlightRecordAlign - 1) & ~u64(kFlightRecordAlign - 1);
+	if(size < sizeof(FlightRecord) + kFlightRecordAlign)
+		return false;
+
+	u64 mappedSize = sizeof(FlightRecorderHeader) + size;
+	void * view = nullptr;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// sizing the mapping extends the file
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(mappedSize >> 32), (DWORD)mappedSize, nullptr);
+	if(mapping)
+		view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, mappedSize);
+
+	if(!view)
+	{
+		if(mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+#else
+	int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return false;
+
+	if(!ftruncate(fd, mappedSize))
+	{
+		view = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(view == MAP_FAILED)
+			view = nullptr;
+	}
+
+	// the mapping keeps the file referenced
+	::close(fd);
+
+	if(!view)
+		return false;
+#endif
+
+	m_mappedSize = mappedSize;
+	m_header = (FlightRecorderHeader *)view;
+	m_data = ((u8 *)view) + sizeof(FlightRecorderHeader);
+
+	// the file was truncated so everything starts zeroed, magic goes last
+	m_header->version = kFlightRecorderVersion;
+	m_header->headerSize = sizeof(FlightRecorderHeader);
+#ifdef _WIN32
+	m_header->pid = GetCurrentProcessId();
+#else
+	m_header->pid = getpid();
+#endif
+	m_header->dataSize = size;
+	m_header->startTime = GetTimestamp();
+	m_header->writeOffset.store(0, std::memory_order_relaxed);
+	m_header->sequence.store(0, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_release);
+	((std::atomic <u32> *)&m_header->magic)->store(kFlightRecorderMagic, std::memory_order_release);
+
+	return true;
+}
+
+void FlightRecorder::close()
+{
+	if(!m_header)
+		return;
+
+	// no flush, the OS owns the dirty pages either way
+#ifdef _WIN32
+	UnmapViewOfFile(m_header);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+#else
+	munmap(m_header, m_mappedSize);
+#endif
+
+	m_header = nullptr;
+	m_data = nullptr;
+	m_mappedSize = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+void FlightRecorder::write(u32 level, const char * text, u32 length)
+{
+	if(!m_header)
+		return;
+
+	u64 dataSize = m_header->dataSize;
+
+	length = std::min <u64>(std::min <u32>(length, kFlightRecordMaxText), dataSize - sizeof(FlightRecord));
+
+	u64 size = (sizeof(FlightRecord) + length + kFlightRecordAlign - 1) & ~u64(kFlightRecordAlign - 1);
+
+	// reserve space, records never wrap so skip to the start of the ring when one won't fit at the end
+	u64 offset = m_header->writeOffset.load(std::memory_order_relaxed);
+	u64 pos;
+
+	for(;;)
+	{
+		u64 start = offset;
+
+		pos = start % dataSize;
+		if(pos + size > dataSize)
+		{
+			start += dataSize - pos;
+			pos = 0;
+		}
+
+		if(m_header->writeOffset.compare_exchange_weak(offset, start + size, std::memory_order_relaxed))
+			break;
+	}
+
+	FlightRecord * record = (FlightRecord *)(m_data + pos);
+
+	// invalidate whatever was here before filling it in, a crash part way through leaves a bad checksum
+	record->magic.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	record->size = size;
+	record->sequence = m_header->sequence.fetch_add(1, std::memory_order_relaxed);
+	record->timestamp = GetTimestamp();
+	record->length = length;
+	record->level = level;
+	record->pad1F = 0;
+
+	memcpy(((u8 *)record) + sizeof(FlightRecord), text, length);
+
+	record->checksum = GetChecksum(record, text);
+
+	record->magic.store(kFlightRecordMagic, std::memory_order_release);
+}
+
+bool FlightRecorder_Decode(const void * data, u64 size, FlightRecorderInfo * info, std::vector <FlightRecorderEntry> * out)
+{
+	out->clear();
+
+	if(size < sizeof(FlightRecorderHeader))
+		return false;
+
+	const FlightRecorderHeader * header = (const FlightRecorderHeader *)data;
+
+	if((header->magic != kFlightRecorderMagic) ||
+		(header->version != kFlightRecorderVersion) ||
+		(header->headerSize < sizeof(FlightRecorderHeader)) ||
+		(header->headerSize > size) ||
+		(header->headerSize % kFlightRecordAlign))
+		return false;
+
+	// a short file (copied mid-write or cut off) still decodes as far as it goes
+	u64 dataSize = std::min(header->dataSize, size - header->headerSize) & ~u64(kFlightRecordAlign - 1);
+	const u8 * ring = ((const u8 *)data) + header->headerSize;
+
+	if(info)
+	{
+		info->pid = header->pid;
+		info->startTime = header->startTime;
+		info->dataSize = header->dataSize;
+		info->nextSequence = header->sequence.load(std::memory_order_relaxed);
+	}
+
+	// don't trust the write offset, a crash may have left it ahead of the records. every record starts aligned
+	u64 pos = 0;
+
+	while(pos + sizeof(FlightRecord) <= dataSize)
+	{
+		const FlightRecord * record = (const FlightRecord *)(ring + pos);
+		const u8 * text = (const u8 *)(record + 1);
+
+		if((record->magic.load(std::memory_order_relaxed) == kFlightRecordMagic) &&
+			(record->size >= sizeof(FlightRecord)) &&
+			!(record->size % kFlightRecordAlign) &&
+			(record->size <= dataSize - pos) &&
+			(sizeof(FlightRecord) + record->length <= record->size) &&
+			(record->checksum == GetChecksum(record, text)))
+		{
+			FlightRecorderEntry entry;
+
+			entry.sequence = record->sequence;
+			entry.timestamp = record->timestamp;
+			entry.level = record->level;
+			entry.text.assign((const char *)text, record->length);
+
+			out->push_back(std::move(entry));
+
+			pos += record->size;
+		}
+		else
+		{
+			pos += kFlightRecordAlign;
+		}
+	}
+
+	std::sort(out->begin(), out->end(), [](const FlightRecorderEntry & lhs, const FlightRecorderEntry & rhs)
+	{
+		return lhs.sequence < rhs.sequence;
+	});
+
+	return true;
+}
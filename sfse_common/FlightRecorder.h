@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// a fixed size log ring in a memory mapped file
+//
+// records are written straight in to a shared file mapping, so the OS writes them back even if the process dies
+// without flushing anything, and nothing on the logging path waits on the disk. when the ring fills, the oldest
+// records are overwritten.
+//
+// each record carries a sequence number and a checksum, and its magic is stored last. a record that was torn by a
+// crash or partly overwritten by a newer one fails validation, so the decoder doesn't need to trust the write
+// offset: it scans the whole ring for intact records and sorts them by sequence. gaps in the sequence show where
+// records were lost.
+
+enum
+{
+	kFlightRecorderMagic = 0x52464653,	// 'SFFR'
+	kFlightRecorderVersion = 1,
+	kFlightRecordMagic = 0x43455246,	// 'FREC'
+	kFlightRecordAlign = 8,
+	kFlightRecordMaxText = 0xFFFF,
+};
+
+struct FlightRecorderHeader
+{
+	u32					magic;			// 00
+	u32					version;		// 04
+	u32					headerSize;		// 08 ring data starts here
+	u32					pid;			// 0C
+	u64					dataSize;		// 10 multiple of kFlightRecordAlign
+	u64					startTime;		// 18 ns since the unix epoch
+	std::atomic <u64>	writeOffset;	// 20 total bytes reserved, only a hint for readers
+	std::atomic <u64>	sequence;		// 28 next record
+	u64					pad30[2];		// 30
+};
+static_assert(sizeof(FlightRecorderHeader) == 0x40, "FlightRecorderHeader");
+
+struct FlightRecord
+{
+	std::atomic <u32>	magic;		// 00 written last, cleared first
+	u32					size;		// 04 header and text rounded up to kFlightRecordAlign
+	u64					sequence;	// 08
+	u64					timestamp;	// 10 ns since the unix epoch
+	u32					checksum;	// 18 of sequence, timestamp, the fields below and the text
+	u16					length;		// 1C text bytes, not terminated
+	u8					level;		// 1E DebugLog::LogLevel
+	u8					pad1F;		// 1F
+	// text follows
+};
+static_assert(sizeof(FlightRecord) == 0x20, "FlightRecord");
+
+class FlightRecorder
+{
+public:
+	FlightRecorder();
+	~FlightRecorder();
+
+	// creates or truncates the file, size is the ring data and gets rounded up to kFlightRecordAlign
+	bool	open(const char * path, u64 size);
+	void	close();
+
+	bool	isOpen() const	{ return m_header != nullptr; }
+
+	// thread-safe, text longer than kFlightRecordMaxText is truncated
+	void	write(u32 level, const char * text, u32 length);
+
+private:
+	FlightRecorderHeader	* m_header;
+	u8						* m_data;
+	u64						m_mappedSize;
+	void					* m_file;
+	void					* m_mapping;
+};
+
+struct FlightRecorderEntry
+{
+	u64			sequence;
+	u64			timestamp;
+	u32			level;
+	std::string	text;
+};
+
+struct FlightRecorderInfo
+{
+	u32		pid;
+	u64		startTime;
+	u64		dataSize;
+	u64		nextSequence;	// from the header, may be ahead of the last intact record after a crash
+};
+
+// reads a ring file image and returns its intact records ordered by sequence. false if it isn't a ring file
+bool FlightRecorder_Decode(const void * data, u64 size, FlightRecorderInfo * info, std::vector <FlightRecorderEntry> * out);
@@ -0,0 +1,423 @@
+#include "Inflate.h"
+#include <cstring>
+
+// canonical huffman decoding in the style of zlib's puff, with a lookup table for short codes
+
+namespace
+{
+	enum
+	{
+		kMaxBits = 15,
+		kFastBits = 10,
+		kMaxLitLenCodes = 288,
+		kMaxDistCodes = 30,
+	};
+
+	struct Huffman
+	{
+		u16	count[kMaxBits + 1];		// number of codes of each length
+		u16	symbol[kMaxLitLenCodes];	// symbols ordered by code
+		u16	fast[1 << kFastBits];		// (symbol << 4) | length, indexed by bit-reversed code, 0 = not a short code
+	};
+
+	const u16 kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const u8 kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const u16 kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const u8 kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const u8 kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// returns false if the lengths are over-subscribed. incomplete codes are allowed, decode() catches them
+	bool BuildHuffman(Huffman * h, const u8 * lengths, u32 numSymbols)
+	{
+		memset(h->count, 0, sizeof(h->count));
+		memset(h->fast, 0, sizeof(h->fast));
+
+		for(u32 i = 0; i < numSymbols; i++)
+			h->count[lengths[i]]++;
+
+		h->count[0] = 0;
+
+		s32 left = 1;
+		for(u32 len = 1; len <= kMaxBits; len++)
+		{
+			left <<= 1;
+			left -= h->count[len];
+			if(left < 0)
+				return false;
+		}
+
+		u16 offsets[kMaxBits + 1];
+		u16 nextCode[kMaxBits + 1];
+		u32 code = 0;
+
+		offsets[1] = 0;
+		nextCode[0] = 0;
+		for(u32 len = 1; len <= kMaxBits; len++)
+		{
+			if(len < kMaxBits)
+				offsets[len + 1] = offsets[len] + h->count[len];
+
+			code = (code + h->count[len - 1]) << 1;
+			nextCode[len] = u16(code);
+		}
+
+		for(u32 sym = 0; sym < numSymbols; sym++)
+		{
+			u32 len = lengths[sym];
+			if(!len)
+				continue;
+
+			h->symbol[offsets[len]++] = u16(sym);
+
+			u32 symCode = nextCode[len]++;
+			if(len <= kFastBits)
+			{
+				// codes are stored msb first in the stream, the table is indexed by bits as they arrive
+				u32 reversed = 0;
+				for(u32 i = 0; i < len; i++)
+					reversed |= ((symCode >> i) & 1) << (len - 1 - i);
+
+				for(u32 idx = reversed; idx < (1 << kFastBits); idx += (1 << len))
+					h->fast[idx] = u16((sym << 4) | len);
+			}
+		}
+
+		return true;
+	}
+
+	class Inflater
+	{
+	public:
+		Inflater(const u8 * src, size_t srcLen, u8 * dst, size_t dstLen)
+			:m_src(src), m_srcLen(srcLen), m_srcPos(0), m_bitBuf(0), m_bitCount(0),
+			m_dst(dst), m_dstLen(dstLen), m_dstPos(0), m_error(false), m_full(false) { }
+
+		bool	run();
+		size_t	written() const { return m_dstPos; }
+
+	private:
+		void	refill();
+		u32		bits(u32 count);
+		u32		decode(const Huffman & h);
+
+		bool	stored();
+		bool	fixed();
+		bool	dynamic();
+		bool	codes(const Huffman & lenCodes, const Huffman & distCodes);
+
+		const u8	* m_src;
+		size_t		m_srcLen;
+		size_t		m_srcPos;
+		u64			m_bitBuf;
+		u32			m_bitCount;
+
+		u8			* m_dst;
+		size_t		m_dstLen;
+		size_t		m_dstPos;
+
+		bool		m_error;
+		bool		m_full;		// dst ran out, not an error
+	};
+
+	void Inflater::refill()
+	{
+		while((m_bitCount <= 56) && (m_srcPos < m_srcLen))
+		{
+			m_bitBuf |= u64(m_src[m_srcPos++]) << m_bitCount;
+			m_bitCount += 8;
+		}
+	}
+
+	u32 Inflater::bits(u32 count)
+	{
+		if(m_bitCount < count)
+		{
+			refill();
+
+			if(m_bitCount < count)
+			{
+				m_error = true;
+				return 0;
+			}
+		}
+
+		u32 result = u32(m_bitBuf & ((u64(1) << count) - 1));
+		m_bitBuf >>= count;
+		m_bitCount -= count;
+
+		return result;
+	}
+
+	u32 Inflater::decode(const Huffman & h)
+	{
+		if(m_bitCount < kMaxBits)
+			refill();
+
+		u32 entry = h.fast[m_bitBuf & ((1 << kFastBits) - 1)];
+		if(entry && ((entry & 0xF) <= m_bitCount))
+		{
+			m_bitBuf >>= (entry & 0xF);
+			m_bitCount -= (entry & 0xF);
+
+			return entry >> 4;
+		}
+
+		// long code, walk it a bit at a time
+		s32 code = 0;
+		s32 first = 0;
+		s32 index = 0;
+
+		for(u32 len = 1; len <= kMaxBits; len++)
+		{
+			code |= bits(1);
+			if(m_error)
+				return 0;
+
+			s32 count = h.count[len];
+			if(code - count < first)
+				return h.symbol[index + (code - first)];
+
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+
+		m_error = true;
+		return 0;
+	}
+
+	bool Inflater::run()
+	{
+		// zlib header: deflate, no preset dictionary
+		u32 cmf = bits(8);
+		u32 flg = bits(8);
+		if(m_error || ((cmf & 0x0F) != 8) || (((cmf << 8) | flg) % 31) || (flg & 0x20))
+			return false;
+
+		u32 last;
+		do
+		{
+			last = bits(1);
+			u32 type = bits(2);
+			if(m_error)
+				return false;
+
+			bool ok;
+			switch(type)
+			{
+				case 0:	ok = stored(); break;
+				case 1:	ok = fixed(); break;
+				case 2:	ok = dynamic(); break;
+				default: ok = false; break;
+			}
+
+			if(!ok)
+				return false;
+		}
+		while(!last && !m_full);
+
+		return true;
+	}
+
+	bool Inflater::stored()
+	{
+		// skip to a byte boundary
+		bits(m_bitCount & 7);
+
+		u32 len = bits(16);
+		u32 nlen = bits(16);
+		if(m_error || (len != (~nlen & 0xFFFF)))
+			return false;
+
+		// drain whole bytes left in the bit buffer, then copy directly
+		while(len && m_bitCount)
+		{
+			if(m_dstPos == m_dstLen)
+			{
+				m_full = true;
+				return true;
+			}
+
+			m_dst[m_dstPos++] = u8(bits(8));
+			len--;
+		}
+
+		if(len > m_srcLen - m_srcPos)
+			return false;
+
+		size_t copyLen = len;
+		if(copyLen > m_dstLen - m_dstPos)
+		{
+			copyLen = m_dstLen - m_dstPos;
+			m_full = true;
+		}
+
+		memcpy(m_dst + m_dstPos, m_src + m_srcPos, copyLen);
+		m_dstPos += copyLen;
+		m_srcPos += len;
+
+		return true;
+	}
+
+	struct FixedCodes
+	{
+		FixedCodes()
+		{
+			u8 lengths[kMaxLitLenCodes];
+			u32 i = 0;
+
+			for(; i < 144; i++) lengths[i] = 8;
+			for(; i < 256; i++) lengths[i] = 9;
+			for(; i < 280; i++) lengths[i] = 7;
+			for(; i < kMaxLitLenCodes; i++) lengths[i] = 8;
+			BuildHuffman(&lenCodes, lengths, kMaxLitLenCodes);
+
+			for(i = 0; i < kMaxDistCodes; i++) lengths[i] = 5;
+			BuildHuffman(&distCodes, lengths, kMaxDistCodes);
+		}
+
+		Huffman	lenCodes;
+		Huffman	distCodes;
+	};
+
+	bool Inflater::fixed()
+	{
+		static const FixedCodes s_fixed;
+
+		return codes(s_fixed.lenCodes, s_fixed.distCodes);
+	}
+
+	bool Inflater::dynamic()
+	{
+		u32 numLen = bits(5) + 257;
+		u32 numDist = bits(5) + 1;
+		u32 numCode = bits(4) + 4;
+		if(m_error || (numLen > 286) || (numDist > kMaxDistCodes))
+			return false;
+
+		u8 lengths[kMaxLitLenCodes + kMaxDistCodes] = { 0 };
+
+		for(u32 i = 0; i < numCode; i++)
+			lengths[kCodeLengthOrder[i]] = u8(bits(3));
+
+		Huffman lenCodes, distCodes;
+		if(m_error || !BuildHuffman(&lenCodes, lengths, 19))
+			return false;
+
+		u32 idx = 0;
+		while(idx < numLen + numDist)
+		{
+			u32 sym = decode(lenCodes);
+			if(m_error)
+				return false;
+
+			if(sym < 16)
+			{
+				lengths[idx++] = u8(sym);
+				continue;
+			}
+
+			u8 len = 0;
+			u32 repeat;
+
+			if(sym == 16)
+			{
+				if(!idx)
+					return false;
+
+				len = lengths[idx - 1];
+				repeat = 3 + bits(2);
+			}
+			else if(sym == 17)
+				repeat = 3 + bits(3);
+			else
+				repeat = 11 + bits(7);
+
+			if(m_error || (idx + repeat > numLen + numDist))
+				return false;
+
+			while(repeat--)
+				lengths[idx++] = len;
+		}
+
+		// end of block code is required
+		if(!lengths[256])
+			return false;
+
+		if(!BuildHuffman(&lenCodes, lengths, numLen) || !BuildHuffman(&distCodes, lengths + numLen, numDist))
+			return false;
+
+		return codes(lenCodes, distCodes);
+	}
+
+	bool Inflater::codes(const Huffman & lenCodes, const Huffman & distCodes)
+	{
+		for(;;)
+		{
+			u32 sym = decode(lenCodes);
+			if(m_error)
+				return false;
+
+			if(sym < 256)
+			{
+				if(m_dstPos == m_dstLen)
+				{
+					m_full = true;
+					return true;
+				}
+
+				m_dst[m_dstPos++] = u8(sym);
+			}
+			else if(sym == 256)
+			{
+				return true;
+			}
+			else
+			{
+				sym -= 257;
+				if(sym >= 29)
+					return false;
+
+				u32 len = kLengthBase[sym] + bits(kLengthExtra[sym]);
+
+				u32 distSym = decode(distCodes);
+				if(m_error || (distSym >= kMaxDistCodes))
+					return false;
+
+				u32 dist = kDistBase[distSym] + bits(kDistExtra[distSym]);
+				if(m_error || (dist > m_dstPos))
+					return false;
+
+				if(len > m_dstLen - m_dstPos)
+				{
+					len = u32(m_dstLen - m_dstPos);
+					m_full = true;
+				}
+
+				// may overlap, copy forwards a byte at a time
+				const u8 * from = m_dst + m_dstPos - dist;
+				u8 * to = m_dst + m_dstPos;
+				for(u32 i = 0; i < len; i++)
+					to[i] = from[i];
+
+				m_dstPos += len;
+
+				if(m_full)
+					return true;
+			}
+		}
+	}
+}
+
+bool Inflate(const void * src, size_t srcLen, void * dst, size_t dstLen, size_t * written)
+{
+	Inflater inflater((const u8 *)src, srcLen, (u8 *)dst, dstLen);
+
+	bool result = inflater.run();
+
+	if(written)
+		*written = inflater.written();
+
+	return result;
+}
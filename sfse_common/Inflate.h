@@ -0,0 +1,9 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+// zlib stream decompression (RFC 1950/1951) for data files and archives
+//
+// output stops cleanly when dst is full, so a short buffer can be used to decode just the start of a stream.
+// returns false for corrupt or truncated input. the adler32 trailer isn't checked.
+bool Inflate(const void * src, size_t srcLen, void * dst, size_t dstLen, size_t * written = nullptr);
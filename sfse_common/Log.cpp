@@ -1,15 +1,24 @@
 #include "Log.h"
 #include "Errors.h"
 #include "FileStream.h"
+#include "FlightRecorder.h"
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
 #include <share.h>
 #include <shlobj.h>
+#endif
 
 // Initialize static members of the DebugLog class.
 FILE* DebugLog::s_log = nullptr;
+FlightRecorder* DebugLog::s_flightRecorder = nullptr;
 DebugLog::LogLevel DebugLog::s_fileLevel = DebugLog::kLevel_DebugMessage;
 DebugLog::LogLevel DebugLog::s_printLevel = DebugLog::kLevel_Message;
 char DebugLog::s_formatBuf[8192] = { 0 };
 
+static std::string s_logPath;
+
 /**
  * @brief Open a debug log file at the specified path.
  *
@@ -17,9 +26,17 @@ char DebugLog::s_formatBuf[8192] = { 0 };
  */
 void DebugLog::open(const char* path)
 {
+    s_logPath = path;
+
+#ifdef _WIN32
     s_log = _fsopen(path, "w", _SH_DENYWR);
+#else
+    s_log = fopen(path, "w");
+#endif
 }
 
+#ifdef _WIN32
+
 /**
  * @brief Open a debug log file relative to a system folder.
  *
@@ -44,6 +61,42 @@ void DebugLog::openRelative(int folderID, const char* relPath)
     open(path);
 }
 
+#endif
+
+/**
+ * @brief Open a flight recorder ring next to the log file.
+ *
+ * @param size The size of the ring in bytes.
+ * @return True if the ring file was created and mapped.
+ */
+bool DebugLog::openFlightRecorder(unsigned long long size)
+{
+    if (s_flightRecorder || s_logPath.empty())
+        return false;
+
+    // swap the log's extension for .ring
+    std::string path = s_logPath;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("\\/");
+
+    if ((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash)))
+        path.resize(dot);
+
+    path += ".ring";
+
+    // never destroyed, other threads may still be logging during shutdown
+    FlightRecorder* recorder = new FlightRecorder;
+    if (!recorder->open(path.c_str(), size))
+    {
+        delete recorder;
+        return false;
+    }
+
+    s_flightRecorder = recorder;
+
+    return true;
+}
+
 /**
  * @brief Log a message with the specified log level.
  *
@@ -58,15 +111,28 @@ void DebugLog::log(LogLevel level, const char* fmt, va_list args)
 
     static FILE* s_stdout = nullptr;
 
+    int len = 0;
+
     if (toFile || toConsole)
     {
-        vsprintf_s(s_formatBuf, sizeof(s_formatBuf), fmt, args);
-        strcat_s(s_formatBuf, sizeof(s_formatBuf), "\n");
+        // vsnprintf returns the untruncated length, clamp it so the newline always fits
+        len = vsnprintf(s_formatBuf, sizeof(s_formatBuf) - 1, fmt, args);
+        if (len < 0)
+            len = 0;
+        else if (len > int(sizeof(s_formatBuf) - 2))
+            len = sizeof(s_formatBuf) - 2;
+
+        s_formatBuf[len] = '\n';
+        s_formatBuf[len + 1] = 0;
     }
 
     if (toFile && s_log)
         fputs(s_formatBuf, s_log);
 
+    // without the newline
+    if (toFile && s_flightRecorder)
+        s_flightRecorder->write(level, s_formatBuf, len);
+
     if (toConsole)
     {
         if (!s_stdout)
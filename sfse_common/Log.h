@@ -3,12 +3,18 @@
 #include <cstdarg>
 #include <cstdio>
 
+class FlightRecorder;
+
 class DebugLog
 {
 public:
 	static void open(const char * path);
 	static void openRelative(int folderID, const char * relPath);
 
+	// also write log file lines to a memory mapped ring next to the log (.ring instead of the log's extension)
+	// that survives a crash without flushing. decode it with sfse_flightlog
+	static bool openFlightRecorder(unsigned long long size);
+
 	enum LogLevel
 	{
 		kLevel_FatalError = 0,
@@ -25,6 +31,7 @@ public:
 
 private:
 	static FILE * s_log;
+	static FlightRecorder * s_flightRecorder;
 
 	static LogLevel s_fileLevel;
 	static LogLevel s_printLevel;
@@ -0,0 +1,180 @@
+#include "MappedStream.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedStream::MappedStream()
+:m_data(nullptr), m_mapping(nullptr)
+{
+	//
+}
+
+MappedStream::~MappedStream()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedStream::open(const char * path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	return internalSetup(file);
+}
+
+bool MappedStream::open(const wchar_t * path)
+{
+	close();
+
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	return internalSetup(file);
+}
+
+void MappedStream::close()
+{
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	m_len = 0;
+	m_offset = 0;
+}
+
+#else
+
+bool MappedStream::open(const char * path)
+{
+	close();
+
+	int file = ::open(path, O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat info;
+	bool result = false;
+
+	// the mapping keeps the file open, so the descriptor can be closed either way
+	if(!fstat(file, &info) && info.st_size)
+	{
+		void * data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(data != MAP_FAILED)
+		{
+			m_data = (const u8 *)data;
+			m_len = info.st_size;
+			m_offset = 0;
+			result = true;
+		}
+	}
+
+	::close(file);
+
+	return result;
+}
+
+bool MappedStream::open(const wchar_t * path)
+{
+	char narrowPath[4096];
+
+	if(wcstombs(narrowPath, path, sizeof(narrowPath)) >= sizeof(narrowPath))
+		return false;
+
+	return open(narrowPath);
+}
+
+void MappedStream::close()
+{
+	if(m_data)
+	{
+		munmap((void *)m_data, m_len);
+		m_data = nullptr;
+	}
+
+	m_len = 0;
+	m_offset = 0;
+}
+
+#endif
+
+u64 MappedStream::seek(u64 offset)
+{
+	m_offset = offset;
+
+	return offset;
+}
+
+u64 MappedStream::read(void * dst, u64 len)
+{
+	u64 avail = remain();
+	if(len > avail)
+		len = avail;
+
+	memcpy(dst, m_data + m_offset, len);
+	m_offset += len;
+
+	return len;
+}
+
+u64 MappedStream::write(const void *, u64)
+{
+	// read only
+	return 0;
+}
+
+#ifdef _WIN32
+
+bool MappedStream::internalSetup(void * file)
+{
+	LARGE_INTEGER size;
+	bool result = false;
+
+	// the mapping keeps the file open, so the file handle can be closed either way
+	if(GetFileSizeEx(file, &size) && size.QuadPart)
+	{
+		m_mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(m_mapping)
+		{
+			m_data = (const u8 *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+			if(m_data)
+			{
+				m_len = size.QuadPart;
+				m_offset = 0;
+				result = true;
+			}
+			else
+			{
+				CloseHandle(m_mapping);
+				m_mapping = nullptr;
+			}
+		}
+	}
+
+	CloseHandle(file);
+
+	return result;
+}
+
+#endif
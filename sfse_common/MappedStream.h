@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sfse_common/DataStream.h"
+
+// read-only DataStream over a memory-mapped file
+//
+// data() exposes the mapping directly, so callers that parse from several threads can index it without
+// going through the (single cursor) stream interface.
+
+class MappedStream : public DataStream
+{
+public:
+	MappedStream();
+	virtual ~MappedStream();
+
+	bool open(const char * path);
+	bool open(const wchar_t * path);
+	void close();
+
+	const u8 * data() const { return m_data; }
+
+	// DataStream interface
+	virtual u64 seek(u64 offset);
+
+	virtual u64 read(void * dst, u64 len);
+	virtual u64 write(const void * src, u64 len);
+
+protected:
+	bool internalSetup(void * file);
+
+	const u8	* m_data;
+	void		* m_mapping;
+};
@@ -0,0 +1,495 @@
+#include "Metrics.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum
+{
+	kMaxMetrics = 512,			// including the unused ID 0
+	kMaxHistograms = 128,
+
+	kSubBucketBits = 4,
+	kSubBuckets = 1 << kSubBucketBits,
+	kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets,
+};
+
+struct MetricInfo
+{
+	const char	* name;
+	u32			type;
+	u32			slot;	// histogram index
+};
+
+struct HistogramData
+{
+	std::atomic <u64>	count;
+	std::atomic <u64>	sum;
+	std::atomic <u64>	min;
+	std::atomic <u64>	max;
+	std::atomic <u64>	buckets[kNumBuckets];
+
+	HistogramData() { clear(); }
+
+	void	clear();
+};
+
+// written only by the owning thread, read by snapshots
+struct MetricsShard
+{
+	std::atomic <u64>				counters[kMaxMetrics];
+	std::atomic <HistogramData *>	histograms[kMaxHistograms];
+
+	MetricsShard();
+	~MetricsShard();
+};
+
+static std::mutex						s_lock;		// registration, shard list, retired totals
+static MetricInfo						s_metrics[kMaxMetrics];
+static std::atomic <u32>				s_numMetrics(1);
+static u32								s_numHistograms = 0;
+static std::unordered_map <std::string, u32>	s_lookup;
+
+static std::atomic <s64>				s_gauges[kMaxMetrics];
+
+static std::vector <MetricsShard *>		s_shards;
+static u64								s_retiredCounters[kMaxMetrics];
+static HistogramData					* s_retiredHistograms[kMaxHistograms];
+
+void HistogramData::clear()
+{
+	count.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+	min.store(~0ull, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+
+	for(auto & bucket : buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+MetricsShard::MetricsShard()
+{
+	for(auto & counter : counters)
+		counter = 0;
+
+	for(auto & histogram : histograms)
+		histogram = nullptr;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+	s_shards.push_back(this);
+}
+
+static void AddHistogram(HistogramData & dst, const HistogramData & src)
+{
+	u64 count = src.count.load(std::memory_order_relaxed);
+	if(!count)
+		return;
+
+	dst.count.store(dst.count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	dst.sum.store(dst.sum.load(std::memory_order_relaxed) + src.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	dst.min.store(std::min(dst.min.load(std::memory_order_relaxed), src.min.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+	dst.max.store(std::max(dst.max.load(std::memory_order_relaxed), src.max.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+
+	for(u32 i = 0; i < kNumBuckets; i++)
+	{
+		u64 bucket = src.buckets[i].load(std::memory_order_relaxed);
+		if(bucket)
+			dst.buckets[i].store(dst.buckets[i].load(std::memory_order_relaxed) + bucket, std::memory_order_relaxed);
+	}
+}
+
+MetricsShard::~MetricsShard()
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	for(u32 i = 0; i < kMaxMetrics; i++)
+		s_retiredCounters[i] += counters[i].load(std::memory_order_relaxed);
+
+	for(u32 i = 0; i < kMaxHistograms; i++)
+	{
+		HistogramData * histogram = histograms[i].load(std::memory_order_relaxed);
+		if(!histogram)
+			continue;
+
+		if(!s_retiredHistograms[i])
+			s_retiredHistograms[i] = new HistogramData;
+
+		AddHistogram(*s_retiredHistograms[i], *histogram);
+
+		delete histogram;
+	}
+
+	for(auto iter = s_shards.begin(); iter != s_shards.end(); ++iter)
+	{
+		if(*iter == this)
+		{
+			s_shards.erase(iter);
+			break;
+		}
+	}
+}
+
+static MetricsShard & GetShard()
+{
+	static thread_local MetricsShard s_shard;
+
+	return s_shard;
+}
+
+// single writer, so no interlocked ops needed
+static inline void Bump(std::atomic <u64> & counter, u64 amount)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static inline bool IsType(u32 id, u32 type)
+{
+	return (id < s_numMetrics.load(std::memory_order_acquire)) && (s_metrics[id].type == type);
+}
+
+static inline u32 GetBucket(u64 value)
+{
+	if(value < kSubBuckets)
+		return u32(value);
+
+#ifdef _MSC_VER
+	unsigned long msb;
+	_BitScanReverse64(&msb, value);
+#else
+	u32 msb = 63 - __builtin_clzll(value);
+#endif
+
+	u32 shift = msb - kSubBucketBits;
+
+	return ((shift + 1) << kSubBucketBits) + u32((value >> shift) & (kSubBuckets - 1));
+}
+
+// highest value that lands in the bucket
+static u64 GetBucketLimit(u32 bucket)
+{
+	if(bucket < kSubBuckets)
+		return bucket;
+
+	u32 shift = (bucket >> kSubBucketBits) - 1;
+	u64 sub = bucket & (kSubBuckets - 1);
+	u64 lower = (kSubBuckets + sub) << shift;
+
+	return lower + ((1ull << shift) - 1);
+}
+
+u32 Metrics_Register(const char * name, u32 type)
+{
+	if(!name || !*name || (type > kMetricType_Histogram))
+		return 0;
+
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	auto iter = s_lookup.find(name);
+	if(iter != s_lookup.end())
+		return (s_metrics[iter->second].type == type) ? iter->second : 0;
+
+	u32 id = s_numMetrics.load(std::memory_order_relaxed);
+	if(id >= kMaxMetrics)
+		return 0;
+
+	if(type == kMetricType_Histogram)
+	{
+		if(s_numHistograms >= kMaxHistograms)
+			return 0;
+
+		s_metrics[id].slot = s_numHistograms++;
+	}
+
+	// never freed, snapshots hand the pointer out
+	size_t len = strlen(name);
+	char * nameCopy = new char[len + 1];
+	memcpy(nameCopy, name, len + 1);
+
+	s_metrics[id].name = nameCopy;
+	s_metrics[id].type = type;
+	s_gauges[id] = 0;
+
+	s_lookup[name] = id;
+
+	// publish last, recorders check the ID against this
+	s_numMetrics.store(id + 1, std::memory_order_release);
+
+	return id;
+}
+
+u32 Metrics_Find(const char * name)
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	auto iter = s_lookup.find(name);
+
+	return (iter != s_lookup.end()) ? iter->second : 0;
+}
+
+void Metrics_Add(u32 id, u64 amount)
+{
+	if(IsType(id, kMetricType_Counter))
+		Bump(GetShard().counters[id], amount);
+}
+
+void Metrics_SetGauge(u32 id, s64 value)
+{
+	if(IsType(id, kMetricType_Gauge))
+		s_gauges[id].store(value, std::memory_order_relaxed);
+}
+
+void Metrics_AddGauge(u32 id, s64 delta)
+{
+	if(IsType(id, kMetricType_Gauge))
+		s_gauges[id].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void Metrics_Record(u32 id, u64 value)
+{
+	if(!IsType(id, kMetricType_Histogram))
+		return;
+
+	MetricsShard & shard = GetShard();
+	u32 slot = s_metrics[id].slot;
+
+	HistogramData * histogram = shard.histograms[slot].load(std::memory_order_relaxed);
+	if(!histogram)
+	{
+		// only this thread's first record of this histogram gets here
+		histogram = new HistogramData;
+		shard.histograms[slot].store(histogram, std::memory_order_release);
+	}
+
+	Bump(histogram->count, 1);
+	Bump(histogram->sum, value);
+
+	if(value < histogram->min.load(std::memory_order_relaxed))
+		histogram->min.store(value, std::memory_order_relaxed);
+	if(value > histogram->max.load(std::memory_order_relaxed))
+		histogram->max.store(value, std::memory_order_relaxed);
+
+	Bump(histogram->buckets[GetBucket(value)], 1);
+}
+
+static u64 GetPercentile(const HistogramData & histogram, u64 count, f64 fraction)
+{
+	u64 rank = u64(f64(count) * fraction + 0.5);
+	if(!rank)
+		rank = 1;
+
+	u64 seen = 0;
+
+	for(u32 i = 0; i < kNumBuckets; i++)
+	{
+		seen += histogram.buckets[i].load(std::memory_order_relaxed);
+
+		if(seen >= rank)
+			return std::min(GetBucketLimit(i), histogram.max.load(std::memory_order_relaxed));
+	}
+
+	return histogram.max.load(std::memory_order_relaxed);
+}
+
+u32 Metrics_Snapshot(MetricsSnapshot * out, u32 maxOut)
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	u32 numMetrics = s_numMetrics.load(std::memory_order_relaxed);
+	u32 total = numMetrics - 1;
+
+	if(!maxOut || !out)
+		return total;
+
+	HistogramData * merged = nullptr;
+
+	for(u32 id = 1; (id < numMetrics) && (id - 1 < maxOut); id++)
+	{
+		const MetricInfo & info = s_metrics[id];
+		MetricsSnapshot & dst = out[id - 1];
+
+		memset(&dst, 0, sizeof(dst));
+		dst.name = info.name;
+		dst.type = info.type;
+
+		switch(info.type)
+		{
+			case kMetricType_Counter:
+			{
+				dst.count = s_retiredCounters[id];
+
+				for(auto * shard : s_shards)
+					dst.count += shard->counters[id].load(std::memory_order_relaxed);
+			}
+			break;
+
+			case kMetricType_Gauge:
+				dst.value = s_gauges[id].load(std::memory_order_relaxed);
+				break;
+
+			case kMetricType_Histogram:
+			{
+				// HistogramData is too big for the stack, reuse one scratch copy
+				if(!merged)
+					merged = new HistogramData;
+				else
+					merged->clear();
+
+				if(s_retiredHistograms[info.slot])
+					AddHistogram(*merged, *s_retiredHistograms[info.slot]);
+
+				for(auto * shard : s_shards)
+				{
+					HistogramData * histogram = shard->histograms[info.slot].load(std::memory_order_acquire);
+					if(histogram)
+						AddHistogram(*merged, *histogram);
+				}
+
+				dst.count = merged->count.load(std::memory_order_relaxed);
+
+				if(dst.count)
+				{
+					dst.sum = merged->sum.load(std::memory_order_relaxed);
+					dst.min = merged->min.load(std::memory_order_relaxed);
+					dst.max = merged->max.load(std::memory_order_relaxed);
+					dst.p50 = GetPercentile(*merged, dst.count, 0.5);
+					dst.p90 = GetPercentile(*merged, dst.count, 0.9);
+					dst.p99 = GetPercentile(*merged, dst.count, 0.99);
+					dst.p999 = GetPercentile(*merged, dst.count, 0.999);
+				}
+			}
+			break;
+		}
+	}
+
+	delete merged;
+
+	return total;
+}
+
+void Metrics_Report(Metrics_PrintFn print)
+{
+	std::vector <MetricsSnapshot> snapshots(Metrics_Snapshot(nullptr, 0));
+
+	// metrics registered in between are picked up next time
+	u32 count = std::min(Metrics_Snapshot(snapshots.data(), u32(snapshots.size())), u32(snapshots.size()));
+
+	print("metrics: %d registered", count);
+
+	for(u32 i = 0; i < count; i++)
+	{
+		const MetricsSnapshot & metric = snapshots[i];
+
+		switch(metric.type)
+		{
+			case kMetricType_Counter:
+				print("%s: %llu", metric.name, metric.count);
+				break;
+
+			case kMetricType_Gauge:
+				print("%s: %lld", metric.name, metric.value);
+				break;
+
+			case kMetricType_Histogram:
+				if(metric.count)
+					print("%s: %llu samples, mean %.1f, min %llu, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu",
+						metric.name, metric.count, f64(metric.sum) / metric.count,
+						metric.min, metric.p50, metric.p90, metric.p99, metric.p999, metric.max);
+				else
+					print("%s: no samples", metric.name);
+				break;
+		}
+	}
+}
+
+void Metrics_Reset()
+{
+	std::lock_guard <std::mutex> locker(s_lock);
+
+	for(auto & counter : s_retiredCounters)
+		counter = 0;
+
+	for(auto & histogram : s_retiredHistograms)
+	{
+		delete histogram;
+		histogram = nullptr;
+	}
+
+	// owners may be mid-update, a sample or two can survive the reset
+	for(auto * shard : s_shards)
+	{
+		for(auto & counter : shard->counters)
+			counter.store(0, std::memory_order_relaxed);
+
+		for(auto & slot : shard->histograms)
+		{
+			HistogramData * histogram = slot.load(std::memory_order_relaxed);
+			if(histogram)
+				histogram->clear();
+		}
+	}
+}
+
+// never destroyed, the reporting thread is detached and may outlive static destructors
+struct MetricsReporter
+{
+	std::mutex				lock;
+	std::condition_variable	wake;
+	u32						generation = 0;		// bumped to retire the running thread
+};
+
+static MetricsReporter & GetReporter()
+{
+	static MetricsReporter * reporter = new MetricsReporter;
+	return *reporter;
+}
+
+void Metrics_StartReporting(u32 seconds, Metrics_PrintFn print, Metrics_ReportFn extra)
+{
+	Metrics_StopReporting();
+
+	if(!seconds || !print)
+		return;
+
+	MetricsReporter & reporter = GetReporter();
+	u32 generation;
+
+	{
+		std::lock_guard <std::mutex> locker(reporter.lock);
+		generation = reporter.generation;
+	}
+
+	std::thread([&reporter, generation, seconds, print, extra]()
+	{
+		ThreadPolicy_ApplyToCurrentThread();
+
+		std::unique_lock <std::mutex> locker(reporter.lock);
+
+		while(!reporter.wake.wait_for(locker, std::chrono::seconds(seconds), [&]() { return reporter.generation != generation; }))
+		{
+			locker.unlock();
+			Metrics_Report(print);
+			if(extra)
+				extra(print);
+			locker.lock();
+		}
+	}).detach();
+}
+
+void Metrics_StopReporting()
+{
+	MetricsReporter & reporter = GetReporter();
+
+	{
+		std::lock_guard <std::mutex> locker(reporter.lock);
+		reporter.generation++;
+	}
+
+	reporter.wake.notify_all();
+}
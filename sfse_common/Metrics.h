@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+// process-wide registry of named counters, gauges and latency histograms
+//
+// counters and histograms are recorded in per-thread shards: the owning thread is the only writer, so a
+// record is a few plain stores with no interlocked ops and nothing shared between threads. shards are only
+// summed when a snapshot or report is taken, and a thread's totals are folded in to a retired set when it exits.
+// gauges are levels rather than sums, so they're a single shared value.
+//
+// histograms are log-linear (HDR style): values below 16 get their own bucket, above that each power of two is
+// split in to 16 buckets, so any value is reported within 1/16 of its magnitude. the first record of a
+// histogram on a thread allocates that thread's buckets, every record after that is allocation-free.
+//
+// IDs are stable for the life of the process, 0 is never a valid ID.
+
+enum
+{
+	kMetricType_Counter = 0,
+	kMetricType_Gauge,
+	kMetricType_Histogram,
+};
+
+// returns the existing ID if the name is already registered with the same type, 0 if it's registered with a
+// different type or the registry is full. the name is copied
+u32 Metrics_Register(const char * name, u32 type);
+u32 Metrics_Find(const char * name);
+
+void Metrics_Add(u32 id, u64 amount = 1);
+void Metrics_SetGauge(u32 id, s64 value);
+void Metrics_AddGauge(u32 id, s64 delta);
+void Metrics_Record(u32 id, u64 value);
+
+struct MetricsSnapshot
+{
+	const char	* name;
+	u32			type;
+	u64			count;		// counter total or histogram samples
+	s64			value;		// gauge
+	u64			sum;		// histogram fields from here on
+	u64			min;
+	u64			max;
+	u64			p50;
+	u64			p90;
+	u64			p99;
+	u64			p999;
+};
+
+// copies up to maxOut metrics in ID order and returns the total, so maxOut = 0 sizes the buffer
+u32 Metrics_Snapshot(MetricsSnapshot * out, u32 maxOut);
+
+typedef void (* Metrics_PrintFn)(const char * fmt, ...);
+void Metrics_Report(Metrics_PrintFn print);
+void Metrics_Reset();		// counters and histograms, gauges keep their level
+
+// run after each periodic report with the same print function, for statistics that aren't metrics
+typedef void (* Metrics_ReportFn)(Metrics_PrintFn print);
+
+// reports every interval from a background thread until stopped
+void Metrics_StartReporting(u32 seconds, Metrics_PrintFn print, Metrics_ReportFn extra = nullptr);
+void Metrics_StopReporting();
@@ -0,0 +1,280 @@
+#pragma once
+
+// the parts of the Win32 API that the portable pieces of sfse_common lean on
+//
+// on Windows this is just Windows.h. elsewhere it supplies the CRT string helpers and the PE image layouts, so
+// streams, logging, the trampoline allocator and the PE helpers in Utilities.cpp can be built and measured with
+// GCC or Clang. page allocation is wrapped at the bottom for SlabHeap. anything else that actually needs the OS
+// (module handles, the registry) stays behind #ifdef _WIN32 in the file that uses it.
+
+#include "sfse_common/Types.h"
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#else
+
+#include <cerrno>
+#include <strings.h>
+#include <sys/mman.h>
+
+#define MAX_PATH	260
+
+inline int _stricmp(const char * lhs, const char * rhs)
+{
+	return strcasecmp(lhs, rhs);
+}
+
+inline int _strnicmp(const char * lhs, const char * rhs, size_t len)
+{
+	return strncasecmp(lhs, rhs, len);
+}
+
+// PE32+ image layouts, field names as in winnt.h
+
+enum
+{
+	IMAGE_DIRECTORY_ENTRY_EXPORT = 0,
+	IMAGE_DIRECTORY_ENTRY_IMPORT = 1,
+	IMAGE_NUMBEROF_DIRECTORY_ENTRIES = 16,
+
+	IMAGE_FILE_MACHINE_I386 = 0x014C,
+	IMAGE_FILE_MACHINE_AMD64 = 0x8664,
+};
+
+#define IMAGE_DOS_SIGNATURE			0x5A4D		// MZ
+#define IMAGE_NT_SIGNATURE			0x00004550	// PE00
+#define IMAGE_ORDINAL_FLAG64		0x8000000000000000ull
+#define IMAGE_SNAP_BY_ORDINAL(a)	(((a) & IMAGE_ORDINAL_FLAG64) != 0)
+
+struct IMAGE_DOS_HEADER
+{
+	u16	e_magic;
+	u16	e_cblp;
+	u16	e_cp;
+	u16	e_crlc;
+	u16	e_cparhdr;
+	u16	e_minalloc;
+	u16	e_maxalloc;
+	u16	e_ss;
+	u16	e_sp;
+	u16	e_csum;
+	u16	e_ip;
+	u16	e_cs;
+	u16	e_lfarlc;
+	u16	e_ovno;
+	u16	e_res[4];
+	u16	e_oemid;
+	u16	e_oeminfo;
+	u16	e_res2[10];
+	s32	e_lfanew;
+};
+static_assert(sizeof(IMAGE_DOS_HEADER) == 0x40, "IMAGE_DOS_HEADER");
+
+struct IMAGE_FILE_HEADER
+{
+	u16	Machine;
+	u16	NumberOfSections;
+	u32	TimeDateStamp;
+	u32	PointerToSymbolTable;
+	u32	NumberOfSymbols;
+	u16	SizeOfOptionalHeader;
+	u16	Characteristics;
+};
+static_assert(sizeof(IMAGE_FILE_HEADER) == 0x14, "IMAGE_FILE_HEADER");
+
+struct IMAGE_DATA_DIRECTORY
+{
+	u32	VirtualAddress;
+	u32	Size;
+};
+
+struct IMAGE_OPTIONAL_HEADER64
+{
+	u16	Magic;
+	u8	MajorLinkerVersion;
+	u8	MinorLinkerVersion;
+	u32	SizeOfCode;
+	u32	SizeOfInitializedData;
+	u32	SizeOfUninitializedData;
+	u32	AddressOfEntryPoint;
+	u32	BaseOfCode;
+	u64	ImageBase;
+	u32	SectionAlignment;
+	u32	FileAlignment;
+	u16	MajorOperatingSystemVersion;
+	u16	MinorOperatingSystemVersion;
+	u16	MajorImageVersion;
+	u16	MinorImageVersion;
+	u16	MajorSubsystemVersion;
+	u16	MinorSubsystemVersion;
+	u32	Win32VersionValue;
+	u32	SizeOfImage;
+	u32	SizeOfHeaders;
+	u32	CheckSum;
+	u16	Subsystem;
+	u16	DllCharacteristics;
+	u64	SizeOfStackReserve;
+	u64	SizeOfStackCommit;
+	u64	SizeOfHeapReserve;
+	u64	SizeOfHeapCommit;
+	u32	LoaderFlags;
+	u32	NumberOfRvaAndSizes;
+	IMAGE_DATA_DIRECTORY	DataDirectory[IMAGE_NUMBEROF_DIRECTORY_ENTRIES];
+};
+static_assert(sizeof(IMAGE_OPTIONAL_HEADER64) == 0xF0, "IMAGE_OPTIONAL_HEADER64");
+
+struct IMAGE_NT_HEADERS64
+{
+	u32						Signature;
+	IMAGE_FILE_HEADER		FileHeader;
+	IMAGE_OPTIONAL_HEADER64	OptionalHeader;
+};
+
+typedef IMAGE_NT_HEADERS64	IMAGE_NT_HEADERS;
+
+struct IMAGE_EXPORT_DIRECTORY
+{
+	u32	Characteristics;
+	u32	TimeDateStamp;
+	u16	MajorVersion;
+	u16	MinorVersion;
+	u32	Name;
+	u32	Base;
+	u32	NumberOfFunctions;
+	u32	NumberOfNames;
+	u32	AddressOfFunctions;		// RVA
+	u32	AddressOfNames;			// RVA
+	u32	AddressOfNameOrdinals;	// RVA
+};
+static_assert(sizeof(IMAGE_EXPORT_DIRECTORY) == 0x28, "IMAGE_EXPORT_DIRECTORY");
+
+struct IMAGE_IMPORT_DESCRIPTOR
+{
+	union
+	{
+		u32	Characteristics;
+		u32	OriginalFirstThunk;	// RVA
+	};
+	u32	TimeDateStamp;
+	u32	ForwarderChain;
+	u32	Name;
+	u32	FirstThunk;				// RVA
+};
+static_assert(sizeof(IMAGE_IMPORT_DESCRIPTOR) == 0x14, "IMAGE_IMPORT_DESCRIPTOR");
+
+struct IMAGE_THUNK_DATA64
+{
+	union
+	{
+		u64	ForwarderString;
+		u64	Function;
+		u64	Ordinal;
+		u64	AddressOfData;		// RVA of an IMAGE_IMPORT_BY_NAME
+	} u1;
+};
+
+typedef IMAGE_THUNK_DATA64	IMAGE_THUNK_DATA;
+
+struct IMAGE_IMPORT_BY_NAME
+{
+	u16		Hint;
+	char	Name[1];
+};
+
+#endif
+
+// page allocation
+//
+// ranges are aligned to kPlatform_PageGranularity on every OS, same as VirtualAlloc, so code that masks a pointer
+// to find its block header works the same everywhere. reserved pages have to be committed before they're used.
+
+enum
+{
+	kPlatform_PageGranularity = 64 * 1024,
+};
+
+#ifdef _WIN32
+
+inline void * Platform_ReservePages(u64 size)
+{
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+inline void * Platform_AllocPages(u64 size)
+{
+	return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+inline bool Platform_CommitPages(void * addr, u64 size)
+{
+	return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+// size must match the reserve or alloc, only POSIX needs it
+inline void Platform_FreePages(void * addr, u64 size)
+{
+	(void)size;
+
+	VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+inline u32 Platform_GetLastError()
+{
+	return GetLastError();
+}
+
+#else
+
+// mmap is only page aligned, so over-map and trim to the granularity
+inline void * Platform_MapAligned(u64 size, int prot)
+{
+	size = (size + kPlatform_PageGranularity - 1) & ~u64(kPlatform_PageGranularity - 1);
+
+	u64 mapSize = size + kPlatform_PageGranularity;
+
+	void * mapping = mmap(nullptr, mapSize, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(mapping == MAP_FAILED)
+		return nullptr;
+
+	uintptr_t start = uintptr_t(mapping);
+	uintptr_t aligned = (start + kPlatform_PageGranularity - 1) & ~uintptr_t(kPlatform_PageGranularity - 1);
+	uintptr_t end = start + mapSize;
+
+	if(aligned > start)
+		munmap(mapping, aligned - start);
+	if(end > aligned + size)
+		munmap((void *)(aligned + size), end - (aligned + size));
+
+	return (void *)aligned;
+}
+
+inline void * Platform_ReservePages(u64 size)
+{
+	return Platform_MapAligned(size, PROT_NONE);
+}
+
+inline void * Platform_AllocPages(u64 size)
+{
+	return Platform_MapAligned(size, PROT_READ | PROT_WRITE);
+}
+
+inline bool Platform_CommitPages(void * addr, u64 size)
+{
+	return !mprotect(addr, size, PROT_READ | PROT_WRITE);
+}
+
+inline void Platform_FreePages(void * addr, u64 size)
+{
+	size = (size + kPlatform_PageGranularity - 1) & ~u64(kPlatform_PageGranularity - 1);
+
+	munmap(addr, size);
+}
+
+inline u32 Platform_GetLastError()
+{
+	return errno;
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include "PluginFileIndex.h"
+#include "ThreadPolicy.h"
+#include "Inflate.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// record and group headers are both 24 bytes
+//
+// record: type, dataSize, flags, formID, vcs, version, unk
+// group: 'GRUP', groupSize (including header), label, groupType, vcs, version, unk
+
+enum
+{
+	kHeaderSize = 24,
+	kEditorIDPrefix = 1024,		// decompressed bytes to scan for the EDID of a compressed record
+};
+
+static inline u32 MakeType(const char * type)
+{
+	return u32(u8(type[0])) | (u32(u8(type[1])) << 8) | (u32(u8(type[2])) << 16) | (u32(u8(type[3])) << 24);
+}
+
+static const u32 kType_TES4 = MakeType("TES4");
+static const u32 kType_GRUP = MakeType("GRUP");
+static const u32 kType_EDID = MakeType("EDID");
+static const u32 kType_MAST = MakeType("MAST");
+static const u32 kType_XXXX = MakeType("XXXX");
+
+static inline u32 Read32(const u8 * data)
+{
+	u32 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+static inline u16 Read16(const u8 * data)
+{
+	u16 result;
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+struct PluginFileIndex::ScanResult
+{
+	std::vector <Record>	records;
+	std::vector <std::pair <u32, std::string>>	editorIDs;
+	bool	error = false;
+	u64		errorOffset = 0;
+};
+
+PluginFileIndex::PluginFileIndex()
+	:m_fileFlags(0), m_error(kError_None), m_errorOffset(0)
+{
+	//
+}
+
+PluginFileIndex::~PluginFileIndex()
+{
+	close();
+}
+
+bool PluginFileIndex::open(const char * path, u32 numThreads)
+{
+	close();
+
+	if(!m_file.open(path))
+		return fail(kError_Open, 0);
+
+	u64 pos;
+	if(!readHeader(&pos))
+		return fail(kError_Header, 0);
+
+	// top-level groups are found by hopping over them, only their contents are scanned in parallel
+	std::vector <std::pair <u64, u64>> groups;
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	// anything after the last group that's too short to be one is trailing junk, the game ignores it too
+	while(pos + kHeaderSize <= len)
+	{
+		u32 groupSize = Read32(data + pos + 4);
+		if((Read32(data + pos) != kType_GRUP) || (groupSize < kHeaderSize) || (groupSize > len - pos))
+			return fail(kError_Group, pos);
+
+		groups.emplace_back(pos + kHeaderSize, pos + groupSize);
+		pos += groupSize;
+	}
+
+	if(!numThreads)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	return scanGroups(groups, numThreads);
+}
+
+void PluginFileIndex::close()
+{
+	m_file.close();
+	m_records.clear();
+	m_editorIDs.clear();
+	m_masters.clear();
+	m_fileFlags = 0;
+	m_error = kError_None;
+	m_errorOffset = 0;
+}
+
+const char * PluginFileIndex::getErrorName(u32 error)
+{
+	switch(error)
+	{
+		case kError_None:	return "none";
+		case kError_Open:	return "couldn't open file";
+		case kError_Header:	return "bad file header";
+		case kError_Group:	return "bad group";
+		case kError_Record:	return "record past end of group";
+	}
+
+	return "unknown";
+}
+
+bool PluginFileIndex::fail(u32 error, u64 offset)
+{
+	close();
+
+	m_error = error;
+	m_errorOffset = offset;
+
+	return false;
+}
+
+const PluginFileIndex::Record * PluginFileIndex::getRecord(u32 formID) const
+{
+	auto iter = std::lower_bound(m_records.begin(), m_records.end(), formID,
+		[](const Record & lhs, u32 rhs) { return lhs.formID < rhs; });
+
+	return (iter != m_records.end() && iter->formID == formID) ? &*iter : nullptr;
+}
+
+const PluginFileIndex::Record * PluginFileIndex::lookupEditorID(const char * editorID) const
+{
+	u32 formID = m_editorIDs.lookup(editorID);
+
+	return formID ? getRecord(formID) : nullptr;
+}
+
+const char * PluginFileIndex::getEditorID(u32 formID) const
+{
+	return m_editorIDs.getEditorID(formID);
+}
+
+bool PluginFileIndex::getRecordData(const Record & record, std::vector <u8> * out) const
+{
+	const u8 * data = m_file.data() + record.offset + kHeaderSize;
+
+	if(!(record.flags & kRecordFlag_Compressed))
+	{
+		out->assign(data, data + record.dataSize);
+		return true;
+	}
+
+	if(record.dataSize < 4)
+		return false;
+
+	u32 decompressedSize = Read32(data);
+	size_t written;
+
+	out->resize(decompressedSize);
+
+	return Inflate(data + 4, record.dataSize - 4, out->data(), decompressedSize, &written) && (written == decompressedSize);
+}
+
+bool PluginFileIndex::readHeader(u64 * firstGroup)
+{
+	const u8 * data = m_file.data();
+	u64 len = m_file.length();
+
+	if((len < kHeaderSize) || (Read32(data) != kType_TES4))
+		return false;
+
+	u32 dataSize = Read32(data + 4);
+	if(kHeaderSize + u64(dataSize) > len)
+		return false;
+
+	m_fileFlags = Read32(data + 8);
+
+	// masters are listed as MAST/DATA pairs
+	const u8 * sub = data + kHeaderSize;
+	const u8 * end = sub + dataSize;
+
+	while(sub + 6 <= end)
+	{
+		u32 type = Read32(sub);
+		u32 size = Read16(sub + 4);
+
+		if(sub + 6 + size > end)
+			return false;
+
+		if(type == kType_MAST)
+			m_masters.emplace_back((const char *)sub + 6, strnlen((const char *)sub + 6, size));
+
+		sub += 6 + size;
+	}
+
+	*firstGroup = kHeaderSize + dataSize;
+
+	return true;
+}
+
+bool PluginFileIndex::scanGroups(const std::vector <std::pair <u64, u64>> & groups, u32 numThreads)
+{
+	// biggest groups first so one large group doesn't end up last on a single thread
+	std::vector <u32> order(groups.size());
+	for(u32 i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) {
+		return (groups[lhs].second - groups[lhs].first) > (groups[rhs].second - groups[rhs].first);
+	});
+
+	std::vector <ScanResult> results(groups.size());
+	std::atomic <u32> next(0);
+
+	auto worker = [&]()
+	{
+		u32 idx;
+		while((idx = next++) < order.size())
+		{
+			const std::pair <u64, u64> & group = groups[order[idx]];
+			scanRange(group.first, group.second, &results[order[idx]]);
+		}
+	};
+
+	numThreads = std::min(numThreads, u32(groups.size()));
+
+	std::vector <std::thread> threads;
+	for(u32 i = 1; i < numThreads; i++)
+		threads.emplace_back([&]() { ThreadPolicy_ApplyToCurrentThread(); worker(); });
+
+	worker();
+
+	for(auto & thread : threads)
+		thread.join();
+
+	// the earliest damage in the file, as a sequential scan would have found it
+	for(auto & result : results)
+		if(result.error)
+			return fail(kError_Record, result.errorOffset);
+
+	// merge in file order
+	size_t numRecords = 0;
+	size_t numEditorIDs = 0;
+
+	for(auto & result : results)
+	{
+		numRecords += result.records.size();
+		numEditorIDs += result.editorIDs.size();
+	}
+
+	m_records.reserve(numRecords);
+	m_editorIDs.reserve(u32(numEditorIDs));
+
+	for(auto & result : results)
+	{
+		m_records.insert(m_records.end(), result.records.begin(), result.records.end());
+
+		for(auto & editorID : result.editorIDs)
+			m_editorIDs.add(editorID.first, editorID.second.c_str());
+	}
+
+	// stable so the first of any duplicated form ID wins, matching file order
+	std::stable_sort(m_records.begin(), m_records.end(), [](const Record & lhs, const Record & rhs) {
+		return lhs.formID < rhs.formID;
+	});
+
+	return true;
+}
+
+void PluginFileIndex::scanRange(u64 start, u64 end, ScanResult * result) const
+{
+	const u8 * data = m_file.data();
+	u64 pos = start;
+	std::string editorID;
+
+	while(pos + kHeaderSize <= end)
+	{
+		const u8 * header = data + pos;
+		u32 type = Read32(header);
+
+		// nested group contents follow their header directly
+		if(type == kType_GRUP)
+		{
+			pos += kHeaderSize;
+			continue;
+		}
+
+		Record record;
+		record.type = type;
+		record.dataSize = Read32(header + 4);
+		record.flags = Read32(header + 8);
+		record.formID = Read32(header + 12);
+		record.offset = pos;
+
+		if(record.dataSize > end - pos - kHeaderSize)
+		{
+			result->error = true;
+			result->errorOffset = pos;
+			break;
+		}
+
+		result->records.push_back(record);
+
+		if(readEditorID(header + kHeaderSize, record.dataSize, (record.flags & kRecordFlag_Compressed) != 0, &editorID))
+			result->editorIDs.emplace_back(record.formID, editorID);
+
+		pos += kHeaderSize + record.dataSize;
+	}
+}
+
+bool PluginFileIndex::readEditorID(const u8 * data, u32 dataSize, bool compressed, std::string * out) const
+{
+	u8 prefix[kEditorIDPrefix];
+
+	if(compressed)
+	{
+		if(dataSize < 4)
+			return false;
+
+		size_t written;
+		Inflate(data + 4, dataSize - 4, prefix, sizeof(prefix), &written);
+
+		data = prefix;
+		dataSize = u32(written);
+	}
+
+	// EDID comes first when a record has one
+	if(dataSize < 6)
+		return false;
+
+	u32 type = Read32(data);
+	u32 size = Read16(data + 4);
+	u32 pos = 6;
+
+	if(type == kType_XXXX)
+	{
+		if((size != 4) || (dataSize < 16))
+			return false;
+
+		size = Read32(data + 6);
+		type = Read32(data + 10);
+		pos = 16;
+	}
+
+	if((type != kType_EDID) || !size)
+		return false;
+
+	// a truncated prefix still yields the name as long as the terminator made it in
+	size = std::min(size, dataSize - pos);
+
+	const char * name = (const char *)data + pos;
+	size_t len = strnlen(name, size);
+	if(!len || (len == size && compressed))
+		return false;
+
+	out->assign(name, len);
+
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "sfse_common/MappedStream.h"
+#include "sfse_common/EditorIDMap.h"
+#include <string>
+#include <vector>
+
+// record index over a .esm/.esp/.esl plugin file, usable without the game running
+//
+// the file is memory-mapped and every record header is indexed once, with the top-level groups split across
+// threads. record data stays in the mapping and is only decompressed when asked for. editor IDs come from the
+// leading EDID subrecord, decompressing just the start of compressed records.
+//
+// form IDs are as stored in the file: the high byte indexes the master list, and numMasters() means the file
+// itself. mapping them to load order IDs is up to the caller.
+//
+// a file that's truncated or has a record running past the end of its group fails to open, rather than
+// indexing whatever came before the damage. error() and errorOffset() say what was wrong and where.
+
+class PluginFileIndex
+{
+public:
+	PluginFileIndex();
+	~PluginFileIndex();
+
+	enum
+	{
+		kFileFlag_Master = 0x00000001,		// TES4 record flags
+		kFileFlag_Light = 0x00000100,		// loads in the FE xxx space, form IDs are 12 bits
+
+		kRecordFlag_Compressed = 0x00040000,
+	};
+
+	enum
+	{
+		kError_None = 0,
+		kError_Open,		// couldn't open or map the file
+		kError_Header,		// no TES4 record, or it runs past the end of the file
+		kError_Group,		// a top-level group is malformed or runs past the end of the file
+		kError_Record,		// a record runs past the end of its group
+	};
+
+	struct Record
+	{
+		u32	type;		// four character code, as stored
+		u32	formID;
+		u32	flags;
+		u32	dataSize;	// as stored, compressed records include the 4 byte decompressed size
+		u64	offset;		// of the record header from the start of the file
+	};
+
+	bool	open(const char * path, u32 numThreads = 0);	// 0 = one thread per core
+	void	close();
+
+	u32				error() const { return m_error; }
+	u64				errorOffset() const { return m_errorOffset; }	// of the bad header from the start of the file
+	static const char *	getErrorName(u32 error);
+
+	u32				numRecords() const { return u32(m_records.size()); }
+	const Record *	getRecordByIndex(u32 idx) const { return (idx < m_records.size()) ? &m_records[idx] : nullptr; }	// sorted by form ID
+
+	const Record *	getRecord(u32 formID) const;
+	const Record *	lookupEditorID(const char * editorID) const;
+	const char *	getEditorID(u32 formID) const;
+
+	u32				fileFlags() const { return m_fileFlags; }
+	u32				numMasters() const { return u32(m_masters.size()); }
+	const char *	getMaster(u32 idx) const { return (idx < m_masters.size()) ? m_masters[idx].c_str() : nullptr; }
+
+	// copies out the record's subrecord data, decompressing if needed
+	bool	getRecordData(const Record & record, std::vector <u8> * out) const;
+
+private:
+	struct ScanResult;
+
+	bool	fail(u32 error, u64 offset);
+	bool	readHeader(u64 * firstGroup);
+	bool	scanGroups(const std::vector <std::pair <u64, u64>> & groups, u32 numThreads);
+	void	scanRange(u64 start, u64 end, ScanResult * result) const;
+	bool	readEditorID(const u8 * data, u32 dataSize, bool compressed, std::string * out) const;
+
+	MappedStream			m_file;
+	std::vector <Record>	m_records;
+	EditorIDMap				m_editorIDs;
+	std::vector <std::string>	m_masters;
+	u32						m_fileFlags;
+	u32						m_error;
+	u64						m_errorOffset;
+};
@@ -1,5 +1,10 @@
 #include "Relocation.h"
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+
+#include <vector>
 
 // the goal of this file is to support pointers in to a relocated binary with as little runtime overhead, code bloat, and hassle as possible
 // 
@@ -17,15 +22,78 @@
 // the problem can't be solved further without moving the RelocPtr constructors in to init_seg(lib), which doesn't appear to be possible
 // without forcing all pointers to be defined in a file with init_seg(lib). that is really ugly and doesn't seem like a good idea.
 
+// member function slots (see RelocMemberFn) are handled the same way. they are statically initialized to their offsets
+// and placed between the two markers below by the linker, so rebasing them here means they are valid before any
+// static ctor can call through them. the linker may pad the section with zeroes, those entries are skipped.
+// 
+// off MSVC the slots register themselves during static init instead. there's no image to rebase against there, so
+// they stay at base 0 until a host tool calls Rebase with a stand-in.
+
+#ifdef _MSC_VER
+
 // anything in this file will initialized after the crt but before any user code
 #pragma warning(disable: 4073)	// yes this is intentional
 #pragma init_seg(lib)
 
 static RelocationManager s_relocMgr;
 
+__declspec(allocate(".sfsefn$a")) static uintptr_t s_memberFnTableStart = 0;
+__declspec(allocate(".sfsefn$z")) static uintptr_t s_memberFnTableEnd = 0;
+
+// referenced by Relocation.h so this object is always linked
+extern "C" int SFSE_RelocationManager_Link = 0;
+
+#else
+
+// function-local so it exists before the first slot's initializer runs
+static std::vector <uintptr_t *> & GetMemberFnSlots()
+{
+	static std::vector <uintptr_t *> slots;
+	return slots;
+}
+
+uintptr_t RelocationManager::RegisterMemberFn(uintptr_t * slot, uintptr_t offset)
+{
+	GetMemberFnSlots().push_back(slot);
+
+	return offset + s_baseAddr;
+}
+
+#endif
+
 uintptr_t RelocationManager::s_baseAddr = 0;
 
+#ifdef _MSC_VER
+
+RelocationManager::RelocationManager()
+{
+	Rebase(reinterpret_cast<uintptr_t>(GetModuleHandle(NULL)));
+}
+
+#else
+
+// only host-side tools are built elsewhere, there's no runtime to point at
 RelocationManager::RelocationManager()
 {
-	s_baseAddr = reinterpret_cast<uintptr_t>(GetModuleHandle(NULL));
+	//
+}
+
+#endif
+
+void RelocationManager::Rebase(uintptr_t baseAddr)
+{
+	uintptr_t delta = baseAddr - s_baseAddr;
+
+#ifdef _MSC_VER
+	for(uintptr_t * iter = &s_memberFnTableStart + 1; iter < &s_memberFnTableEnd; ++iter)
+	{
+		if(*iter)
+			*iter += delta;
+	}
+#else
+	for(uintptr_t * slot : GetMemberFnSlots())
+		*slot += delta;
+#endif
+
+	s_baseAddr = baseAddr;
 }
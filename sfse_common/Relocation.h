@@ -7,9 +7,47 @@ class RelocationManager
 public:
 	RelocationManager();
 
+	// moves the member function table from the current base to a new one. the runtime does this once at
+	// startup, host tools use it to point the table at a stand-in image. RelocPtr/RelocAddr objects that were
+	// already constructed keep the old base
+	static void	Rebase(uintptr_t baseAddr);
+
+	// off MSVC, records a slot for Rebase and returns its current address
+	static uintptr_t	RegisterMemberFn(uintptr_t * slot, uintptr_t offset);
+
 	static uintptr_t	s_baseAddr;
 };
 
+// member function address table
+// every RelocMemberFn slot is emitted in to .sfsefn as a raw offset. RelocationManager rebases the whole
+// section in place during init_seg(lib), so call sites are a single indirect call through a constant slot
+// with no per-call store and no static init guard.
+#ifdef _MSC_VER
+#pragma section(".sfsefn$a", read, write)
+#pragma section(".sfsefn$m", read, write)
+#pragma section(".sfsefn$z", read, write)
+
+// nothing in the slots refers to Relocation.obj, so pull it in explicitly or a static lib consumer that doesn't
+// otherwise use RelocationManager never rebases the table and calls through raw offsets
+#pragma comment(linker, "/include:SFSE_RelocationManager_Link")
+#endif
+
+template <uintptr_t offset>
+struct RelocMemberFn
+{
+	static uintptr_t	s_addr;
+};
+
+#ifdef _MSC_VER
+template <uintptr_t offset>
+__declspec(allocate(".sfsefn$m")) uintptr_t RelocMemberFn <offset>::s_addr = offset;
+#else
+// GCC ignores section attributes on template instantiations, so each slot registers itself during static init
+// instead. only host tools are built this way, the extra init entries don't matter there
+template <uintptr_t offset>
+uintptr_t RelocMemberFn <offset>::s_addr = RelocationManager::RegisterMemberFn(&RelocMemberFn <offset>::s_addr, offset);
+#endif
+
 // use this for addresses that represent pointers to a type T
 template <typename T>
 class RelocPtr
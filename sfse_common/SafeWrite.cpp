@@ -1,6 +1,11 @@
 #include "SafeWrite.h"
-#include <Windows.h>
 #include "sfse_common/Errors.h"
+#include <climits>
+#include <cstring>
+
+#ifdef _WIN32
+
+#include <Windows.h>
 
 void safeWriteBuf(uintptr_t addr, void * data, size_t len)
 {
@@ -11,6 +16,25 @@ void safeWriteBuf(uintptr_t addr, void * data, size_t len)
 	VirtualProtect((void *)addr, len, oldProtect, &oldProtect);
 }
 
+#else
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+void safeWriteBuf(uintptr_t addr, void * data, size_t len)
+{
+	// mprotect can't report the old protection, assume code
+	uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = addr & ~(pageSize - 1);
+	size_t protectLen = addr + len - start;
+
+	mprotect((void *)start, protectLen, PROT_READ | PROT_WRITE | PROT_EXEC);
+	memcpy((void *)addr, data, len);
+	mprotect((void *)start, protectLen, PROT_READ | PROT_EXEC);
+}
+
+#endif
+
 void safeWrite8(uintptr_t addr, u8 data)
 {
 	safeWriteBuf(addr, &data, sizeof(data));
@@ -0,0 +1,618 @@
+#include "SlabHeap.h"
+#include "sfse_common/Log.h"
+#include "sfse_common/Errors.h"
+#include "sfse_common/Platform.h"
+#include <cstring>
+
+SlabHeap g_slabHeap;
+
+#ifdef _MSC_VER
+#pragma warning (push)
+#pragma warning (disable : 4200)
+#endif
+// at the base of every slab or large block
+struct SlabBlockHeader
+{
+	u8	classIdx;	// SlabHeap::kLargeClass for large blocks
+	u8	heapIdx;	// heap that allocated the block
+	u16	pad02;
+	u32	owner;		// large blocks only
+	u64	size;		// large blocks only
+	u8	owners[0];	// small slabs, owner of each object
+};
+#ifdef _MSC_VER
+#pragma warning (pop)
+#endif
+
+STATIC_ASSERT(sizeof(SlabBlockHeader) == 16);
+STATIC_ASSERT(u32(SlabHeap::kSlabSize) == u32(kPlatform_PageGranularity));
+
+static inline SlabBlockHeader * GetBlockHeader(const void * ptr)
+{
+	return (SlabBlockHeader *)(uintptr_t(ptr) & ~uintptr_t(SlabHeap::kSlabSize - 1));
+}
+
+SlabHeap	* SlabHeap::s_heaps[kMaxHeaps] = { nullptr };
+std::atomic <u32>	SlabHeap::s_numHeaps(0);
+
+struct SlabHeap::CacheBin
+{
+	FreeNode	* head;
+	u32			count;
+
+	// stats are folded in to the size class whenever the bin touches the depot
+	u32			allocs;
+	u32			frees;
+};
+
+// set by the thread cache's destructor. frees keep arriving after it, from the CRT's own thread data and
+// thread_locals destroyed later, once the heap hooks are in. plain bool, so it's still readable then
+static thread_local bool s_threadCacheDestroyed = false;
+
+struct SlabHeap::ThreadCache
+{
+	CacheBin	bins[kMaxHeaps][kNumClasses];
+
+	ThreadCache()
+	{
+		memset(bins, 0, sizeof(bins));
+	}
+
+	~ThreadCache()
+	{
+		s_threadCacheDestroyed = true;
+
+		u32 numHeaps = s_numHeaps.load();
+
+		for(u32 heapIdx = 0; heapIdx < numHeaps; heapIdx++)
+		{
+			SlabHeap * heap = s_heaps[heapIdx];
+			if(!heap)
+				continue;
+
+			for(u32 i = 0; i < heap->m_numClasses; i++)
+			{
+				heap->drain(bins[heapIdx][i], i, bins[heapIdx][i].count);
+				heap->flushCounts(bins[heapIdx][i], i);
+			}
+		}
+	}
+};
+
+SlabHeap::ThreadCache * SlabHeap::getThreadCache()
+{
+	if(s_threadCacheDestroyed)
+		return nullptr;
+
+	static thread_local ThreadCache s_cache;
+
+	return &s_cache;
+}
+
+#ifdef _WIN32
+static bool EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return false;
+
+	TOKEN_PRIVILEGES privs;
+	privs.PrivilegeCount = 1;
+	privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+	bool result =
+		LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privs.Privileges[0].Luid) &&
+		AdjustTokenPrivileges(token, FALSE, &privs, 0, nullptr, nullptr) &&
+		(GetLastError() == ERROR_SUCCESS);	// ERROR_NOT_ALL_ASSIGNED if the user doesn't hold the privilege
+
+	CloseHandle(token);
+
+	return result;
+}
+#endif
+
+SlabHeap::SlabHeap(bool trackOwners)
+	:m_numClasses(0)
+	,m_trackOwners(trackOwners)
+	,m_arenaOnly(false)
+{
+	memset(m_classLookup, 0, sizeof(m_classLookup));
+
+	for(u32 i = 0; i < kNumClasses; i++)
+	{
+		m_classes[i].size = 0;
+		m_classes[i].numObjs = 0;
+		m_classes[i].dataOffset = 0;
+		m_classes[i].allocs = 0;
+		m_classes[i].frees = 0;
+	}
+
+	for(u32 i = 0; i < kMaxOwners; i++)
+	{
+		m_owners[i].allocs = 0;
+		m_owners[i].frees = 0;
+		m_owners[i].liveBytes = 0;
+		m_owners[i].peakBytes = 0;
+	}
+
+	Arena * arenas[] = { &m_largePageArena, &m_arena };
+	for(auto * arena : arenas)
+	{
+		arena->base = nullptr;
+		arena->len = 0;
+		arena->used = 0;
+		arena->commitOnAlloc = false;
+	}
+
+	m_heapIdx = s_numHeaps++;
+	ASSERT(m_heapIdx < kMaxHeaps);
+	s_heaps[m_heapIdx] = this;
+
+	// 16 byte steps up to 128, then four classes per power of two
+	u32 size = 16;
+	while(size <= kSmallMax)
+	{
+		ASSERT(m_numClasses < kNumClasses);
+
+		SizeClass & sizeClass = m_classes[m_numClasses];
+
+		sizeClass.size = size;
+
+		// one owner byte per object lives between the header and the data
+		u32 numObjs = (kSlabSize - sizeof(SlabBlockHeader)) / (size + 1);
+		sizeClass.dataOffset = (sizeof(SlabBlockHeader) + numObjs + 15) & ~15;
+		sizeClass.numObjs = (kSlabSize - sizeClass.dataOffset) / size;
+
+		m_numClasses++;
+
+		if(size < 128)
+			size += 16;
+		else
+		{
+			u32 step = 1;
+			while((step << 3) <= size) step <<= 1;	// size / 4 for the current power of two
+
+			size += step;
+		}
+	}
+
+	u32 classIdx = 0;
+	for(u32 i = 0; i < sizeof(m_classLookup) / sizeof(m_classLookup[0]); i++)
+	{
+		while(m_classes[classIdx].size < i * 16)
+			classIdx++;
+
+		m_classLookup[i] = classIdx;
+	}
+}
+
+SlabHeap::~SlabHeap()
+{
+	// slabs stay mapped until the process exits, other modules may still hold pointers in to them
+	s_heaps[m_heapIdx] = nullptr;
+}
+
+bool SlabHeap::initArena(u64 reserveBytes, u64 largePageBytes)
+{
+	ASSERT(!m_arena.base && !m_largePageArena.base);
+
+	if(largePageBytes)
+	{
+#ifdef _WIN32
+		u64 largePageSize = GetLargePageMinimum();
+
+		if(largePageSize && EnableLockMemoryPrivilege())
+		{
+			largePageBytes = (largePageBytes + largePageSize - 1) & ~(largePageSize - 1);
+
+			// large pages can't be committed on demand, the whole range is backed up front
+			m_largePageArena.base = (u8 *)VirtualAlloc(nullptr, largePageBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if(m_largePageArena.base)
+			{
+				m_largePageArena.len = largePageBytes;
+
+				_MESSAGE("SlabHeap: %llu MB large page arena at %016llX", largePageBytes >> 20, u64(m_largePageArena.base));
+			}
+			else
+			{
+				_WARNING("SlabHeap: couldn't allocate large page arena (%08X)", GetLastError());
+			}
+		}
+		else
+		{
+			_WARNING("SlabHeap: large pages unavailable (SeLockMemoryPrivilege not held?)");
+		}
+#else
+		_WARNING("SlabHeap: large page arenas are only supported on Windows");
+#endif
+	}
+
+	reserveBytes &= ~u64(kSlabSize - 1);
+
+	m_arena.base = (u8 *)Platform_ReservePages(reserveBytes);
+	if(!m_arena.base)
+	{
+		_ERROR("SlabHeap: couldn't reserve %llu MB arena (%08X)", reserveBytes >> 20, Platform_GetLastError());
+		return false;
+	}
+
+	m_arena.len = reserveBytes;
+	m_arena.commitOnAlloc = true;
+	m_arenaOnly = true;
+
+	return true;
+}
+
+bool SlabHeap::contains(const void * ptr) const
+{
+	uintptr_t addr = uintptr_t(ptr);
+
+	return
+		((addr - uintptr_t(m_arena.base)) < m_arena.len) ||
+		((addr - uintptr_t(m_largePageArena.base)) < m_largePageArena.len);
+}
+
+u32 SlabHeap::classFromSize(size_t size) const
+{
+	if(size > kSmallMax)
+		return kLargeClass;
+
+	return m_classLookup[(size + 15) >> 4];
+}
+
+void * SlabHeap::allocSlab()
+{
+	Arena * arenas[] = { &m_largePageArena, &m_arena };
+	for(auto * arena : arenas)
+	{
+		if(!arena->base)
+			continue;
+
+		u64 offset = arena->used.fetch_add(kSlabSize);
+		if(offset + kSlabSize <= arena->len)
+		{
+			void * slab = arena->base + offset;
+
+			if(arena->commitOnAlloc && !Platform_CommitPages(slab, kSlabSize))
+				return nullptr;
+
+			return slab;
+		}
+	}
+
+	if(m_arenaOnly)
+		return nullptr;
+
+	return Platform_AllocPages(kSlabSize);
+}
+
+void * SlabHeap::allocate(size_t size, u32 owner)
+{
+	if(!size) size = 1;
+	if(owner >= kMaxOwners) owner = kMaxOwners - 1;
+
+	u32 classIdx = classFromSize(size);
+	if(classIdx == kLargeClass)
+	{
+		// arena heaps leave these to the caller's fallback allocator
+		if(m_arenaOnly)
+			return nullptr;
+
+		size_t blockSize = size + sizeof(SlabBlockHeader);
+
+		auto * header = (SlabBlockHeader *)Platform_AllocPages(blockSize);
+		if(!header)
+		{
+			_ERROR("SlabHeap: couldn't allocate %016llX bytes (%08X)", u64(size), Platform_GetLastError());
+			return nullptr;
+		}
+
+		header->classIdx = kLargeClass;
+		header->heapIdx = m_heapIdx;
+		header->owner = owner;
+		header->size = size;
+
+		recordAlloc(owner, size);
+
+		return header + 1;
+	}
+
+	// an exiting thread goes through a bin on the stack that's handed straight back to the depot
+	ThreadCache * cache = getThreadCache();
+	CacheBin exitBin = { nullptr, 0, 0, 0 };
+	CacheBin & bin = cache ? cache->bins[m_heapIdx][classIdx] : exitBin;
+
+	if(!bin.head && !refill(bin, classIdx))
+		return nullptr;
+
+	FreeNode * node = bin.head;
+	bin.head = node->next;
+	bin.count--;
+	bin.allocs++;
+
+	if(m_trackOwners)
+	{
+		const SizeClass & sizeClass = m_classes[classIdx];
+		SlabBlockHeader * header = GetBlockHeader(node);
+		u32 slot = (u32)((uintptr_t(node) - uintptr_t(header) - sizeClass.dataOffset) / sizeClass.size);
+
+		header->owners[slot] = owner;
+
+		recordAlloc(owner, sizeClass.size);
+	}
+
+	if(!cache)
+		drain(bin, classIdx, bin.count);
+
+	return node;
+}
+
+void SlabHeap::free(void * ptr)
+{
+	if(!ptr)
+		return;
+
+	SlabBlockHeader * header = GetBlockHeader(ptr);
+
+	// a foreign pointer would otherwise be pushed on to this heap's depot and handed out again
+	ASSERT_STR(header->heapIdx == m_heapIdx, "SlabHeap: pointer freed to a heap that didn't allocate it");
+
+	if(header->classIdx == kLargeClass)
+	{
+		recordFree(header->owner, header->size);
+
+		Platform_FreePages(header, header->size + sizeof(SlabBlockHeader));
+
+		return;
+	}
+
+	u32 classIdx = header->classIdx;
+
+	if(m_trackOwners)
+	{
+		const SizeClass & sizeClass = m_classes[classIdx];
+		u32 slot = (u32)((uintptr_t(ptr) - uintptr_t(header) - sizeClass.dataOffset) / sizeClass.size);
+
+		recordFree(header->owners[slot], sizeClass.size);
+	}
+
+	ThreadCache * cache = getThreadCache();
+	CacheBin exitBin = { nullptr, 0, 0, 0 };
+	CacheBin & bin = cache ? cache->bins[m_heapIdx][classIdx] : exitBin;
+
+	auto * node = (FreeNode *)ptr;
+	node->next = bin.head;
+	bin.head = node;
+	bin.count++;
+	bin.frees++;
+
+	// keep one batch around for the next burst, hand the rest back. an exiting thread keeps nothing
+	if(!cache)
+		drain(bin, classIdx, bin.count);
+	else if(bin.count >= kBatchSize * 2)
+		drain(bin, classIdx, kBatchSize);
+}
+
+size_t SlabHeap::usableSize(const void * ptr) const
+{
+	if(!ptr)
+		return 0;
+
+	SlabBlockHeader * header = GetBlockHeader(ptr);
+
+	if(header->classIdx == kLargeClass)
+		return header->size;
+
+	return m_classes[header->classIdx].size;
+}
+
+bool SlabHeap::refill(CacheBin & bin, u32 classIdx)
+{
+	Depot & depot = m_depots[classIdx];
+
+	flushCounts(bin, classIdx);
+
+	{
+		std::lock_guard <std::mutex> locker(depot.lock);
+
+		while(depot.head && bin.count < kBatchSize)
+		{
+			FreeNode * node = depot.head;
+			depot.head = node->next;
+			depot.count--;
+
+			node->next = bin.head;
+			bin.head = node;
+			bin.count++;
+		}
+
+		if(bin.head)
+			return true;
+	}
+
+	// depot is empty, carve a fresh slab straight in to this thread's cache
+	auto * header = (SlabBlockHeader *)allocSlab();
+	if(!header)
+	{
+		static bool s_warned = false;
+		if(!s_warned)
+		{
+			s_warned = true;
+			_ERROR("SlabHeap: couldn't allocate slab for class %d (%08X)", m_classes[classIdx].size, Platform_GetLastError());
+		}
+
+		return false;
+	}
+
+	{
+		std::lock_guard <std::mutex> locker(depot.lock);
+		depot.numSlabs++;
+	}
+
+	const SizeClass & sizeClass = m_classes[classIdx];
+
+	header->classIdx = classIdx;
+	header->heapIdx = m_heapIdx;
+	header->owner = 0;
+	header->size = 0;
+
+	u8 * data = ((u8 *)header) + sizeClass.dataOffset;
+
+	// push in reverse so objects are handed out in address order
+	for(u32 i = sizeClass.numObjs; i > 0; i--)
+	{
+		auto * node = (FreeNode *)(data + ((i - 1) * sizeClass.size));
+
+		node->next = bin.head;
+		bin.head = node;
+		bin.count++;
+	}
+
+	return true;
+}
+
+void SlabHeap::drain(CacheBin & bin, u32 classIdx, u32 count)
+{
+	flushCounts(bin, classIdx);
+
+	if(!bin.head || !count)
+		return;
+
+	// detach the batch before taking the lock
+	FreeNode * first = bin.head;
+	FreeNode * last = first;
+	u32 numMoved = 1;
+
+	while(last->next && numMoved < count)
+	{
+		last = last->next;
+		numMoved++;
+	}
+
+	bin.head = last->next;
+	bin.count -= numMoved;
+
+	Depot & depot = m_depots[classIdx];
+
+	std::lock_guard <std::mutex> locker(depot.lock);
+
+	last->next = depot.head;
+	depot.head = first;
+	depot.count += numMoved;
+}
+
+void SlabHeap::flushCounts(CacheBin & bin, u32 classIdx)
+{
+	SizeClass & sizeClass = m_classes[classIdx];
+
+	if(bin.allocs)
+	{
+		sizeClass.allocs.fetch_add(bin.allocs, std::memory_order_relaxed);
+		bin.allocs = 0;
+	}
+
+	if(bin.frees)
+	{
+		sizeClass.frees.fetch_add(bin.frees, std::memory_order_relaxed);
+		bin.frees = 0;
+	}
+}
+
+void SlabHeap::flushThreadCache()
+{
+	ThreadCache * cache = getThreadCache();
+	if(!cache)
+		return;
+
+	for(u32 i = 0; i < m_numClasses; i++)
+		drain(cache->bins[m_heapIdx][i], i, cache->bins[m_heapIdx][i].count);
+}
+
+void SlabHeap::recordAlloc(u32 owner, u64 size)
+{
+	OwnerStats & stats = m_owners[owner];
+
+	stats.allocs.fetch_add(1, std::memory_order_relaxed);
+
+	u64 live = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	u64 peak = stats.peakBytes.load(std::memory_order_relaxed);
+
+	while((live > peak) && !stats.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+}
+
+void SlabHeap::recordFree(u32 owner, u64 size)
+{
+	OwnerStats & stats = m_owners[owner];
+
+	stats.frees.fetch_add(1, std::memory_order_relaxed);
+	stats.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void SlabHeap::getStats(u32 owner, Stats * out) const
+{
+	if(owner >= kMaxOwners) owner = kMaxOwners - 1;
+
+	const OwnerStats & stats = m_owners[owner];
+
+	out->allocs = stats.allocs.load(std::memory_order_relaxed);
+	out->frees = stats.frees.load(std::memory_order_relaxed);
+	out->liveBytes = stats.liveBytes.load(std::memory_order_relaxed);
+	out->peakBytes = stats.peakBytes.load(std::memory_order_relaxed);
+}
+
+void SlabHeap::getClassStats(u32 classIdx, ClassStats * out)
+{
+	ASSERT(classIdx < m_numClasses);
+
+	const SizeClass & sizeClass = m_classes[classIdx];
+	Depot & depot = m_depots[classIdx];
+
+	out->size = sizeClass.size;
+	out->allocs = sizeClass.allocs.load(std::memory_order_relaxed);
+	out->frees = sizeClass.frees.load(std::memory_order_relaxed);
+
+	std::lock_guard <std::mutex> locker(depot.lock);
+
+	out->numSlabs = depot.numSlabs;
+	out->depotObjs = depot.count;
+}
+
+void SlabHeap::report(PrintFn print)
+{
+	if(m_trackOwners)
+	{
+		for(u32 i = 0; i < kMaxOwners; i++)
+		{
+			Stats stats;
+			getStats(i, &stats);
+
+			if(!stats.allocs)
+				continue;
+
+			print("slab heap owner %d: %llu allocs %llu frees, %llu bytes live (peak %llu)",
+				i, stats.allocs, stats.frees, stats.liveBytes, stats.peakBytes);
+		}
+	}
+
+	for(u32 i = 0; i < m_numClasses; i++)
+	{
+		ClassStats stats;
+		getClassStats(i, &stats);
+
+		if(!stats.numSlabs)
+			continue;
+
+		print("slab heap class %5d: %4d slabs, %llu allocs %llu frees, %llu free in depot",
+			stats.size, stats.numSlabs, stats.allocs, stats.frees, stats.depotObjs);
+	}
+}
+
+void * SlabHeap_Allocate(size_t size)
+{
+	return g_slabHeap.allocate(size);
+}
+
+void SlabHeap_Free(void * ptr)
+{
+	g_slabHeap.free(ptr);
+}
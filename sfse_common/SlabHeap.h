@@ -0,0 +1,152 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+// size-class slab allocator for objects owned by SFSE and plugins
+//
+// small allocations are carved from 64KB slabs, one size class per slab. each thread keeps a short free list
+// per class and only touches the shared depot (under a per-class lock) to move whole batches. large
+// allocations get their own block of pages. both kinds are 64KB aligned (see Platform.h), so free() finds the
+// header by masking the pointer and doesn't need the size. the header also records the heap, and freeing a
+// pointer to a heap that didn't allocate it asserts.
+//
+// every allocation can be tagged with an owner (a PluginHandle when called through the plugin interface) so
+// live and peak usage can be reported per plugin. slabs are pooled, not returned to the OS.
+//
+// a heap can also be bound to a reserved arena with initArena. slabs are then committed from the arena
+// (optionally backed by large pages), contains() can tell its pointers apart from foreign ones, and large
+// requests are refused so the caller can pass them on to another allocator.
+
+class SlabHeap
+{
+public:
+	SlabHeap(bool trackOwners = true);
+	~SlabHeap();
+
+	enum
+	{
+		kSlabSize = 64 * 1024,	// kPlatform_PageGranularity
+		kSmallMax = 4096,		// larger requests bypass the slabs
+		kNumClasses = 32,
+		kLargeClass = 0xFF,
+
+		kBatchSize = 32,		// objects moved between a thread cache and the depot at once
+		kMaxOwners = 256,		// owners past this are counted in the last slot
+		kMaxHeaps = 4,			// thread caches are preallocated per heap
+	};
+
+	struct Stats
+	{
+		u64	allocs;
+		u64	frees;
+		u64	liveBytes;
+		u64	peakBytes;
+	};
+
+	struct ClassStats
+	{
+		u32	size;
+		u32	numSlabs;
+		u64	allocs;		// lags by up to one batch per thread
+		u64	frees;
+		u64	depotObjs;
+	};
+
+	bool	initArena(u64 reserveBytes, u64 largePageBytes = 0);
+	bool	contains(const void * ptr) const;
+
+	void *	allocate(size_t size, u32 owner = 0);
+	void	free(void * ptr);
+
+	// usable size of a live allocation
+	size_t	usableSize(const void * ptr) const;
+
+	void	getStats(u32 owner, Stats * out) const;
+	u32		numClasses() const { return m_numClasses; }
+	void	getClassStats(u32 classIdx, ClassStats * out);
+
+	typedef void (* PrintFn)(const char * fmt, ...);
+	void	report(PrintFn print);
+
+	// returns this thread's cache to the depots, called automatically on thread exit
+	void	flushThreadCache();
+
+private:
+	struct FreeNode
+	{
+		FreeNode	* next;
+	};
+
+	struct SizeClass
+	{
+		u32	size;
+		u32	numObjs;	// per slab
+		u32	dataOffset;	// from slab base
+
+		std::atomic <u64>	allocs;
+		std::atomic <u64>	frees;
+	};
+
+	struct Depot
+	{
+		std::mutex	lock;
+		FreeNode	* head = nullptr;
+		u32			count = 0;
+		u32			numSlabs = 0;
+	};
+
+	struct OwnerStats
+	{
+		std::atomic <u64>	allocs;
+		std::atomic <u64>	frees;
+		std::atomic <u64>	liveBytes;
+		std::atomic <u64>	peakBytes;
+	};
+
+	struct Arena
+	{
+		u8					* base;
+		u64					len;
+		std::atomic <u64>	used;
+		bool				commitOnAlloc;
+	};
+
+	struct CacheBin;
+	struct ThreadCache;
+
+	u32		classFromSize(size_t size) const;
+	void *	allocSlab();
+	bool	refill(CacheBin & bin, u32 classIdx);
+	void	drain(CacheBin & bin, u32 classIdx, u32 count);
+	void	flushCounts(CacheBin & bin, u32 classIdx);
+	void	recordAlloc(u32 owner, u64 size);
+	void	recordFree(u32 owner, u64 size);
+
+	ThreadCache *	getThreadCache();	// null once this thread's cache has been destroyed
+
+	SizeClass	m_classes[kNumClasses];
+	u32			m_numClasses;
+	u8			m_classLookup[(kSmallMax / 16) + 1];	// (size + 15) / 16 -> class
+
+	Depot		m_depots[kNumClasses];
+	OwnerStats	m_owners[kMaxOwners];
+	bool		m_trackOwners;
+
+	Arena		m_largePageArena;
+	Arena		m_arena;
+	bool		m_arenaOnly;
+
+	u32			m_heapIdx;
+
+	static SlabHeap				* s_heaps[kMaxHeaps];
+	static std::atomic <u32>	s_numHeaps;
+};
+
+extern SlabHeap g_slabHeap;
+
+// for use with DEFINE_STATIC_HEAP on SFSE-owned classes
+void * SlabHeap_Allocate(size_t size);
+void SlabHeap_Free(void * ptr);
@@ -0,0 +1,421 @@
+#include "Telemetry.h"
+#include "sfse_common/Platform.h"
+#include "sfse_common/ThreadPolicy.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the mapping itself, handle is the file mapping on Windows and unused elsewhere. readers pass in a size of 0
+// and get back the size of whatever the writer created
+
+static void * MapSegment(const char * name, u64 * size, bool create, void ** handle)
+{
+	*handle = nullptr;
+
+#ifdef _WIN32
+	char path[MAX_PATH];
+	sprintf_s(path, "Local\\%s", name);
+
+	HANDLE mapping = create ?
+		CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(*size >> 32), (DWORD)*size, path) :
+		OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+	if(!mapping)
+		return nullptr;
+
+	void * result = MapViewOfFile(mapping, create ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, create ? *size : 0);
+	if(!result)
+	{
+		CloseHandle(mapping);
+		return nullptr;
+	}
+
+	if(!create)
+	{
+		MEMORY_BASIC_INFORMATION info;
+		*size = VirtualQuery(result, &info, sizeof(info)) ? info.RegionSize : 0;
+	}
+
+	*handle = mapping;
+
+	return result;
+#else
+	char path[MAX_PATH];
+	snprintf(path, sizeof(path), "/%s", name);
+
+	int fd = create ?
+		shm_open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) :
+		shm_open(path, O_RDONLY, 0);
+	if(fd < 0)
+		return nullptr;
+
+	if(create)
+	{
+		if(ftruncate(fd, *size))
+		{
+			::close(fd);
+			shm_unlink(path);
+			return nullptr;
+		}
+	}
+	else
+	{
+		struct stat info;
+		if(fstat(fd, &info) || (u64)info.st_size < sizeof(TelemetryHeader))
+		{
+			::close(fd);
+			return nullptr;
+		}
+
+		*size = info.st_size;
+	}
+
+	void * result = mmap(nullptr, *size, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	return (result == MAP_FAILED) ? nullptr : result;
+#endif
+}
+
+#ifdef _WIN32
+static void UnmapSegment(const void * data, u64, void * handle)
+{
+	UnmapViewOfFile(data);
+	CloseHandle(handle);
+}
+#else
+static void UnmapSegment(const void * data, u64 size, void *)
+{
+	munmap((void *)data, size);
+}
+#endif
+
+static u64 GetSegmentSize(const TelemetryHeader * header)
+{
+	return header->headerSize + (u64)header->entrySize * header->maxEntries;
+}
+
+static u64 GetTimestamp()
+{
+	return std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static u32 GetPID()
+{
+#ifdef _WIN32
+	return GetCurrentProcessId();
+#else
+	return getpid();
+#endif
+}
+
+TelemetryWriter::TelemetryWriter()
+	:m_header(nullptr), m_entries(nullptr), m_size(0), m_handle(nullptr)
+{
+	m_name[0] = 0;
+}
+
+TelemetryWriter::~TelemetryWriter()
+{
+	close();
+}
+
+bool TelemetryWriter::create(const char * name, u32 maxEntries, u64 intervalNS)
+{
+	close();
+
+	if(!name || !*name || (strlen(name) >= sizeof(m_name)) || !maxEntries)
+		return false;
+
+	u64 size = sizeof(TelemetryHeader) + (u64)sizeof(TelemetryEntry) * maxEntries;
+
+	void * data = MapSegment(name, &size, true, &m_handle);
+	if(!data)
+		return false;
+
+	strcpy(m_name, name);
+	m_size = size;
+	m_header = (TelemetryHeader *)data;
+	m_entries = (TelemetryEntry *)(m_header + 1);
+
+	// fresh pages are zeroed, magic goes last so readers never see a half filled in header
+	m_header->version = kTelemetryVersion;
+	m_header->headerSize = sizeof(TelemetryHeader);
+	m_header->entrySize = sizeof(TelemetryEntry);
+	m_header->maxEntries = maxEntries;
+	m_header->numEntries = 0;
+	m_header->pid = GetPID();
+	m_header->sequence.store(0, std::memory_order_relaxed);
+	m_header->publishCount = 0;
+	m_header->timestamp = GetTimestamp();
+	m_header->intervalNS = intervalNS;
+
+	std::atomic_thread_fence(std::memory_order_release);
+	((std::atomic <u32> *)&m_header->magic)->store(kTelemetryMagic, std::memory_order_release);
+
+	return true;
+}
+
+void TelemetryWriter::close()
+{
+	if(!m_header)
+		return;
+
+	UnmapSegment(m_header, m_size, m_handle);
+
+#ifndef _WIN32
+	// Windows drops the mapping with its last handle, POSIX shm lives until unlinked
+	char path[MAX_PATH];
+	snprintf(path, sizeof(path), "/%s", m_name);
+	shm_unlink(path);
+#endif
+
+	m_header = nullptr;
+	m_entries = nullptr;
+	m_size = 0;
+	m_handle = nullptr;
+	m_name[0] = 0;
+}
+
+void TelemetryWriter::publish(const MetricsSnapshot * metrics, u32 count)
+{
+	if(!m_header)
+		return;
+
+	count = std::min(count, m_header->maxEntries);
+
+	// build the entries outside of the write window so readers retry as rarely as possible
+	static thread_local std::vector <TelemetryEntry> scratch;
+	scratch.resize(count);
+
+	for(u32 i = 0; i < count; i++)
+	{
+		const MetricsSnapshot & src = metrics[i];
+		TelemetryEntry & dst = scratch[i];
+
+		memset(&dst, 0, sizeof(dst));
+
+		strncpy(dst.name, src.name, sizeof(dst.name) - 1);
+		dst.type = src.type;
+		dst.count = src.count;
+		dst.value = src.value;
+		dst.sum = src.sum;
+		dst.min = src.min;
+		dst.max = src.max;
+		dst.p50 = src.p50;
+		dst.p90 = src.p90;
+		dst.p99 = src.p99;
+		dst.p999 = src.p999;
+	}
+
+	u64 timestamp = GetTimestamp();
+	u64 sequence = m_header->sequence.load(std::memory_order_relaxed);
+
+	m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	if(count)
+		memcpy(m_entries, scratch.data(), sizeof(TelemetryEntry) * count);
+
+	m_header->numEntries = count;
+	m_header->publishCount++;
+	m_header->timestamp = timestamp;
+
+	m_header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+TelemetryReader::TelemetryReader()
+	:m_header(nullptr), m_size(0), m_handle(nullptr)
+{
+	//
+}
+
+TelemetryReader::~TelemetryReader()
+{
+	close();
+}
+
+bool TelemetryReader::open(const char * name)
+{
+	close();
+
+	if(!name || !*name)
+		return false;
+
+	u64 size = 0;
+	void * handle;
+	const TelemetryHeader * header = (const TelemetryHeader *)MapSegment(name, &size, false, &handle);
+	if(!header)
+		return false;
+
+	m_header = header;
+	m_size = size;
+	m_handle = handle;
+
+	return true;
+}
+
+void TelemetryReader::close()
+{
+	if(!m_header)
+		return;
+
+	UnmapSegment(m_header, m_size, m_handle);
+
+	m_header = nullptr;
+	m_size = 0;
+	m_handle = nullptr;
+}
+
+u32 TelemetryReader::read(TelemetryFrame * out, u32 maxTries)
+{
+	if(!m_header)
+		return kRead_NotOpen;
+
+	const TelemetryHeader * header = m_header;
+
+	if((((const std::atomic <u32> *)&header->magic)->load(std::memory_order_acquire) != kTelemetryMagic) ||
+		(header->version != kTelemetryVersion) ||
+		(header->headerSize < sizeof(TelemetryHeader)) ||
+		(header->entrySize < sizeof(TelemetryEntry)) ||
+		(GetSegmentSize(header) > m_size))
+		return kRead_BadLayout;
+
+	const u8 * entries = ((const u8 *)header) + header->headerSize;
+	u32 entrySize = header->entrySize;
+	u32 maxEntries = header->maxEntries;
+
+	for(u32 i = 0; i < maxTries; i++)
+	{
+		u64 before = header->sequence.load(std::memory_order_acquire);
+		if(before & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		u32 count = std::min(header->numEntries, maxEntries);
+
+		out->pid = header->pid;
+		out->publishCount = header->publishCount;
+		out->timestamp = header->timestamp;
+		out->intervalNS = header->intervalNS;
+		out->entries.resize(count);
+
+		// newer writers may have appended fields, only copy the ones we know about
+		for(u32 j = 0; j < count; j++)
+			memcpy(&out->entries[j], entries + (u64)entrySize * j, sizeof(TelemetryEntry));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		u64 after = header->sequence.load(std::memory_order_relaxed);
+		if(after == before)
+		{
+			out->sequence = before;
+
+			for(auto & entry : out->entries)
+				entry.name[sizeof(entry.name) - 1] = 0;
+
+			return kRead_OK;
+		}
+	}
+
+	return kRead_Busy;
+}
+
+// publisher thread, same shape as the metrics reporter
+
+struct TelemetryPublisher
+{
+	std::mutex				lock;
+	std::condition_variable	wake;
+	u32						generation = 0;		// bumped to retire the running thread
+	bool					running = false;	// cleared once the retired thread has closed its segment
+};
+
+static TelemetryPublisher & GetPublisher()
+{
+	static TelemetryPublisher * publisher = new TelemetryPublisher;
+	return *publisher;
+}
+
+bool Telemetry_StartPublishing(const char * name, u32 intervalMS)
+{
+	Telemetry_StopPublishing();
+
+	if(!intervalMS)
+		return false;
+
+	// owned by the thread, closed (and on POSIX unlinked) when it's retired
+	TelemetryWriter * writer = new TelemetryWriter;
+	if(!writer->create(name, kTelemetryDefaultMaxEntries, intervalMS * 1000000ull))
+	{
+		delete writer;
+		return false;
+	}
+
+	TelemetryPublisher & publisher = GetPublisher();
+	u32 generation;
+
+	{
+		std::lock_guard <std::mutex> locker(publisher.lock);
+		generation = publisher.generation;
+		publisher.running = true;
+	}
+
+	std::thread([&publisher, generation, intervalMS, writer]()
+	{
+		ThreadPolicy_ApplyToCurrentThread();
+
+		std::vector <MetricsSnapshot> metrics;
+
+		std::unique_lock <std::mutex> locker(publisher.lock);
+
+		do
+		{
+			locker.unlock();
+
+			u32 count = Metrics_Snapshot(metrics.data(), (u32)metrics.size());
+			if(count > metrics.size())
+			{
+				metrics.resize(count);
+				count = Metrics_Snapshot(metrics.data(), (u32)metrics.size());
+			}
+
+			writer->publish(metrics.data(), std::min(count, (u32)metrics.size()));
+
+			locker.lock();
+		}
+		while(!publisher.wake.wait_for(locker, std::chrono::milliseconds(intervalMS), [&]() { return publisher.generation != generation; }));
+
+		delete writer;
+
+		publisher.running = false;
+		locker.unlock();
+		publisher.wake.notify_all();
+	}).detach();
+
+	return true;
+}
+
+void Telemetry_StopPublishing()
+{
+	TelemetryPublisher & publisher = GetPublisher();
+
+	std::unique_lock <std::mutex> locker(publisher.lock);
+	publisher.generation++;
+	publisher.wake.notify_all();
+
+	// wait for the segment to be closed so a restart under the same name can't have it unlinked from under it
+	publisher.wake.wait(locker, [&]() { return !publisher.running; });
+}
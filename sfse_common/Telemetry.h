@@ -0,0 +1,118 @@
+#pragma once
+
+#include "sfse_common/Metrics.h"
+#include <atomic>
+#include <vector>
+
+// metrics published to a named shared memory segment for external tools
+//
+// the segment is a fixed header followed by an array of entries, one per metric. the writer republishes the
+// whole array on an interval under a seqlock: the sequence number is odd while an update is in progress, and a
+// reader copies the entries out and retries if the sequence changed underneath it. readers never take a lock or
+// signal the writer, so an overlay can poll as often as it likes without slowing the game down.
+//
+// the segment is "Local\<name>" on Windows and "/<name>" (POSIX shm) elsewhere. readers should check magic and
+// version, and step through entries by entrySize so newer writers can append fields.
+
+enum
+{
+	kTelemetryMagic = 0x4D544653,	// 'SFTM'
+	kTelemetryVersion = 1,
+	kTelemetryNameLength = 64,
+	kTelemetryDefaultMaxEntries = 512,
+};
+
+static const char * const kTelemetryDefaultName = "SFSE_Telemetry";
+
+struct TelemetryHeader
+{
+	u32					magic;			// 00 written last when the segment is created
+	u32					version;		// 04
+	u32					headerSize;		// 08
+	u32					entrySize;		// 0C
+	u32					maxEntries;		// 10
+	u32					numEntries;		// 14
+	u32					pid;			// 18
+	u32					pad1C;			// 1C
+	std::atomic <u64>	sequence;		// 20 odd while the writer is updating
+	u64					publishCount;	// 28
+	u64					timestamp;		// 30 ns since the unix epoch
+	u64					intervalNS;		// 38
+};
+static_assert(sizeof(TelemetryHeader) == 0x40, "TelemetryHeader");
+
+struct TelemetryEntry
+{
+	char	name[kTelemetryNameLength];	// 00 truncated, always terminated
+	u32		type;						// 40 kMetricType_*
+	u32		pad44;						// 44
+	u64		count;						// 48 counter total or histogram samples
+	s64		value;						// 50 gauge
+	u64		sum;						// 58 histograms from here on
+	u64		min;						// 60
+	u64		max;						// 68
+	u64		p50;						// 70
+	u64		p90;						// 78
+	u64		p99;						// 80
+	u64		p999;						// 88
+};
+static_assert(sizeof(TelemetryEntry) == 0x90, "TelemetryEntry");
+
+class TelemetryWriter
+{
+public:
+	TelemetryWriter();
+	~TelemetryWriter();
+
+	bool	create(const char * name, u32 maxEntries = kTelemetryDefaultMaxEntries, u64 intervalNS = 0);
+	void	close();
+
+	// entries past maxEntries are dropped
+	void	publish(const MetricsSnapshot * metrics, u32 count);
+
+private:
+	TelemetryHeader	* m_header;
+	TelemetryEntry	* m_entries;
+	u64				m_size;
+	void			* m_handle;
+	char			m_name[128];
+};
+
+struct TelemetryFrame
+{
+	u32		pid;
+	u64		sequence;
+	u64		publishCount;
+	u64		timestamp;
+	u64		intervalNS;
+	std::vector <TelemetryEntry>	entries;
+};
+
+class TelemetryReader
+{
+public:
+	TelemetryReader();
+	~TelemetryReader();
+
+	enum
+	{
+		kRead_OK = 0,
+		kRead_NotOpen,
+		kRead_BadLayout,	// wrong magic or an unsupported version
+		kRead_Busy,			// the writer was mid-update on every try
+	};
+
+	bool	open(const char * name);
+	void	close();
+
+	u32		read(TelemetryFrame * out, u32 maxTries = 1000);
+
+private:
+	const TelemetryHeader	* m_header;
+	u64						m_size;
+	void					* m_handle;
+};
+
+// publishes Metrics_Snapshot to the named segment every interval from a background thread
+bool Telemetry_StartPublishing(const char * name, u32 intervalMS);
+void Telemetry_StopPublishing();
@@ -0,0 +1,58 @@
+#include "ThreadPolicy.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static u64 s_affinity = 0;
+static s32 s_priority = 0;
+
+void ThreadPolicy_Set(u64 affinity, s32 priority)
+{
+	if(priority < kThreadPriority_Lowest) priority = kThreadPriority_Lowest;
+	if(priority > kThreadPriority_Highest) priority = kThreadPriority_Highest;
+
+	s_affinity = affinity;
+	s_priority = priority;
+}
+
+u64 ThreadPolicy_GetAffinity()
+{
+	return s_affinity;
+}
+
+void ThreadPolicy_ApplyToCurrentThread(u64 affinity)
+{
+	if(!affinity)
+		affinity = s_affinity;
+
+#ifdef _WIN32
+	if(affinity)
+		SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(affinity));
+
+	// -2 to 2 are THREAD_PRIORITY_LOWEST to THREAD_PRIORITY_HIGHEST
+	if(s_priority)
+		SetThreadPriority(GetCurrentThread(), s_priority);
+#else
+	if(affinity)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+
+		for(u32 i = 0; i < 64; i++)
+			if(affinity & (1ull << i))
+				CPU_SET(i, &set);
+
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+
+	// linux nice values are per thread
+	if(s_priority < 0)
+		setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), -s_priority * 5);
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+
+// affinity and priority for SFSE's own background threads
+//
+// set once during startup, before any of those threads exist. each long-lived SFSE thread applies it to itself
+// as it starts: worker pools that weren't given their own mask, the metrics reporter, the telemetry publisher
+// and the editor ID indexer. threads inherit the process settings when nothing is set, so tools and the bench
+// see no change.
+//
+// priority is relative to the process, -2 (lowest) to 2 (highest). off Windows, raising it needs privileges
+// and is skipped.
+
+enum
+{
+	kThreadPriority_Lowest = -2,
+	kThreadPriority_Highest = 2,
+};
+
+void	ThreadPolicy_Set(u64 affinity, s32 priority);	// affinity 0 = leave alone
+u64		ThreadPolicy_GetAffinity();
+
+// affinity overrides the policy's mask when non-zero
+void	ThreadPolicy_ApplyToCurrentThread(u64 affinity = 0);
@@ -1,5 +1,6 @@
 #pragma once
 
+#ifdef _MSC_VER
 #include <intrin.h>
 
 typedef unsigned __int8		u8;
@@ -10,15 +11,32 @@ typedef signed __int8		s8;
 typedef signed __int16		s16;
 typedef signed __int32		s32;
 typedef signed __int64		s64;
+#else
+#include <cstddef>
+#include <cstdint>
+
+// same widths as the MSVC types, so %llu etc. work on both
+typedef unsigned char		u8;
+typedef unsigned short		u16;
+typedef unsigned int		u32;
+typedef unsigned long long	u64;
+typedef signed char			s8;
+typedef signed short		s16;
+typedef signed int			s32;
+typedef signed long long	s64;
+#endif
 typedef float				f32;
 typedef double				f64;
-typedef u64					uint;
+#ifdef _MSC_VER
+typedef u64					uint;	// glibc already has a 32 bit uint in sys/types.h
+#endif
 
 typedef u8	unk8;
 typedef u16	unk16;
 typedef u32	unk32;
 typedef u64	unk64;
 
+#ifdef _MSC_VER
 inline u16 swap16(u16 a)
 {
 	return _byteswap_ushort(a);
@@ -33,3 +51,19 @@ inline u64 swap64(u64 a)
 {
 	return _byteswap_uint64(a);
 }
+#else
+inline u16 swap16(u16 a)
+{
+	return __builtin_bswap16(a);
+}
+
+inline u32 swap32(u32 a)
+{
+	return __builtin_bswap32(a);
+}
+
+inline u64 swap64(u64 a)
+{
+	return __builtin_bswap64(a);
+}
+#endif
@@ -1,8 +1,11 @@
 #include "Utilities.h"
 #include "sfse_common/Log.h"
 #include "sfse_common/Errors.h"
+#include "sfse_common/Platform.h"
+#include <cstring>
 #include <string>
-#include <Windows.h>
+
+#ifdef _WIN32
 
 /**
  * @brief Get the path of the currently executing runtime.
@@ -163,6 +166,8 @@ const std::string& getOSInfoStr()
     return result;
 }
 
+#endif
+
 /**
  * @brief Get the address of an import function in the Import Address Table (IAT).
  *
@@ -269,6 +274,8 @@ bool is64BitDLL(const void* module)
     return ntHeader->FileHeader.Machine == IMAGE_FILE_MACHINE_AMD64;
 }
 
+#ifdef _WIN32
+
 #pragma warning (push)
 #pragma warning (disable : 4200)
 struct RTTIType
@@ -325,3 +332,5 @@ const char* getObjectClassName(void* objBase)
 
     return result;
 }
+
+#endif
@@ -12,7 +12,8 @@
 // so it doesn't need to be restated throughout the member list
 
 // all of the weirdness with the _GetType function is because you can't declare a static const pointer
-// inside the class definition. we sadly can't inline anymore because of relocation.
+// inside the class definition. the relocated address lives in a RelocMemberFn slot instead, which is
+// rebased once at startup, so the call is a plain indirect call through a constant address.
 
 // RelocPtr only works at a global scope, which we can't handle or we'd be bypassing the function route altogether
 
@@ -25,14 +26,13 @@
 	static const std::uintptr_t functionName##_Address = address;					\
 	inline _##functionName##_type * _##functionName##_GetPtr(void)					\
 	{																				\
-		static uintptr_t _address;													\
-		_address = address + RelocationManager::s_baseAddr;							\
-		return (_##functionName##_type *)&_address;									\
+		return (_##functionName##_type *)&RelocMemberFn <address>::s_addr;			\
 	}
 
 #define DEFINE_MEMBER_FN(functionName, retnType, address, ...)	\
 	DEFINE_MEMBER_FN_LONG(_MEMBER_FN_BASE_TYPE, functionName, retnType, address, __VA_ARGS__)
 
+// SFSE-owned classes can use DEFINE_STATIC_HEAP(SlabHeap_Allocate, SlabHeap_Free), see SlabHeap.h
 #define DEFINE_STATIC_HEAP(staticAllocate, staticFree)						\
 	static void * operator new(std::size_t size)							\
 	{																		\
@@ -68,8 +68,7 @@
 	FORCE_INLINE retnType fnName() {														\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)();									\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)();									\
 	}
 #define DEFINE_MEMBER_FN_1(fnName, retnType, addr, ...)										\
@@ -78,8 +77,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1) {												\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);							\
-	const static uintptr_t address =  fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1);								\
 	}
 #define DEFINE_MEMBER_FN_2(fnName, retnType, addr, ...)										\
@@ -88,8 +86,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2) {										\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);							\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2);							\
 	}
 #define DEFINE_MEMBER_FN_3(fnName, retnType, addr, ...)										\
@@ -98,8 +95,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3) {							\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);							\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3);						\
 	}
 #define DEFINE_MEMBER_FN_4(fnName, retnType, addr, ...)										\
@@ -108,8 +104,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4) {					\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);							\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4);					\
 	}
 #define DEFINE_MEMBER_FN_5(fnName, retnType, addr, ...)										\
@@ -118,8 +113,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5) {		\
 	struct empty_struct {};																	\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);							\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;		\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;										\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;					\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5);				\
 	}
 #define DEFINE_MEMBER_FN_6(fnName, retnType, addr, ...)											\
@@ -128,8 +122,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5, T6 && t6) {	\
 	struct empty_struct {};																		\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);								\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;			\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;											\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;						\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5, t6);				\
 	}
 #define DEFINE_MEMBER_FN_7(fnName, retnType, addr, ...)														\
@@ -138,8 +131,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5, T6 && t6, T7 && t7) {	\
 	struct empty_struct {};																					\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);											\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;						\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;														\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;									\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5, t6, t7);						\
 	}
 #define DEFINE_MEMBER_FN_8(fnName, retnType, addr, ...)																	\
@@ -148,8 +140,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5, T6 && t6, T7 && t7, T8 && t8) {		\
 	struct empty_struct {};																								\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);														\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;									\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;																	\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;												\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5, t6, t7, t8);								\
 	}
 #define DEFINE_MEMBER_FN_9(fnName, retnType, addr, ...)																				\
@@ -158,8 +149,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5, T6 && t6, T7 && t7, T8 && t8, T9 && t9) {		\
 	struct empty_struct {};																											\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);																	\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;												\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;																				\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;															\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5, t6, t7, t8, t9);										\
 	}
 #define DEFINE_MEMBER_FN_10(fnName, retnType, addr, ...)																						\
@@ -168,8 +158,7 @@
 	FORCE_INLINE retnType fnName(T1 && t1, T2 && t2, T3 && t3, T4 && t4, T5 && t5, T6 && t6, T7 && t7, T8 && t8, T9 && t9, T10 && t10) {		\
 	struct empty_struct {};																														\
 	typedef retnType(empty_struct::*_##fnName##_type)(__VA_ARGS__);																				\
-	const static uintptr_t address = fnName##_Address + RelocationManager::s_baseAddr;															\
-	_##fnName##_type fn = *(_##fnName##_type*)&address;																							\
+	_##fnName##_type fn = *(_##fnName##_type*)&RelocMemberFn<addr>::s_addr;																		\
 	return (reinterpret_cast<empty_struct*>(this)->*fn)(t1, t2, t3, t4, t5, t6, t7, t8, t9, t10);												\
 	}
 
@@ -0,0 +1,132 @@
+#include "WorkerPool.h"
+#include "ThreadPolicy.h"
+
+WorkerPool::WorkerPool()
+:m_fn(nullptr), m_count(0), m_next(0), m_busy(0), m_generation(0), m_affinity(0), m_quit(false)
+{
+	//
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::start(u32 numThreads, u64 affinity)
+{
+	stop();
+
+	if(!affinity)
+		affinity = ThreadPolicy_GetAffinity();
+
+	if(!numThreads)
+	{
+		numThreads = std::thread::hardware_concurrency();
+
+		// size to the mask when there is one
+		if(affinity)
+		{
+			numThreads = 0;
+			for(u64 bits = affinity; bits; bits &= bits - 1)
+				numThreads++;
+		}
+
+		if(numThreads)
+			numThreads--;
+	}
+
+	m_affinity = affinity;
+
+	m_quit = false;
+
+	for(u32 i = 0; i < numThreads; i++)
+		m_threads.emplace_back(&WorkerPool::threadProc, this);
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard <std::mutex> lock(m_lock);
+		m_quit = true;
+	}
+
+	m_wake.notify_all();
+
+	for(auto & thread : m_threads)
+		thread.join();
+
+	m_threads.clear();
+}
+
+void WorkerPool::run(u32 count, const std::function <void (u32)> & fn)
+{
+	if(!count)
+		return;
+
+	// not worth waking anyone
+	if(m_threads.empty() || (count == 1))
+	{
+		for(u32 i = 0; i < count; i++)
+			fn(i);
+
+		return;
+	}
+
+	std::lock_guard <std::mutex> runLock(m_runLock);
+
+	{
+		std::lock_guard <std::mutex> lock(m_lock);
+
+		m_fn = &fn;
+		m_count = count;
+		m_next = 0;
+		m_generation++;
+	}
+
+	m_wake.notify_all();
+
+	work();
+
+	// the loop's indices are all claimed, wait for workers still finishing theirs
+	std::unique_lock <std::mutex> lock(m_lock);
+	m_done.wait(lock, [this]() { return !m_busy; });
+
+	m_fn = nullptr;
+}
+
+void WorkerPool::threadProc()
+{
+	u64 seen = 0;
+
+	ThreadPolicy_ApplyToCurrentThread(m_affinity);
+
+	for(;;)
+	{
+		{
+			std::unique_lock <std::mutex> lock(m_lock);
+			m_wake.wait(lock, [&]() { return m_quit || (m_fn && (m_generation != seen)); });
+
+			if(m_quit)
+				break;
+
+			seen = m_generation;
+			m_busy++;
+		}
+
+		work();
+
+		{
+			std::lock_guard <std::mutex> lock(m_lock);
+			m_busy--;
+		}
+
+		m_done.notify_one();
+	}
+}
+
+void WorkerPool::work()
+{
+	u32 idx;
+	while((idx = m_next++) < m_count)
+		(*m_fn)(idx);
+}
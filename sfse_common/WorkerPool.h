@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of threads for data-parallel loops
+//
+// run() hands out indices [0, count) to the workers and the calling thread, and returns once all of them have
+// been processed. one loop runs at a time, concurrent run() calls queue up on the pool.
+//
+// workers can be confined to a CPU mask (see CPUTopology::policyMask), the calling thread is left alone. without
+// one they follow ThreadPolicy, like SFSE's other background threads.
+
+class WorkerPool
+{
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	void	start(u32 numThreads, u64 affinity = 0);	// 0 threads = one per core in the mask minus the caller, 0 mask = ThreadPolicy's
+	void	stop();
+
+	u32		numThreads() const { return u32(m_threads.size()); }
+
+	void	run(u32 count, const std::function <void (u32)> & fn);
+
+private:
+	void	threadProc();
+	void	work();
+
+	std::vector <std::thread>	m_threads;
+
+	std::mutex					m_runLock;		// serializes run()
+	std::mutex					m_lock;
+	std::condition_variable		m_wake;
+	std::condition_variable		m_done;
+
+	const std::function <void (u32)>	* m_fn;
+	u32							m_count;
+	std::atomic <u32>			m_next;
+	u32							m_busy;			// workers inside the current loop
+	u64							m_generation;
+	u64							m_affinity;
+	bool						m_quit;
+};
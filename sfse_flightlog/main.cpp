@@ -0,0 +1,199 @@
+#include "sfse_common/FlightRecorder.h"
+#include "sfse_common/Log.h"
+#include "sfse_common/Platform.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static void PrintUsage()
+{
+	printf("usage: sfse_flightlog [options] <ring file>\n");
+	printf("\n");
+	printf("prints the intact records in a flight recorder ring (sfse.ring) in order\n");
+	printf("\n");
+	printf("options:\n");
+	printf("  -h, -help - print this options list\n");
+	printf("  -tail <n> - only print the last n records\n");
+	printf("  -level <n> - only print records at this level or more severe (0 = fatal error, 5 = debug)\n");
+	printf("  -simulate <n> - log n lines to a new .ring at the path, then crash without flushing\n");
+	printf("  -size <KB> - ring size for -simulate (default 64)\n");
+}
+
+static bool ReadFile(const char * path, std::vector <u64> * out, u64 * size)
+{
+	FILE * src = fopen(path, "rb");
+	if(!src)
+		return false;
+
+	fseek(src, 0, SEEK_END);
+	long len = ftell(src);
+	fseek(src, 0, SEEK_SET);
+
+	if(len < 0)
+	{
+		fclose(src);
+		return false;
+	}
+
+	// u64s so the records are aligned the same as in the mapping
+	out->resize((len + sizeof(u64) - 1) / sizeof(u64));
+	*size = fread(out->data(), 1, len, src);
+
+	fclose(src);
+
+	return true;
+}
+
+// stands in for a crashing game, the records only reach the file through the mapping
+static int Simulate(const char * path, u32 count, u32 sizeKB)
+{
+	// the ring goes next to the log with the extension swapped, so the log gets the same name as a .txt
+	size_t len = strlen(path);
+	if((len < 5) || _stricmp(path + len - 5, ".ring"))
+	{
+		printf("-simulate needs a path ending in .ring\n");
+		return 1;
+	}
+
+	std::string logPath(path, len - 5);
+	logPath += ".txt";
+
+	DebugLog::open(logPath.c_str());
+
+	if(!DebugLog::openFlightRecorder(sizeKB * 1024ull))
+	{
+		printf("couldn't create the ring for %s\n", path);
+		return 1;
+	}
+
+	for(u32 i = 0; i < count; i++)
+		_MESSAGE("simulated record %u of %u", i + 1, count);
+
+	_FATALERROR("simulated crash after %u records", count);
+
+	abort();
+}
+
+int main(int argc, char ** argv)
+{
+	const char * path = nullptr;
+	u32 tail = 0;
+	u32 maxLevel = DebugLog::kLevel_DebugMessage;
+	u32 simulateCount = 0;
+	u32 simulateKB = 64;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char * arg = argv[i];
+		const char * param = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if(arg[0] != '-')
+		{
+			if(path)
+			{
+				printf("unknown argument %s\n", arg);
+				PrintUsage();
+				return 1;
+			}
+
+			path = arg;
+			continue;
+		}
+
+		arg++;
+
+		if(!_stricmp(arg, "h") || !_stricmp(arg, "help"))
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if(param && !_stricmp(arg, "tail"))
+		{
+			tail = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "level"))
+		{
+			maxLevel = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "simulate"))
+		{
+			simulateCount = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "size"))
+		{
+			simulateKB = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else
+		{
+			printf("unknown switch or missing parameter -%s\n", arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if(!path)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if(simulateCount)
+		return Simulate(path, simulateCount, simulateKB);
+
+	std::vector <u64> data;
+	u64 size = 0;
+
+	if(!ReadFile(path, &data, &size))
+	{
+		printf("couldn't read %s\n", path);
+		return 1;
+	}
+
+	FlightRecorderInfo info;
+	std::vector <FlightRecorderEntry> entries;
+
+	if(!FlightRecorder_Decode(data.data(), size, &info, &entries))
+	{
+		printf("%s isn't a flight recorder ring (this decoder understands version %d)\n", path, kFlightRecorderVersion);
+		return 1;
+	}
+
+	printf("pid %u, ring %llu bytes, %llu records written, %llu intact\n", info.pid,
+		(unsigned long long)info.dataSize, (unsigned long long)info.nextSequence, (unsigned long long)entries.size());
+
+	size_t first = 0;
+	if(tail && (entries.size() > tail))
+		first = entries.size() - tail;
+
+	static const char * kLevelNames[] = { "F", "E", "W", "M", "V", "D" };
+
+	for(size_t i = first; i < entries.size(); i++)
+	{
+		const FlightRecorderEntry & entry = entries[i];
+
+		// only report gaps inside what's printed, everything before the oldest record was overwritten
+		if((i > first) && (entry.sequence != entries[i - 1].sequence + 1))
+			printf("... %llu records lost\n", (unsigned long long)(entry.sequence - entries[i - 1].sequence - 1));
+
+		if(entry.level > maxLevel)
+			continue;
+
+		u64 elapsedUS = (entry.timestamp > info.startTime) ? (entry.timestamp - info.startTime) / 1000 : 0;
+
+		printf("%8llu %6llu.%06llu %s %s\n", (unsigned long long)entry.sequence,
+			(unsigned long long)(elapsedUS / 1000000), (unsigned long long)(elapsedUS % 1000000),
+			(entry.level < sizeof(kLevelNames) / sizeof(kLevelNames[0])) ? kLevelNames[entry.level] : "?",
+			entry.text.c_str());
+	}
+
+	// records that were reserved but never finished, normally the one being written when the process died
+	if(!entries.empty() && (info.nextSequence > entries.back().sequence + 1))
+		printf("... %llu records after this were not completed\n", (unsigned long long)(info.nextSequence - entries.back().sequence - 1));
+
+	return 0;
+}
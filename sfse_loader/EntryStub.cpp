@@ -0,0 +1,108 @@
+#include "EntryStub.h"
+#include "xbyak/xbyak.h"
+#include <cstring>
+
+enum
+{
+	kMaxStubSize = 4096,
+};
+
+bool BuildEntryStub(const EntryStubParams & params, std::vector <u8> * out)
+{
+	size_t pathLen = strlen(params.dllPath) + 1;
+	if(pathLen > 2048)
+		return false;
+
+	struct EntryStub_Code : Xbyak::CodeGenerator
+	{
+		EntryStub_Code(void * buf, const EntryStubParams & params, size_t pathLen) : Xbyak::CodeGenerator(kMaxStubSize, buf)
+		{
+			Xbyak::Label loadLibraryALabel;
+			Xbyak::Label getProcAddressLabel;
+			Xbyak::Label entryLabel;
+			Xbyak::Label pathLabel;
+			Xbyak::Label doneLabel;
+
+			// entered like the entry point, rsp is 8 mod 16. four pushes and 0x28 realign it and leave
+			// shadow space for the calls
+			push(rcx);
+			push(rdx);
+			push(r8);
+			push(r9);
+			sub(rsp, 0x28);
+
+			lea(rcx, ptr[rip + pathLabel]);
+			call(ptr[rip + loadLibraryALabel]);
+			test(rax, rax);
+			jz(doneLabel);
+
+			mov(rcx, rax);
+			mov(edx, 1);	// StartSFSE
+			call(ptr[rip + getProcAddressLabel]);
+			test(rax, rax);
+			jz(doneLabel);
+
+			call(rax);
+
+			// a failed load just starts the game without SFSE, same as a failed remote thread
+			L(doneLabel);
+			add(rsp, 0x28);
+			pop(r9);
+			pop(r8);
+			pop(rdx);
+			pop(rcx);
+			jmp(ptr[rip + entryLabel]);
+
+			align(8);
+
+			L(loadLibraryALabel);
+			dq(params.loadLibraryA);
+
+			L(getProcAddressLabel);
+			dq(params.getProcAddress);
+
+			L(entryLabel);
+			dq(params.originalEntry);
+
+			L(pathLabel);
+			for(size_t i = 0; i < pathLen; i++)
+				db(u8(params.dllPath[i]));
+		}
+	};
+
+	out->assign(kMaxStubSize, 0);
+
+	EntryStub_Code code(out->data(), params, pathLen);
+	code.ready();
+
+	out->resize(code.getSize());
+
+	return true;
+}
+
+bool GetEntryPointRVA(const u8 * headers, size_t len, u32 * rva)
+{
+	// IMAGE_DOS_HEADER::e_lfanew -> 'PE\0\0', IMAGE_FILE_HEADER (20 bytes), IMAGE_OPTIONAL_HEADER64
+	if((len < 0x40) || (headers[0] != 'M') || (headers[1] != 'Z'))
+		return false;
+
+	u32 ntOffset;
+	memcpy(&ntOffset, headers + 0x3C, sizeof(ntOffset));
+
+	const u32 kOptionalHeader = 4 + 20;
+	if((ntOffset > len) || (len - ntOffset < kOptionalHeader + 20))
+		return false;
+
+	const u8 * nt = headers + ntOffset;
+	if(memcmp(nt, "PE\0\0", 4))
+		return false;
+
+	u16 magic;
+	memcpy(&magic, nt + kOptionalHeader, sizeof(magic));
+	if(magic != 0x20B)
+		return false;
+
+	memcpy(rva, nt + kOptionalHeader + 16, sizeof(*rva));
+
+	return *rva != 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "sfse_common/Types.h"
+#include <vector>
+
+// position independent stub that loads the SFSE dll on the runtime's main thread, before its entry point
+//
+// the process is created suspended with the main thread's start address pointing at the image entry point.
+// the loader points it at this stub instead: it calls LoadLibraryA and the dll's ordinal 1 export, restores
+// the argument registers and jumps to the original entry point. nothing here touches another process, so the
+// code and header parsing can be built and checked on any platform.
+
+struct EntryStubParams
+{
+	u64			loadLibraryA;
+	u64			getProcAddress;
+	u64			originalEntry;
+	const char	* dllPath;
+};
+
+// code starts at offset 0, its data follows
+bool BuildEntryStub(const EntryStubParams & params, std::vector <u8> * out);
+
+// reads AddressOfEntryPoint from a copy of a PE32+ image's headers
+bool GetEntryPointRVA(const u8 * headers, size_t len, u32 * rva);
@@ -1,5 +1,6 @@
 #include "LoaderError.h"
 #include "IdentifyEXE.h"
+#include "EntryStub.h"
 #include "sfse_common/FileStream.h"
 #include "sfse_common/Log.h"
 #include <Windows.h>
@@ -148,3 +149,109 @@ static bool DoInjectDLLThread(PROCESS_INFORMATION * info, const char * dllPath,
 
 	return result;
 }
+
+// entry point redirection
+
+static bool DoInjectDLLEntryStub(PROCESS_INFORMATION * info, const char * dllPath);
+
+bool InjectDLLEntryStub(PROCESS_INFORMATION * info, const char * dllPath)
+{
+	bool	result = false;
+
+	__try {
+		result = DoInjectDLLEntryStub(info, dllPath);
+	}
+	__except(EXCEPTION_EXECUTE_HANDLER)
+	{
+		_ERROR("entry stub injection crashed");
+		result = false;
+	}
+
+	return result;
+}
+
+static bool DoInjectDLLEntryStub(PROCESS_INFORMATION * info, const char * dllPath)
+{
+	// make sure the dll exists
+	FileStream	fileCheck;
+	if(!fileCheck.open(dllPath))
+	{
+		PrintLoaderError("Couldn't find %s.", dllPath);
+		return false;
+	}
+
+	fileCheck.close();
+
+	// the main thread of a suspended process hasn't started yet: rcx holds its start address, rdx the PEB
+	CONTEXT	ctx = { 0 };
+	ctx.ContextFlags = CONTEXT_INTEGER;
+
+	if(!GetThreadContext(info->hThread, &ctx))
+	{
+		_ERROR("GetThreadContext failed (%d)", GetLastError());
+		return false;
+	}
+
+	uintptr_t	imageBase = 0;
+	u8			headers[0x1000];
+	SIZE_T		bytesRead;
+	u32			entryRVA;
+
+	// PEB::ImageBaseAddress
+	if(!ReadProcessMemory(info->hProcess, (LPCVOID)(ctx.Rdx + 0x10), &imageBase, sizeof(imageBase), &bytesRead) ||
+		!ReadProcessMemory(info->hProcess, (LPCVOID)imageBase, headers, sizeof(headers), &bytesRead) ||
+		!GetEntryPointRVA(headers, bytesRead, &entryRVA))
+	{
+		_ERROR("couldn't read the runtime's entry point (%d)", GetLastError());
+		return false;
+	}
+
+	// anything else means thread startup doesn't look like we expect, don't touch it
+	if(ctx.Rcx != imageBase + entryRVA)
+	{
+		_ERROR("main thread start address %016I64X isn't the entry point %016I64X", ctx.Rcx, imageBase + entryRVA);
+		return false;
+	}
+
+	EntryStubParams	params;
+	params.loadLibraryA = (uintptr_t)GetProcAddress(GetModuleHandle("kernel32.dll"), "LoadLibraryA");
+	params.getProcAddress = (uintptr_t)GetProcAddress(GetModuleHandle("kernel32.dll"), "GetProcAddress");
+	params.originalEntry = ctx.Rcx;
+	params.dllPath = dllPath;
+
+	std::vector <u8>	stub;
+	if(!BuildEntryStub(params, &stub))
+	{
+		_ERROR("couldn't build entry stub");
+		return false;
+	}
+
+	uintptr_t	stubBase = (uintptr_t)VirtualAllocEx(info->hProcess, NULL, stub.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if(!stubBase)
+	{
+		_ERROR("couldn't allocate memory in target process (%d)", GetLastError());
+		return false;
+	}
+
+	_MESSAGE("entry point = %016I64X", params.originalEntry);
+	_MESSAGE("stubBase = %016I64X", stubBase);
+
+	SIZE_T	bytesWritten;
+	DWORD	oldProtect;
+
+	// the stub runs once and stays allocated, it's a few hundred bytes
+	ctx.Rcx = stubBase;
+
+	if(!WriteProcessMemory(info->hProcess, (LPVOID)stubBase, stub.data(), stub.size(), &bytesWritten) ||
+		!VirtualProtectEx(info->hProcess, (LPVOID)stubBase, stub.size(), PAGE_EXECUTE_READ, &oldProtect) ||
+		!FlushInstructionCache(info->hProcess, (LPCVOID)stubBase, stub.size()) ||
+		!SetThreadContext(info->hThread, &ctx))
+	{
+		_ERROR("couldn't install entry stub (%d)", GetLastError());
+
+		VirtualFreeEx(info->hProcess, (LPVOID)stubBase, 0, MEM_RELEASE);
+		return false;
+	}
+
+	return true;
+}
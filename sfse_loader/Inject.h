@@ -4,3 +4,4 @@
 
 bool InjectDLL(PROCESS_INFORMATION * info, const char * dllPath, ProcHookInfo * hookInfo);
 bool InjectDLLThread(PROCESS_INFORMATION * info, const char * dllPath, bool sync, bool noTimeout);
+bool InjectDLLEntryStub(PROCESS_INFORMATION * info, const char * dllPath);
@@ -1,6 +1,7 @@
 #include "Options.h"
 #include "sfse_common/Log.h"
 #include "sfse_common/Errors.h"
+#include "sfse_common/CPUTopology.h"
 #include <Windows.h>
 
 Options g_options;
@@ -18,7 +19,10 @@ Options::Options()
 	,m_launchSteam(false)
 	,m_noTimeout(false)
 	,m_forceSteamLoader(false)
+	,m_entryStub(false)
 	,m_affinity(0)
+	,m_affinityPolicy(CPUTopology::kPolicy_None)
+	,m_affinityPolicyParam(0)
 {
 	//
 }
@@ -180,10 +184,33 @@ bool Options::Read(int argc, char ** argv)
 						return false;
 					}
 				}
+				else if(!_stricmp(arg, "affinitypolicy"))
+				{
+					if(argc >= 1)
+					{
+						const char	* policyStr = *argv++;
+						argc--;
+
+						if(!CPUTopology::parsePolicy(policyStr, &m_affinityPolicy, &m_affinityPolicyParam))
+						{
+							_ERROR("couldn't read affinity policy (%s)", policyStr);
+							return false;
+						}
+					}
+					else
+					{
+						_ERROR("affinity policy not specified");
+						return false;
+					}
+				}
 				else if(!_stricmp(arg, "forcesteamloader"))
 				{
 					m_forceSteamLoader = true;
 				}
+				else if(!_stricmp(arg, "entrystub"))
+				{
+					m_entryStub = true;
+				}
 				else if(!_stricmp(arg, "-"))
 				{
 					// terminator for arguments
@@ -240,7 +267,14 @@ void Options::PrintUsage(void)
 	_MESSAGE("                    note: specifying this option may cause compatibility problems");
 	_MESSAGE("  -launchsteam - attempt to launch steam if it is not running");
 	_MESSAGE("  -affinity <mask> - set the processor affinity mask");
+	_MESSAGE("  -affinitypolicy <policy> - pick the affinity mask from the cpu topology, combined with -affinity if both are given");
+	_MESSAGE("    pcores - performance cores only (hybrid cpus)");
+	_MESSAGE("    ecores - efficiency cores only (hybrid cpus)");
+	_MESSAGE("    l3[:n] - a single L3 cache domain (ccd), largest first");
+	_MESSAGE("    reserve:n - leave n physical cores free for background work");
+	_MESSAGE("    nosmt - one logical processor per physical core");
 	_MESSAGE("  -forcesteamloader - override exe type detection and use steam loader");
+	_MESSAGE("  -entrystub - load the dll on the main thread before the entry point instead of from a remote thread");
 	_MESSAGE("  -- - ignore arguments after this marker");
 }
 
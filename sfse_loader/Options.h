@@ -27,8 +27,11 @@ public:
 	bool	m_launchSteam;
 	bool	m_noTimeout;
 	bool	m_forceSteamLoader;
+	bool	m_entryStub;
 
 	u64		m_affinity;
+	u32		m_affinityPolicy;
+	u32		m_affinityPolicyParam;
 
 	std::string	m_altEXE;
 	std::string	m_altDLL;
@@ -6,6 +6,7 @@
 #include "sfse_common/sfse_version.h"
 #include "sfse_common/Utilities.h"
 #include "sfse_common/FileStream.h"
+#include "sfse_common/CPUTopology.h"
 #include "LoaderError.h"
 #include "IdentifyEXE.h"
 #include "Inject.h"
@@ -219,11 +220,36 @@ int main(int argc, char ** argv)
 	_MESSAGE("main thread id = %d", procInfo.dwThreadId);
 
 	// set affinity if requested
-	if(g_options.m_affinity)
+	u64 affinity = g_options.m_affinity;
+
+	if(g_options.m_affinityPolicy)
+	{
+		CPUTopology	topology;
+
+		if(topology.loadSystem())
+		{
+			topology.log();
+
+			u64 policyMask = topology.policyMask(g_options.m_affinityPolicy, g_options.m_affinityPolicyParam);
+			if(affinity)
+				policyMask &= affinity;
+
+			if(policyMask)
+				affinity = policyMask;
+			else
+				_WARNING("affinity policy doesn't match any processors, ignoring");
+		}
+		else
+		{
+			_WARNING("couldn't read cpu topology, ignoring affinity policy");
+		}
+	}
+
+	if(affinity)
 	{
-		_MESSAGE("setting affinity mask to %016I64X", g_options.m_affinity);
+		_MESSAGE("setting affinity mask to %016I64X", affinity);
 
-		if(!SetProcessAffinityMask(procInfo.hProcess, g_options.m_affinity))
+		if(!SetProcessAffinityMask(procInfo.hProcess, affinity))
 		{
 			_WARNING("couldn't set affinity mask (%08X)", GetLastError());
 		}
@@ -244,7 +270,15 @@ int main(int argc, char ** argv)
 	case kProcType_Steam:
 	case kProcType_Normal:
 	case kProcType_GOG:
-		injectionSucceeded = InjectDLLThread(&procInfo, dllPath.c_str(), true, g_options.m_noTimeout);
+		if(g_options.m_entryStub)
+		{
+			injectionSucceeded = InjectDLLEntryStub(&procInfo, dllPath.c_str());
+			if(!injectionSucceeded)
+				_WARNING("entry stub injection failed, falling back to a remote thread");
+		}
+
+		if(!injectionSucceeded)
+			injectionSucceeded = InjectDLLThread(&procInfo, dllPath.c_str(), true, g_options.m_noTimeout);
 		break;
 
 	default:
@@ -0,0 +1,282 @@
+#include "sfse_common/Telemetry.h"
+#include "sfse_common/Platform.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+static void PrintUsage()
+{
+	printf("usage: sfse_telemetry [options]\n");
+	printf("\n");
+	printf("options:\n");
+	printf("  -h, -help - print this options list\n");
+	printf("  -name <name> - shared memory segment to read (default %s)\n", kTelemetryDefaultName);
+	printf("  -watch <ms> - keep reading every <ms> instead of once\n");
+	printf("  -count <n> - stop after n reads when watching\n");
+	printf("  -json - print each read as a line of JSON\n");
+	printf("  -simulate <seconds> - publish synthetic metrics to the segment instead of reading it\n");
+}
+
+static const char * GetTypeName(u32 type)
+{
+	switch(type)
+	{
+		case kMetricType_Counter:	return "counter";
+		case kMetricType_Gauge:		return "gauge";
+		case kMetricType_Histogram:	return "histogram";
+	}
+
+	return "unknown";
+}
+
+static u64 GetAgeMS(const TelemetryFrame & frame)
+{
+	u64 now = std::chrono::duration_cast <std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	return (now > frame.timestamp) ? (now - frame.timestamp) / 1000000 : 0;
+}
+
+static void PrintTable(const char * name, const TelemetryFrame & frame)
+{
+	printf("%s: pid %u, publish %llu, age %llums\n", name, frame.pid,
+		(unsigned long long)frame.publishCount, (unsigned long long)GetAgeMS(frame));
+
+	printf("%-48s %-9s %12s %12s %12s %12s %12s\n", "name", "type", "count", "value/p50", "p90", "p99", "max");
+
+	for(auto & entry : frame.entries)
+	{
+		if(entry.type == kMetricType_Histogram)
+		{
+			printf("%-48s %-9s %12llu %12llu %12llu %12llu %12llu\n", entry.name, GetTypeName(entry.type),
+				(unsigned long long)entry.count, (unsigned long long)entry.p50, (unsigned long long)entry.p90,
+				(unsigned long long)entry.p99, (unsigned long long)entry.max);
+		}
+		else if(entry.type == kMetricType_Gauge)
+		{
+			printf("%-48s %-9s %12s %12lld\n", entry.name, GetTypeName(entry.type), "", (long long)entry.value);
+		}
+		else
+		{
+			printf("%-48s %-9s %12llu\n", entry.name, GetTypeName(entry.type), (unsigned long long)entry.count);
+		}
+	}
+
+	printf("\n");
+}
+
+static void PrintJSON(const TelemetryFrame & frame)
+{
+	printf("{\"pid\":%u,\"sequence\":%llu,\"publish_count\":%llu,\"timestamp_ns\":%llu,\"interval_ns\":%llu,\"metrics\":[",
+		frame.pid, (unsigned long long)frame.sequence, (unsigned long long)frame.publishCount,
+		(unsigned long long)frame.timestamp, (unsigned long long)frame.intervalNS);
+
+	for(size_t i = 0; i < frame.entries.size(); i++)
+	{
+		const TelemetryEntry & entry = frame.entries[i];
+
+		printf("%s{\"name\":\"", i ? "," : "");
+
+		// metric names are plain identifiers, but plugin names end up in them too
+		for(const char * traverse = entry.name; *traverse; traverse++)
+		{
+			char c = *traverse;
+
+			if((c == '"') || (c == '\\'))
+				printf("\\%c", c);
+			else if((u8)c < 0x20)
+				printf("\\u%04x", c);
+			else
+				putchar(c);
+		}
+
+		printf("\",\"type\":\"%s\"", GetTypeName(entry.type));
+
+		if(entry.type == kMetricType_Histogram)
+		{
+			printf(",\"count\":%llu,\"sum\":%llu,\"min\":%llu,\"max\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu}",
+				(unsigned long long)entry.count, (unsigned long long)entry.sum,
+				(unsigned long long)entry.min, (unsigned long long)entry.max,
+				(unsigned long long)entry.p50, (unsigned long long)entry.p90,
+				(unsigned long long)entry.p99, (unsigned long long)entry.p999);
+		}
+		else if(entry.type == kMetricType_Gauge)
+		{
+			printf(",\"value\":%lld}", (long long)entry.value);
+		}
+		else
+		{
+			printf(",\"count\":%llu}", (unsigned long long)entry.count);
+		}
+	}
+
+	printf("]}\n");
+	fflush(stdout);
+}
+
+// stands in for the runtime so readers can be developed and tested without the game, uses the same metric
+// names SFSE does
+static int Simulate(const char * name, u32 seconds, u32 intervalMS)
+{
+	if(!Telemetry_StartPublishing(name, intervalMS))
+	{
+		printf("couldn't create %s\n", name);
+		return 1;
+	}
+
+	printf("publishing to %s for %us\n", name, seconds);
+	fflush(stdout);
+
+	std::mt19937 rng(1);
+
+	const char * plugins[] = { "ExamplePlugin", "AnotherPlugin", "SlowPlugin" };
+	for(auto plugin : plugins)
+	{
+		u64 loadUS = 500 + (rng() % 20000);
+		if(!strcmp(plugin, "SlowPlugin"))
+			loadUS += 100000;
+
+		Metrics_Record(Metrics_Register("sfse.plugins.load_us", kMetricType_Histogram), loadUS);
+
+		// SFSE only gives slow loaders a gauge of their own
+		if(loadUS >= 50000)
+		{
+			char metric[kTelemetryNameLength];
+			snprintf(metric, sizeof(metric), "sfse.plugins.%s.load_us", plugin);
+
+			Metrics_SetGauge(Metrics_Register(metric, kMetricType_Gauge), loadUS);
+		}
+	}
+
+	u32 dispatches = Metrics_Register("sfse.messaging.dispatches", kMetricType_Counter);
+	u32 dispatchLatency = Metrics_Register("sfse.messaging.dispatch_ns", kMetricType_Histogram);
+	u32 hookCalls = Metrics_Register("sfse.hooks.papyrus_native_calls", kMetricType_Counter);
+	u32 linesDropped = Metrics_Register("sfse.console.lines_dropped", kMetricType_Counter);
+
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	while(std::chrono::steady_clock::now() < end)
+	{
+		for(u32 i = 0; i < 100; i++)
+		{
+			Metrics_Add(dispatches);
+			Metrics_Record(dispatchLatency, 200 + (rng() % 2000));
+		}
+
+		Metrics_Add(hookCalls, 1000 + (rng() % 500));
+		if(!(rng() % 50))
+			Metrics_Add(linesDropped, rng() % 4000);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	Telemetry_StopPublishing();
+
+	return 0;
+}
+
+int main(int argc, char ** argv)
+{
+	const char * name = kTelemetryDefaultName;
+	u32 watchMS = 0;
+	u32 count = 0;
+	u32 simulateSeconds = 0;
+	bool json = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char * arg = argv[i];
+		const char * param = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if(arg[0] != '-')
+		{
+			printf("unknown argument %s\n", arg);
+			PrintUsage();
+			return 1;
+		}
+
+		arg++;
+
+		if(!_stricmp(arg, "h") || !_stricmp(arg, "help"))
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if(!_stricmp(arg, "json"))
+		{
+			json = true;
+		}
+		else if(param && !_stricmp(arg, "name"))
+		{
+			name = param;
+			i++;
+		}
+		else if(param && !_stricmp(arg, "watch"))
+		{
+			watchMS = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "count"))
+		{
+			count = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else if(param && !_stricmp(arg, "simulate"))
+		{
+			simulateSeconds = strtoul(param, nullptr, 10);
+			i++;
+		}
+		else
+		{
+			printf("unknown switch or missing parameter -%s\n", arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if(simulateSeconds)
+		return Simulate(name, simulateSeconds, watchMS ? watchMS : 100);
+
+	TelemetryReader reader;
+	if(!reader.open(name))
+	{
+		printf("couldn't open %s, is SFSE running with telemetry enabled?\n", name);
+		return 1;
+	}
+
+	TelemetryFrame frame;
+	u32 reads = 0;
+
+	while(true)
+	{
+		u32 result = reader.read(&frame);
+		if(result == TelemetryReader::kRead_BadLayout)
+		{
+			printf("%s has an unsupported layout (this reader understands version %d)\n", name, kTelemetryVersion);
+			return 1;
+		}
+
+		if(result == TelemetryReader::kRead_OK)
+		{
+			if(json)
+				PrintJSON(frame);
+			else
+				PrintTable(name, frame);
+		}
+		else if(!watchMS)
+		{
+			printf("%s was being updated on every try, run again\n", name);
+			return 1;
+		}
+
+		reads++;
+
+		if(!watchMS || (count && (reads >= count)))
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(watchMS));
+	}
+
+	return 0;
+}